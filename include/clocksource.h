@@ -0,0 +1,54 @@
+#ifndef CLOCKSOURCE_H
+#define CLOCKSOURCE_H
+
+#include "types.h"
+
+#define NSEC_PER_USEC   1000ULL
+#define NSEC_PER_MSEC   1000000ULL
+#define NSEC_PER_SEC    1000000000ULL
+
+// Fixed-point shift used by both conversion factors
+#define CLOCKSOURCE_SHIFT  32
+
+// CNTVCT_EL0 clocksource: frequency from CNTFRQ_EL0 and the precomputed
+// factors ns = (cycles * mult) >> shift, cycles = (ns * ns_mult) >> shift
+struct clocksource {
+    uint64_t freq;             // Hz
+    uint64_t mult;             // cycles -> ns
+    uint64_t ns_mult;          // ns -> cycles (rounded up)
+    uint32_t shift;
+};
+
+extern struct clocksource arch_clocksource;
+
+// Read CNTFRQ_EL0 and compute the conversion factors. Called once from
+// start.S, before the first C code that converts counter values.
+void clocksource_init(void);
+
+// Raw counter read (CNTVCT_EL0, ordered by isb)
+static inline uint64_t clocksource_read(void) {
+    uint64_t cnt;
+    __asm__ volatile("isb\n"
+                     "mrs %0, cntvct_el0" : "=r"(cnt) :: "memory");
+    return cnt;
+}
+
+// Counter cycles to nanoseconds (128-bit product, never overflows)
+static inline uint64_t clocksource_cyc2ns(uint64_t cycles) {
+    return (uint64_t)(((unsigned __int128)cycles * arch_clocksource.mult) >> CLOCKSOURCE_SHIFT);
+}
+
+// Nanoseconds to counter cycles, rounded up so deadlines are never early
+static inline uint64_t clocksource_ns2cyc(uint64_t ns) {
+    unsigned __int128 cyc = (unsigned __int128)ns * arch_clocksource.ns_mult;
+    return (uint64_t)((cyc + ((1ULL << CLOCKSOURCE_SHIFT) - 1)) >> CLOCKSOURCE_SHIFT);
+}
+
+// Monotonic nanoseconds since the counter started; use for all statistics
+// and tracing timestamps
+uint64_t ktime_get_ns(void);
+
+// Scheduler clock, same time base as ktime_get_ns()
+uint64_t sched_clock(void);
+
+#endif
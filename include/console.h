@@ -0,0 +1,21 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "types.h"
+
+// Bytes buffered before the console drains to the UART on its own
+#define CONSOLE_BUF_SIZE    512
+
+// PL011 transmit FIFO depth (ARM PL011 r1p5); a drain waits for the FIFO
+// to empty once and then writes this many bytes without polling
+#define UART_FIFO_DEPTH     16
+
+// Queue len bytes ("\n" becomes "\r\n"); drains when the buffer fills.
+// Task context only: interrupt handlers log through irqlog instead.
+void console_write(const char* buf, size_t len);
+
+// Push everything buffered so far out to the UART (into its TX ring once
+// uart_irq_init() has run, so this does not wait for the line)
+void console_flush(void);
+
+#endif
@@ -6,6 +6,15 @@
  * 
  * This header controls the verbosity of debug output during boot.
  * Different build configurations can enable/disable various debug levels.
+ *
+ * The tier is normally picked on the command line (DEBUG_FLAGS in the
+ * Makefile, or PROFILE=release which selects SILENT); VERBOSE is only the
+ * fallback when nothing was passed.
+ *
+ * The tier also sets DEBUG_LOG_LEVEL, the most verbose klog level that is
+ * compiled in. klog()/pr_*()/early_log_*() calls above it compile to
+ * nothing (see klog.h); klog_set_level() can only filter further at run
+ * time.
  */
 
 // ============================================================================
@@ -15,7 +24,11 @@
 // Uncomment ONE of these based on your needs:
 
 // 1. FULL VERBOSE DEBUG (Development)
+#if !defined(DEBUG_BOOT_MODERATE) && !defined(DEBUG_BOOT_MINIMAL) && !defined(DEBUG_BOOT_SILENT)
+#ifndef DEBUG_BOOT_VERBOSE
 #define DEBUG_BOOT_VERBOSE      // Complete debug output with test patterns
+#endif
+#endif
 
 // 2. MODERATE DEBUG (Testing)
 // #define DEBUG_BOOT_MODERATE   // Key markers only, no test patterns
@@ -38,6 +51,7 @@
     #define DEBUG_MARKERS_EXTRA_ENABLED    // Additional debug markers
     #define DEBUG_TIMING_DELAYS_ENABLED    // UART delays for readability
     #define DEBUG_MEMORY_MAPPING_VERBOSE   // Per-page memory mapping debug
+    #define DEBUG_CONTEXT_MARKERS_ENABLED  // UART markers in restore_context paths
 #endif
 
 #ifdef DEBUG_BOOT_MODERATE
@@ -111,6 +125,20 @@
     #define DEBUG_MEMORY_MAPPING_PER_PAGE 0
 #endif
 
+// Compile-time log ceiling, in klog level numbers (KLOG_ERR = 3 ...
+// KLOG_DEBUG = 7). Plain numbers so assembly can test it too.
+#ifndef DEBUG_LOG_LEVEL
+#if defined(DEBUG_BOOT_SILENT)
+    #define DEBUG_LOG_LEVEL 3
+#elif defined(DEBUG_BOOT_MINIMAL)
+    #define DEBUG_LOG_LEVEL 4
+#elif defined(DEBUG_BOOT_MODERATE)
+    #define DEBUG_LOG_LEVEL 6
+#else
+    #define DEBUG_LOG_LEVEL 7
+#endif
+#endif
+
 // ============================================================================
 // CONFIGURATION INFO
 // ============================================================================
@@ -0,0 +1,19 @@
+#ifndef FDT_H
+#define FDT_H
+
+#include "types.h"
+
+#define FDT_MAGIC           0xd00dfeed
+
+// QEMU virt places the DTB at the start of RAM for non-Linux images
+#define FDT_DEFAULT_ADDR    0x40000000UL
+
+// Returns 1 if a flattened device tree header is present at addr
+int fdt_valid(uint64_t addr);
+
+// Find the first node whose "compatible" list contains compat and decode
+// up to max_regs (address, size) pairs of its "reg" property into reg[].
+// Returns the number of pairs decoded, or -1 if no node matched.
+int fdt_find_compatible(uint64_t addr, const char* compat, uint64_t* reg, int max_regs);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef GIC_H
+#define GIC_H
+
+#include "types.h"
+
+// QEMU virt defaults, used when the device tree does not say otherwise
+#define GIC_DIST_BASE_DEFAULT     0x08000000UL
+#define GIC_CPU_BASE_DEFAULT      0x08010000UL   // GICv2 CPU interface
+#define GIC_REDIST_BASE_DEFAULT   0x080A0000UL   // GICv3 redistributors
+
+// Priority grouping: the top GIC_PREEMPT_BITS of a priority select its
+// preemption group, the rest only order pending interrupts within it
+#define GIC_PREEMPT_BITS          4
+#define GIC_PRIO_IDLE             0xFF           // PMR: let everything in
+
+// Controller back end, chosen once by gic_probe()
+struct gic_chip {
+    const char* name;
+    int version;
+    int eoi_split;                        // eoi() drops priority, deactivate() completes
+    void (*init)(void);                   // Distributor + boot CPU interface
+    uint32_t (*ack)(uint32_t* iar);       // Returns INTID, raw IAR in *iar
+    void (*eoi)(uint32_t iar);
+    void (*deactivate)(uint32_t iar);
+    void (*enable)(uint32_t irq);         // SPIs are also routed to the boot CPU
+    void (*disable)(uint32_t irq);
+    void (*set_priority)(uint32_t irq, uint8_t priority);
+    void (*set_pending)(uint32_t irq);
+    void (*clear_pending)(uint32_t irq);
+    void (*send_sgi)(uint32_t sgi, uint8_t target_mask);
+    uint32_t (*running_priority)(void);
+};
+
+struct gic_config {
+    uint64_t dist_base;
+    uint64_t cpu_base;                    // GICv2 only
+    uint64_t redist_base;                 // GICv3 only
+};
+
+extern const struct gic_chip gic_v2_chip;
+extern const struct gic_chip gic_v3_chip;
+
+extern const struct gic_chip* gic;
+extern struct gic_config gic_config;
+
+// Select GICv2 or GICv3 from the device tree (falling back to GICD_PIDR2).
+// Called from start.S before the PMM can overwrite the DTB.
+void gic_probe(void);
+
+// Bring up the selected controller once; later calls are no-ops
+void gic_init(void);
+
+#endif
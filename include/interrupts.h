@@ -16,4 +16,18 @@ void disable_irq(void);
 // Returns true if IRQs are enabled, false otherwise
 int irqs_enabled(void);
 
+// Mask IRQs and return the previous DAIF value (no debug output, usable
+// on hot paths and in IRQ context)
+static inline unsigned long local_irq_save(void) {
+    unsigned long flags;
+    __asm__ volatile("mrs %0, daif\n"
+                     "msr daifset, #2" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+// Restore the DAIF value returned by local_irq_save()
+static inline void local_irq_restore(unsigned long flags) {
+    __asm__ volatile("msr daif, %0" :: "r"(flags) : "memory");
+}
+
 #endif
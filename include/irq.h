@@ -0,0 +1,77 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "types.h"
+#include "ptrace.h"
+
+// GIC interrupt ID space
+#define IRQ_SGI_BASE        0       // 0-15:  software generated (per CPU)
+#define IRQ_PPI_BASE        16      // 16-31: private peripheral (per CPU)
+#define IRQ_SPI_BASE        32      // 32+:   shared peripheral
+#define NR_IRQS             1020    // 1020-1023 are special/spurious INTIDs
+
+#define IRQ_DEFAULT_PRIORITY 0xA0   // Lower value = higher priority
+
+// One preemption group (GIC_PREEMPT_BITS) above the default, so the
+// scheduler tick nests on top of running device handlers (UART, PMU)
+#define IRQ_TIMER_PRIORITY   0x80
+
+// Handler called with the INTID and the data passed to request_irq().
+// Runs with IRQs masked, before EOI.
+typedef void (*irq_handler_t)(uint32_t irq, void* data);
+
+// Install a handler for an INTID and enable it at the GIC.
+// Returns 0 on success, -1 for a bad INTID or if another handler owns it.
+int request_irq(uint32_t irq, irq_handler_t handler, void* data);
+
+// Disable an INTID at the GIC and remove its handler
+void free_irq(uint32_t irq);
+
+// Per-INTID distributor control
+void irq_enable(uint32_t irq);
+void irq_disable(uint32_t irq);
+void irq_set_priority(uint32_t irq, uint8_t priority);
+
+// Raise SGI `sgi` (0-15) on the CPUs in target_mask
+void irq_send_sgi(uint32_t sgi, uint8_t target_mask);
+
+// Number of times an INTID has been dispatched
+uint64_t irq_get_count(uint32_t irq);
+
+// Spurious acknowledges and INTIDs with no handler
+uint64_t irq_get_spurious_count(void);
+
+// IRQ fast path: acknowledge, dispatch through the INTID table, EOI.
+// The handler runs with IRQs unmasked; the GIC running priority keeps
+// out everything but higher-priority groups, which nest on top. With a
+// split EOI (GICv3) the outermost INTID is deactivated by irq_exit() once
+// its softirqs have run.
+void handle_irq(void);
+
+// Bracket one exception-level IRQ. irq_enter() returns the frame of the
+// interrupt it nests in, which irq_exit() restores. When the outermost
+// interrupt unwinds, irq_exit() runs pending softirqs and then reschedules;
+// nested interrupts do neither.
+struct pt_regs* irq_enter(struct pt_regs* regs);
+void irq_exit(struct pt_regs* prev_regs);
+
+// Nonzero while executing in (possibly nested) IRQ or softirq context
+unsigned int in_interrupt(void);
+
+// Frame of the innermost interrupt being handled, NULL outside IRQ context
+struct pt_regs* get_irq_regs(void);
+
+// CNTVCT_EL0 at exception vector entry and at irq_handler() entry for the
+// most recent IRQ on this CPU. A nested IRQ overwrites the outer one's.
+struct irq_stamp {
+    uint64_t vector;
+    uint64_t handler;
+};
+
+const struct irq_stamp* irq_last_stamp(void);
+
+// C entry from el1_irq/el0_irq in entry.S. vector_cntvct is the counter
+// value read by the vector entry code.
+void irq_handler(struct pt_regs* regs, uint64_t vector_cntvct);
+
+#endif
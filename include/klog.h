@@ -0,0 +1,100 @@
+#ifndef KLOG_H
+#define KLOG_H
+
+#include "types.h"
+#include "debug_config.h"
+#include "uart.h"
+
+// Message levels, most severe first. Records above the runtime threshold
+// (klog_set_level()) are discarded at the call site.
+#define KLOG_EMERG      0
+#define KLOG_ALERT      1
+#define KLOG_CRIT       2
+#define KLOG_ERR        3
+#define KLOG_WARNING    4
+#define KLOG_NOTICE     5
+#define KLOG_INFO       6
+#define KLOG_DEBUG      7
+
+// Records per CPU ring (power of two)
+#define KLOG_ENTRIES    256
+
+// Argument words kept per record
+#define KLOG_MAX_ARGS   6
+
+// Longest formatted line, including the timestamp prefix
+#define KLOG_LINE_MAX   192
+
+#define __KLOG_NARGS(_0, _1, _2, _3, _4, _5, _6, n, ...) n
+#define KLOG_NARGS(...) __KLOG_NARGS(0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+
+// Widen every argument to a uint64_t word at the call site, so
+// klog_record() reads each one back with the type it was passed as
+#define __KLOG_CAT_(a, b) a##b
+#define __KLOG_CAT(a, b) __KLOG_CAT_(a, b)
+#define __KLOG_W_0()
+#define __KLOG_W_1(a) , (uint64_t)(a)
+#define __KLOG_W_2(a, ...) , (uint64_t)(a) __KLOG_W_1(__VA_ARGS__)
+#define __KLOG_W_3(a, ...) , (uint64_t)(a) __KLOG_W_2(__VA_ARGS__)
+#define __KLOG_W_4(a, ...) , (uint64_t)(a) __KLOG_W_3(__VA_ARGS__)
+#define __KLOG_W_5(a, ...) , (uint64_t)(a) __KLOG_W_4(__VA_ARGS__)
+#define __KLOG_W_6(a, ...) , (uint64_t)(a) __KLOG_W_5(__VA_ARGS__)
+#define KLOG_WORDS(...) __KLOG_CAT(__KLOG_W_, KLOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+
+// Levels above the build's DEBUG_LOG_LEVEL (debug_config.h) are compiled
+// out: the test is a constant, so the call and its argument evaluation
+// vanish while the arguments are still type-checked
+#define KLOG_ENABLED(level)     ((level) <= DEBUG_LOG_LEVEL)
+
+// Log a printf-style message. Only the format pointer, the raw argument
+// words and a timestamp are stored; formatting happens later in the log
+// drain, so this is cheap and safe from any context including IRQ
+// handlers. fmt and any %s argument must therefore outlive the drain
+// (string literals, not stack buffers). At most KLOG_MAX_ARGS integer or
+// pointer arguments.
+#define klog(level, fmt, ...) do {                                          \
+        if (KLOG_ENABLED(level))                                            \
+            klog_record((level), (fmt), KLOG_NARGS(__VA_ARGS__) KLOG_WORDS(__VA_ARGS__)); \
+    } while (0)
+
+#define pr_err(fmt, ...)        klog(KLOG_ERR, fmt, ##__VA_ARGS__)
+#define pr_warn(fmt, ...)       klog(KLOG_WARNING, fmt, ##__VA_ARGS__)
+#define pr_notice(fmt, ...)     klog(KLOG_NOTICE, fmt, ##__VA_ARGS__)
+#define pr_info(fmt, ...)       klog(KLOG_INFO, fmt, ##__VA_ARGS__)
+#define pr_debug(fmt, ...)      klog(KLOG_DEBUG, fmt, ##__VA_ARGS__)
+
+// Synchronous, unformatted output for code that cannot go through the
+// log: page-table setup before and across the MMU switch, and the
+// console/UART paths themselves. Same compile-time gate as klog().
+
+#define early_log_puts(level, str) do {                                     \
+        if (KLOG_ENABLED(level)) uart_puts(str);                            \
+    } while (0)
+
+#define early_log_hex(level, str, value) do {                               \
+        if (KLOG_ENABLED(level)) {                                          \
+            uart_puts(str);                                                 \
+            uart_hex64(value);                                              \
+            uart_puts("\n");                                                \
+        }                                                                   \
+    } while (0)
+
+// nargs uint64_t words follow (klog() widens them)
+void klog_record(int level, const char* fmt, int nargs, ...);
+
+// Runtime threshold: messages with level <= this are kept. It cannot
+// bring back levels compiled out by DEBUG_LOG_LEVEL.
+void klog_set_level(int level);
+int klog_get_level(void);
+
+// Format and print everything queued so far (task context, or with IRQs
+// masked on a fatal path)
+void klog_flush(void);
+
+// Records lost because a ring was full
+uint64_t klog_dropped(void);
+
+// Kernel task that drains the rings in the background
+void klog_task(void);
+
+#endif
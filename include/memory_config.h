@@ -3,6 +3,7 @@
 
 #include "types.h"
 #include "uart.h"
+#include "debug_config.h"
 
 /**
  * @file memory_config.h
@@ -24,6 +25,10 @@
 #define PAGE_SIZE  (1 << PAGE_SHIFT)  // 4096 bytes
 #define ENTRIES_PER_TABLE 512
 
+/** Boot thread stack: boot/start.S sets SP to BOOT_STACK_TOP (keep in sync) */
+#define BOOT_STACK_TOP   0x40800000UL
+#define BOOT_STACK_SIZE  0x10000UL
+
 /* ========================================================================
  * ARMV8 PAGE TABLE ENTRY FLAGS
  * ======================================================================== */
@@ -199,6 +204,10 @@ extern int num_mappings;                     /**< Number of currently tracked ma
 extern bool debug_vmm;                       /**< Debug flag for VMM operations */
 extern bool mmu_enabled;                     /**< MMU enabled status flag */
 
+/** Per-operation VMM tracing: debug_vmm at run time, and only in builds
+ *  whose DEBUG_LOG_LEVEL keeps KLOG_DEBUG (7), so release builds drop it */
+#define vmm_debug_enabled() (DEBUG_LOG_LEVEL >= 7 && debug_vmm)
+
 /* ========================================================================
  * FUNCTION PROTOTYPES
  * ======================================================================== */
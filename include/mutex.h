@@ -0,0 +1,59 @@
+#ifndef MUTEX_H
+#define MUTEX_H
+
+#include "types.h"
+#include "task.h"
+#include "wait.h"
+
+// Sleeping mutex. Uncontended lock/unlock is a single compare-and-swap on
+// owner; a contended locker sleeps on the wait queue straight away (with
+// NR_CPUS == 1 the owner cannot be running meanwhile, so spinning would
+// only burn the owner's time). Unlock hands ownership straight to the
+// first waiter, so waiters are served in FIFO order and cannot be starved
+// by new arrivals.
+//
+// Task context only; a mutex is not recursive.
+struct mutex {
+    task_t* volatile owner;
+    struct wait_queue_head wait;
+};
+
+#define MUTEX_INIT  { NULL, WAIT_QUEUE_HEAD_INIT }
+
+#define DEFINE_MUTEX(name) struct mutex name = MUTEX_INIT
+
+static inline void mutex_init(struct mutex* lock) {
+    lock->owner = NULL;
+    init_waitqueue_head(&lock->wait);
+}
+
+static inline int mutex_is_locked(const struct mutex* lock) {
+    return lock->owner != NULL;
+}
+
+void mutex_lock(struct mutex* lock);
+void mutex_unlock(struct mutex* lock);
+
+// Returns 1 if the mutex was taken, 0 if it is held
+int mutex_trylock(struct mutex* lock);
+
+// Condition variable used together with a struct mutex
+struct condvar {
+    struct wait_queue_head wait;
+};
+
+#define CONDVAR_INIT    { WAIT_QUEUE_HEAD_INIT }
+
+static inline void condvar_init(struct condvar* cv) {
+    init_waitqueue_head(&cv->wait);
+}
+
+// Atomically release lock and sleep until signalled, then re-take lock.
+// As usual, callers re-check their predicate in a loop.
+void condvar_wait(struct condvar* cv, struct mutex* lock);
+
+// Wake one / all waiters. Safe from any context.
+void condvar_signal(struct condvar* cv);
+void condvar_broadcast(struct condvar* cv);
+
+#endif
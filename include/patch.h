@@ -0,0 +1,18 @@
+#ifndef PATCH_H
+#define PATCH_H
+
+#include "types.h"
+
+// Live patching of single kernel text instructions
+
+#define AARCH64_INSN_NOP    0xD503201FU
+
+// "b target" encoded for execution at pc (+/-128MB range)
+uint32_t aarch64_insn_gen_branch(uint64_t pc, uint64_t target);
+
+// Replace the instruction at addr and make it visible to instruction
+// fetch. Returns 0, or -1 if addr is misaligned. Safe to call with the MMU
+// on: kernel text is mapped read-only, the write goes through an alias.
+int aarch64_insn_patch_text(void* addr, uint32_t insn);
+
+#endif /* PATCH_H */
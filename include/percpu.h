@@ -0,0 +1,21 @@
+#ifndef PERCPU_H
+#define PERCPU_H
+
+#include "types.h"
+
+// Only the boot CPU is brought up; per-CPU data is sized for NR_CPUS so
+// secondaries can be added without changing the layout users see
+#define NR_CPUS 1
+
+// Index of the executing CPU into per-CPU arrays (MPIDR_EL1.Aff0)
+static inline unsigned int smp_processor_id(void) {
+#if NR_CPUS == 1
+    return 0;
+#else
+    uint64_t mpidr;
+    __asm__ volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+    return (unsigned int)(mpidr & 0xFF);
+#endif
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include "types.h"
+#include "pmu.h"
+
+// PMU accounting on top of the free-running counters in pmu.h.
+//
+// Regions:
+//     static PERF_REGION(alloc_region, "alloc_page");
+//     struct pmu_sample start;
+//     perf_region_begin(&start);
+//     ...
+//     perf_region_end(&alloc_region, &start);
+//
+// The start snapshot lives on the caller's stack, so regions nest and may
+// be entered from IRQ context. Until pmu_init() has run both calls are a
+// single load and branch.
+//
+// Tasks: schedule() calls perf_task_switch() and every task accumulates
+// the counters for the time it was on the CPU in task_t.perf.
+
+struct task;
+
+struct perf_region {
+    const char* name;
+    uint64_t calls;
+    uint64_t total[PMU_NR_COUNTERS];
+    uint64_t max_cycles;
+    struct perf_region* next;   // Report list, linked on first use
+    bool registered;
+};
+
+#define PERF_REGION(var, label) struct perf_region var = { .name = (label) }
+
+static inline void perf_region_begin(struct pmu_sample* start) {
+    if (pmu_active) pmu_read(start);
+}
+
+void perf_region_end(struct perf_region* region, const struct pmu_sample* start);
+
+// Account the counters since next was last switched in to prev and mark
+// the start of the switch to next. IRQs must be masked.
+void perf_task_switch(struct task* prev, struct task* next);
+
+// Close the "context_switch" region opened by perf_task_switch(); called
+// by the task that resumes from cpu_switch_to(), or by schedule_tail()
+// on a new task's first run
+void perf_task_switch_done(void);
+
+// Zero every region and task total
+void perf_reset(void);
+
+// Print per-call averages for every region and totals for every task
+void perf_report(void);
+
+// Serial command task for perf, trace and profile (perf_shell.c)
+void perf_shell_task(void);
+
+#endif /* PERF_H */
@@ -17,6 +17,7 @@ void map_range(uint64_t* l0_table, uint64_t virt_start, uint64_t virt_end,
                uint64_t phys_start, uint64_t flags);
 void map_page_direct(uint64_t va, uint64_t pa, uint64_t size, uint64_t flags);
 void map_kernel_page(uint64_t va, uint64_t pa, uint64_t flags);
+void unmap_kernel_page(uint64_t va);
 void map_uart(void);
 void verify_uart_mapping(void);
 
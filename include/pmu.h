@@ -0,0 +1,86 @@
+#ifndef PMU_H
+#define PMU_H
+
+#include "types.h"
+
+// ARMv8 PMUv3 driver. The cycle counter (PMCCNTR_EL0, 64-bit) and four
+// event counters (PMEVCNTR0-3_EL0, 32-bit) run free from pmu_init() on,
+// counting at EL0 and EL1. Consumers take snapshots with pmu_read() and
+// subtract; see perf.h for per-region and per-task accounting.
+
+enum pmu_counter {
+    PMU_CYCLES,                 // CPU_CYCLES, PMCCNTR_EL0
+    PMU_INSTRUCTIONS,           // INST_RETIRED, PMEVCNTR0_EL0
+    PMU_L1D_REFILL,             // L1D_CACHE_REFILL, PMEVCNTR1_EL0
+    PMU_TLB_REFILL,             // L1D_TLB_REFILL, PMEVCNTR2_EL0
+    PMU_BR_MISPRED,             // BR_MIS_PRED, PMEVCNTR3_EL0
+    PMU_NR_COUNTERS
+};
+
+// Event counters wrap at 32 bits; pmu_delta() handles one wrap
+#define PMU_EVCNT_MASK      0xFFFFFFFFULL
+
+struct pmu_sample {
+    uint64_t v[PMU_NR_COUNTERS];
+};
+
+// Set once pmu_init() has programmed the counters; never cleared, so a
+// begin/end pair always sees the same value
+extern bool pmu_active;
+
+// Set when the event counters are programmed as well as the cycle counter
+extern bool pmu_events_active;
+
+// Probe ID_AA64DFR0_EL1, program and start the counters. Returns 0, or -1
+// if the CPU has no PMUv3. Idempotent.
+int pmu_init(void);
+
+// Whether the CPU implements the event behind a counter (PMCEID0_EL0).
+// Unimplemented events count nothing.
+bool pmu_counter_supported(int counter);
+
+const char* pmu_counter_name(int counter);
+
+// ---- Sampling interrupt ----
+
+// PMU overflow PPI on QEMU virt (PPI 7)
+#define PMU_IRQ             23
+
+struct pt_regs;
+typedef void (*pmu_overflow_fn_t)(struct pt_regs* regs);
+
+// Raise fn (from IRQ context, with the interrupted frame) every period
+// CPU cycles, using a fifth event counter that counts CPU_CYCLES. The
+// counters above are not disturbed. Returns -1 if the PMU has fewer than
+// five event counters or the interrupt cannot be claimed.
+int pmu_overflow_start(uint32_t period, pmu_overflow_fn_t fn);
+void pmu_overflow_stop(void);
+
+// Snapshot all counters. Only call when pmu_active.
+static inline void pmu_read(struct pmu_sample* s) {
+    __asm__ volatile("isb\n"
+                     "mrs %0, pmccntr_el0" : "=r"(s->v[PMU_CYCLES]) :: "memory");
+    if (pmu_events_active) {
+        __asm__ volatile("mrs %0, pmevcntr0_el0\n"
+                         "mrs %1, pmevcntr1_el0\n"
+                         "mrs %2, pmevcntr2_el0\n"
+                         "mrs %3, pmevcntr3_el0"
+                         : "=r"(s->v[PMU_INSTRUCTIONS]), "=r"(s->v[PMU_L1D_REFILL]),
+                           "=r"(s->v[PMU_TLB_REFILL]), "=r"(s->v[PMU_BR_MISPRED]));
+    } else {
+        for (int i = PMU_INSTRUCTIONS; i < PMU_NR_COUNTERS; i++) {
+            s->v[i] = 0;
+        }
+    }
+}
+
+// d = end - start, per counter
+static inline void pmu_delta(struct pmu_sample* d, const struct pmu_sample* end,
+                             const struct pmu_sample* start) {
+    d->v[PMU_CYCLES] = end->v[PMU_CYCLES] - start->v[PMU_CYCLES];
+    for (int i = PMU_INSTRUCTIONS; i < PMU_NR_COUNTERS; i++) {
+        d->v[i] = (end->v[i] - start->v[i]) & PMU_EVCNT_MASK;
+    }
+}
+
+#endif /* PMU_H */
@@ -0,0 +1,25 @@
+#ifndef PRINTF_H
+#define PRINTF_H
+
+#include "types.h"
+
+// Freestanding formatted output. One engine backs every entry point.
+//
+// Conversions: %d %i %u %x %X %p %s %c %%
+// Flags:       '-' (left-justify), '0' (zero-pad), '+', ' ', '#' (0x prefix)
+// Width and precision, either literal or '*'
+// Length:      hh h (narrowed), l ll z j t (64-bit); plain ints are 32-bit
+//
+// The output is always NUL-terminated when size > 0. The return value is
+// the length the full string would have had (C99), so a result >= size
+// means it was truncated.
+int vsnprintf(char* buf, size_t size, const char* fmt, __builtin_va_list ap);
+int snprintf(char* buf, size_t size, const char* fmt, ...);
+
+// Same engine, arguments taken from an array of 64-bit words instead of a
+// va_list (one word per conversion, as klog stores them). 32-bit
+// conversions use the low half of their word. Missing words read as 0.
+int bstr_snprintf(char* buf, size_t size, const char* fmt,
+                  const uint64_t* args, int nargs);
+
+#endif /* PRINTF_H */
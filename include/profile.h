@@ -0,0 +1,61 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "types.h"
+
+// Statistical PC sampling profiler.
+//
+// Each sample is the interrupted ELR_EL1 (pt_regs.pc) taken from IRQ
+// context, optionally with return addresses from the frame-record chain
+// (build with FRAME_POINTER=1 for useful backtraces). Samples go to a
+// per-CPU ring that overwrites its oldest entries. profile_dump() prints
+// them grouped by identical stack for scripts/profile_symbolize.py, which
+// resolves addresses against build/kernel.elf.
+
+enum profile_source {
+    PROFILE_SRC_TIMER,          // Generic timer, period in Hz
+    PROFILE_SRC_PMU,            // PMU cycle-counter overflow, period in cycles
+};
+
+#define PROFILE_BACKTRACE   (1U << 0)   // Walk the frame-record chain
+
+#define PROFILE_BT_DEPTH    4
+#define PROFILE_BUF_ENTRIES 2048        // Samples per CPU (power of two)
+
+#define PROFILE_DEFAULT_HZ      1000
+#define PROFILE_DEFAULT_CYCLES  1000000
+
+#define PROFILE_SAMPLE_USER (1U << 0)   // Taken from EL0
+
+struct profile_sample {
+    uint64_t pc;
+    uint64_t bt[PROFILE_BT_DEPTH];      // Callers, 0-terminated
+    int32_t task;                       // Task id, -2 outside any task
+    uint32_t flags;                     // PROFILE_SAMPLE_*
+};
+
+struct pt_regs;
+
+// Start sampling; stops any previous session first. Returns 0, or -1 if
+// the source is not available.
+int profile_start(enum profile_source source, uint64_t period, unsigned int flags);
+void profile_stop(void);
+
+// Called from timer_interrupt() with the counter value it read
+void profile_timer_tick(uint64_t now);
+
+// Record one sample of regs (IRQ context)
+void profile_sample(struct pt_regs* regs);
+
+// Stop sampling, print the samples between PROFILE-BEGIN/PROFILE-END and
+// empty the rings
+void profile_dump(void);
+
+// This CPU's ring and the number of valid samples in it (selftests;
+// stop sampling first)
+const struct profile_sample* profile_samples(uint64_t* count);
+
+// Empty the rings without printing them
+void profile_clear(void);
+
+#endif /* PROFILE_H */
@@ -0,0 +1,40 @@
+#ifndef PTRACE_H
+#define PTRACE_H
+
+// Register frame pushed on the kernel stack by the exception entry code in
+// entry.S. Layout follows Linux's struct pt_regs so the offsets below can
+// be shared with assembly.
+#define S_X0            0
+#define S_X1            8
+#define S_X2            16
+#define S_X8            64
+#define S_LR            240     // x30
+#define S_SP            248     // SP_EL0 for EL0 entries, pre-exception SP for EL1
+#define S_PC            256     // ELR_EL1
+#define S_PSTATE        264     // SPSR_EL1
+#define S_FRAME_SIZE    272     // Multiple of 16 to keep SP aligned
+
+#ifndef __ASSEMBLER__
+
+#include "types.h"
+
+struct pt_regs {
+    uint64_t regs[31];
+    uint64_t sp;
+    uint64_t pc;
+    uint64_t pstate;
+};
+
+_Static_assert(sizeof(struct pt_regs) == S_FRAME_SIZE, "pt_regs layout out of sync with S_FRAME_SIZE");
+_Static_assert(__builtin_offsetof(struct pt_regs, sp) == S_SP, "pt_regs.sp offset");
+_Static_assert(__builtin_offsetof(struct pt_regs, pc) == S_PC, "pt_regs.pc offset");
+_Static_assert(__builtin_offsetof(struct pt_regs, pstate) == S_PSTATE, "pt_regs.pstate offset");
+
+// SPSR_EL1.M[3:0] == 0 means the exception was taken from EL0
+static inline int user_mode(const struct pt_regs* regs) {
+    return (regs->pstate & 0xF) == 0;
+}
+
+#endif
+
+#endif
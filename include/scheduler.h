@@ -3,10 +3,54 @@
 
 #include "task.h"  // For access to task_t
 
+// Default scheduler time slice (one-shot timer deadline); init_timer()
+// overrides it with its interval argument
+#define SCHED_SLICE_US  10000
+
+// Scheduling classes, one run-queue ring each. Low-priority tasks run
+// only when no normal task is runnable, except that after
+// SCHED_LOW_PRIO_STARVE consecutive normal picks one low task gets a
+// slice, so CPU-bound tasks cannot shut out background work for good.
+#define SCHED_PRIO_NORMAL       0
+#define SCHED_PRIO_LOW          1
+#define SCHED_NR_PRIO           2
+#define SCHED_LOW_PRIO_STARVE   16
+
+// Set by sched_start() once tasks own the CPU
+extern int scheduler_initialized;
+
+// Set from interrupt context when schedule() should run at IRQ exit
+extern volatile int need_resched;
+void set_need_resched(void);
+
+// Put a runnable task on the run queue, or take a task off it. Both are
+// idempotent and need IRQs masked; schedule() and wake_up_task() already
+// keep the queue in step with TASK_BLOCKED.
+void enqueue_task(task_t* task);
+void dequeue_task(task_t* task);
+
+// Move a task to another scheduling class (SCHED_PRIO_*)
+void sched_set_prio(task_t* task, int prio);
+
+// Make a TASK_BLOCKED task runnable and request a reschedule. Safe from
+// any context; returns 1 if the task was blocked.
+int wake_up_task(task_t* task);
+
 // Call this to perform a context switch to the next task
 void schedule();
 
+// Called by cpu_task_entry before a new task's body runs: closes the
+// context switch perf region and unmasks IRQs
+void schedule_tail(void);
+
+// Block the current task for at least the given number of microseconds
+void sleep_us(uint64_t us);
+
+// Block the current task for at least the given number of milliseconds
+void msleep(uint64_t ms);
+
 // Assembly-level context switch functions (defined in context.S)
+extern void cpu_switch_to(task_t* prev, task_t* next);
 extern void save_context(task_t* task);
 extern void restore_context(task_t* task);
 extern void full_restore_context(task_t* task);
@@ -17,6 +61,7 @@ task_t* pick_next_task(void);
 // New functions for task management
 uint64_t* task_alloc_page(void);
 void yield(void);
+void sched_start(void);
 void init_task_scheduler(void);
 
 // Scheduler test functions
@@ -0,0 +1,33 @@
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#include "types.h"
+#include "wait.h"
+
+// Counting semaphore. up() hands the unit directly to the first sleeper
+// instead of incrementing count, so a woken task never has to compete
+// for it again.
+struct semaphore {
+    volatile int count;
+    struct wait_queue_head wait;
+};
+
+#define SEMAPHORE_INIT(n)   { (n), WAIT_QUEUE_HEAD_INIT }
+
+#define DEFINE_SEMAPHORE(name, n) struct semaphore name = SEMAPHORE_INIT(n)
+
+static inline void sema_init(struct semaphore* sem, int count) {
+    sem->count = count;
+    init_waitqueue_head(&sem->wait);
+}
+
+// Take a unit, sleeping until one is available (task context)
+void down(struct semaphore* sem);
+
+// Take a unit if one is available; returns 1 on success. Any context.
+int down_trylock(struct semaphore* sem);
+
+// Release a unit. Safe from IRQ and softirq context.
+void up(struct semaphore* sem);
+
+#endif
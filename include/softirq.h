@@ -0,0 +1,33 @@
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include "types.h"
+
+// Deferred interrupt work, run at the outermost IRQ exit after EOI with
+// IRQs unmasked. Lower numbers run first.
+enum {
+    TIMER_SOFTIRQ = 0,      // Timer wheel expiry
+    UART_RX_SOFTIRQ,        // Wake readers of the PL011 RX ring
+    NR_SOFTIRQS
+};
+
+// Rounds of newly raised softirqs handled per IRQ exit before the rest
+// is handed to the workqueue
+#define SOFTIRQ_MAX_RESTART 10
+
+typedef void (*softirq_action_t)(void);
+
+// Install the action for softirq nr (boot time)
+void open_softirq(unsigned int nr, softirq_action_t action);
+
+// Mark softirq nr pending on this CPU; safe from any context
+void raise_softirq(unsigned int nr);
+
+// Run pending softirqs unless already inside one. Called from irq_exit()
+// with IRQs masked; returns with IRQs masked.
+void do_softirq(void);
+
+// Nonzero while this CPU is running softirq actions
+unsigned int in_softirq(void);
+
+#endif
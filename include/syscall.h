@@ -1,25 +1,62 @@
 #pragma once
-#include "types.h"
+
+// Syscall ABI (Linux style): number in x8, arguments in x0-x5, result in
+// x0. Issued as "svc #0" from EL0. Kernel code may issue "svc #SVC_IMM_KERNEL"
+// to take the same frame/dispatch/eret path from EL1 (benchmarks).
+#define SVC_IMM_KERNEL  0x4B
 
 // Syscall numbers
 #define SYS_HELLO   0
 #define SYS_WRITE   1
 #define SYS_EXIT    2
 #define SYS_YIELD   3
+#define SYS_NANOSLEEP 4
+#define SYS_GETPID  5
+#define SYS_SYSCALL_STATS 6
+#define NR_SYSCALLS 7
+
+// SYS_SYSCALL_STATS(nr, which): which counter to return for syscall nr
+#define SYSCALL_STAT_COUNT   0      // Calls
+#define SYSCALL_STAT_CYCLES  1      // Cumulative CNTVCT ticks spent in the handler
+
+#define EBADF       9
+#define EFAULT      14
+#define EINVAL      22
+#define ENOSYS      38
+
+// SYS_WRITE file descriptors
+#define STDOUT_FILENO   1
+#define STDERR_FILENO   2
+
+#ifndef __ASSEMBLER__
 
-// Called by trap handler
-// Basic trap frame structure - will be expanded in Step 4
-struct trap_frame {
-    // General purpose registers
-    uint64_t x0;
-    // Other registers will be added in Step 4
+#include "types.h"
+#include "ptrace.h"
+
+// Syscall dispatch, called from el0_sync/el1_sync in entry.S with the full
+// trap frame (x0-x30, SP_EL0, ELR_EL1, SPSR_EL1). The return value is
+// written back to the frame's x0.
+uint64_t syscall_dispatch(uint64_t num, struct pt_regs* regs);
+
+// Per-syscall counters, kept per CPU and summed on read
+struct syscall_stat {
+    uint64_t count;
+    uint64_t cycles;
 };
 
-// Syscall dispatch function
-void syscall_dispatch(uint64_t num, struct trap_frame* tf);
+// Fill *out with the totals for syscall nr; returns -1 if nr is invalid
+int syscall_get_stats(unsigned int nr, struct syscall_stat* out);
+
+// Runtime switch for the per-call UART trace (off by default)
+void syscall_set_trace(int enable);
 
 // Individual syscall handlers
 void sys_hello(void);
-void sys_write(uint64_t arg0);
+uint64_t sys_write(uint64_t fd, const void* buf, size_t len);
 void sys_exit(uint64_t exit_code);
 void sys_yield(void);
+void sys_nanosleep(uint64_t ns);
+uint64_t sys_getpid(void);
+uint64_t sys_syscall_stats(uint64_t nr, uint64_t which);
+
+#endif
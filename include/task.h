@@ -1,11 +1,43 @@
 #ifndef TASK_H
 #define TASK_H
 
-#include "../include/types.h"
-
-#define TASK_STATE_READY   0
-#define TASK_STATE_RUNNING 1
 #define MAX_TASKS          8
+#define CACHE_LINE_SIZE    64
+
+// task_t layout, shared with context.S (checked by static asserts in task.c)
+//
+//   line 0      hot scheduling header: next, state, id, wake_at, prev, prio
+//   lines 1-6   register save area, 64-byte aligned
+//   line 7      cold metadata: name, entry_point
+//
+// Run-queue operations only touch next/prev/state/prio, one line per task.
+#define TASK_NEXT          0
+#define TASK_STATE         8
+#define TASK_ID            12
+#define TASK_WAKE_AT       16
+#define TASK_PREV          24
+#define TASK_PRIO          32
+#define TASK_REGSAVE       64      // start of the register save area
+#define TASK_CONTEXT       64      // cpu_context_t for cpu_switch_to()
+#define TASK_STACK_PTR     176
+#define TASK_REGS          184     // regs[0] (x0); regs[n] at TASK_REGS + 8*n
+#define TASK_PC            432
+#define TASK_SPSR          440
+#define TASK_COLD          448     // start of cold metadata
+
+// Offsets inside cpu_context_t
+#define CTX_X19            0
+#define CTX_X21            16
+#define CTX_X23            32
+#define CTX_X25            48
+#define CTX_X27            64
+#define CTX_FP             80      // x29 and x30 (LR) stored as a pair
+#define CTX_SP             96      // SP and TPIDR_EL1 stored as a pair
+
+#ifndef __ASSEMBLER__
+
+#include "../include/types.h"
+#include "../include/pmu.h"
 
 // Task state enum for better readability
 typedef enum {
@@ -15,20 +47,45 @@ typedef enum {
     TASK_BLOCKED
 } task_state_t;
 
-typedef struct task {
-    uint64_t* stack_ptr;       // Stack pointer
-    uint64_t regs[31];         // General-purpose registers
-    uint64_t pc;               // Program counter
-    uint64_t spsr;             // Saved program status
+// Legacy names for the task states
+#define TASK_STATE_READY   TASK_READY
+#define TASK_STATE_RUNNING TASK_RUNNING
+
+// Callee-saved state switched by cpu_switch_to(). Everything else is
+// caller-saved under AAPCS64 and already lives on the task's own stack.
+typedef struct cpu_context {
+    uint64_t x19, x20, x21, x22, x23;
+    uint64_t x24, x25, x26, x27, x28;
+    uint64_t fp;               // x29
+    uint64_t lr;               // x30 - resume address
+    uint64_t sp;
+    uint64_t tpidr;            // TPIDR_EL1
+} cpu_context_t;
 
+typedef struct task {
+    /* ---- Hot: scheduling header (cache line 0) ---- */
+    struct task* next;         // Run-queue ring, NULL when not queued
+    int state;                 // task_state_t
     int id;
-    int state;
-    
+    uint64_t wake_at;          // Sleep deadline in counter ticks, 0 if none
+    struct task* prev;         // Run-queue ring, NULL when not queued
+    int prio;                  // SCHED_PRIO_* (scheduler.h), picks the ring
+
+    /* ---- Register save area (context.S only) ---- */
+    struct {
+        cpu_context_t context;     // Kernel context for cpu_switch_to()
+        uint64_t* stack_ptr;       // Stack pointer
+        uint64_t regs[31];         // General-purpose registers
+        uint64_t pc;               // Program counter
+        uint64_t spsr;             // Saved program status
+    } __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    /* ---- Cold: metadata ---- */
     char name[16];             // Task name
     void (*entry_point)(void); // Function pointer for task entry point
-
-    struct task* next;
-} task_t;
+    struct pmu_sample perf;    // PMU counts while on the CPU (perf.h)
+    struct pmu_sample perf_in; // Counters at the last switch-in
+} __attribute__((aligned(CACHE_LINE_SIZE))) task_t;
 
 extern task_t* current_task;
 extern int task_count;
@@ -39,6 +96,7 @@ void init_tasks();
 void create_task(void (*entry_point)());
 void create_el0_task(void (*entry_point)()); // Create a task that runs in EL0 mode
 void start_user_task(void (*entry_point)(void)); // Directly start a user task in EL0 mode
+void task_init_context(task_t* task, void (*entry_point)(void), uint64_t* stack_top);
 void dummy_task_a(void);  // Dummy task function
 void dummy_task_b(void);  // Dummy task function
 
@@ -49,4 +107,6 @@ void task_b(void) __attribute__((noreturn));
 // Utility functions used in task initialization
 extern void debug_print(const char* msg);
 
+#endif /* __ASSEMBLER__ */
+
 #endif
@@ -3,15 +3,94 @@
 
 #include "interrupts.h" // Include interrupts.h for IRQ control functions
 
+#include "types.h"
+
+// EL1 virtual timer (CNTV) PPI. The virtual timer counts CNTVCT_EL0, the
+// same counter as the clocksource.
+#define TIMER_IRQ_ID       27
+
+// Deadline value meaning "nothing pending"
+#define TIMER_NO_DEADLINE  (~0ULL)
+
+// Initialize the ARM generic timer and GIC (timer starts in one-shot mode)
+void timer_init(void);
+
 // Initialize timer with the specified interval in milliseconds
 void init_timer(int ms_interval);
 
+// ---- One-shot clockevent interface ----
+
+// Current CNTVCT_EL0 value and its frequency in Hz
+uint64_t timer_read_counter(void);
+uint64_t timer_get_frequency(void);
+
+// Convert microseconds to counter ticks (rounded up)
+uint64_t timer_us_to_ticks(uint64_t us);
+
+// Scheduler slice length: set in nanoseconds, read back in counter ticks
+// (defaults to SCHED_SLICE_US)
+void timer_set_slice_interval(uint64_t ns);
+uint64_t timer_slice_ticks(void);
+
+// Set/cancel the current slice end (absolute counter value)
+void timer_set_slice_deadline(uint64_t deadline);
+
+// Request an interrupt at or before an absolute counter deadline
+void timer_request_wakeup(uint64_t deadline);
+
+// Stop the periodic scheduler tick while idle
+void timer_stop_tick(void);
+
+// Timer interrupt top half - dispatched by handle_irq() before EOI
+void timer_interrupt(void);
+
+// ---- Timer wheel (kernel/core/time/timer_wheel.c) ----
+
+// Callback run from the timer interrupt with IRQs masked
+typedef void (*timer_fn_t)(void* arg);
+
+// A pending timer. Embed one (zero-initialised) in your own structure and
+// use timer_start(), or let timer_add() take one from the pool.
+typedef struct ktimer {
+    struct ktimer* next;       // Bucket list
+    struct ktimer** pprev;     // Link pointing at us, NULL when not pending
+    uint64_t expires;          // Absolute deadline in counter ticks
+    timer_fn_t fn;
+    void* arg;
+    uint32_t flags;
+} ktimer_t;
+
+// Number of timers timer_add() can have pending at once
+#define TIMER_POOL_SIZE  1024
+
+// Arm a caller-owned timer for an absolute counter deadline (O(1))
+void timer_start(ktimer_t* timer, uint64_t deadline, timer_fn_t fn, void* arg);
+
+// Arm a pooled timer; returns NULL when the pool is exhausted. The handle
+// is only valid for timer_cancel() until the callback has run.
+ktimer_t* timer_add(uint64_t deadline, timer_fn_t fn, void* arg);
+
+// Remove a pending timer (O(1)). Returns 1 if it was pending.
+int timer_cancel(ktimer_t* timer);
+
+// Returns 1 if the timer is armed and has not fired yet
+static inline int timer_pending(const ktimer_t* timer) {
+    return timer->pprev != NULL;
+}
+
+// Run expired timers and re-request the next wheel deadline (TIMER_SOFTIRQ)
+void timer_wheel_run(uint64_t now);
+
 // Function to acknowledge/clear the timer interrupt
 void timer_ack(void);
 
 // Function to manually force a timer interrupt (for testing)
 void force_timer_interrupt(void);
 
+// Set the timer PPI pending at the GIC, as force_timer_interrupt() does,
+// without its output and wait
+void timer_raise_pending(void);
+
 // Initialize the timer, sets up the interrupt, and configures GIC
 void init_timer_irq(void);
 
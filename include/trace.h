@@ -0,0 +1,108 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "types.h"
+
+// Static tracepoints.
+//
+// Every trace_*() call compiles to a single NOP in line with the caller;
+// the record-writing code sits behind it, out of the fall-through path.
+// trace_enable() patches the NOP of each selected site into a branch to
+// that code, so a disabled tracepoint costs one NOP and no loads.
+//
+// Records are fixed-size and carry the raw CNTVCT_EL0 value. They go to a
+// per-CPU ring that overwrites its oldest entries; trace_dump() prints the
+// rings for scripts/trace_to_perfetto.py.
+
+enum trace_event {
+    TRACE_SCHED_SWITCH,     // arg0 next id, arg1 prev id, arg2 prev state
+    TRACE_IRQ_ENTRY,        // arg0 INTID
+    TRACE_IRQ_EXIT,         // arg0 INTID
+    TRACE_SYSCALL,          // arg0 number, arg1 return value, arg2 entry CNTVCT
+    TRACE_PMM_ALLOC,        // arg0 pages, arg1 physical address
+    TRACE_NR_EVENTS
+};
+
+#define TRACE_ALL           ((1U << TRACE_NR_EVENTS) - 1)
+
+// Records per CPU (power of two)
+#define TRACE_BUF_ENTRIES   4096
+
+// Layout is mirrored by scripts/trace_to_perfetto.py
+struct trace_record {
+    uint64_t ts;            // CNTVCT_EL0
+    uint16_t event;
+    uint16_t cpu;
+    uint32_t arg0;
+    uint64_t arg1;
+    uint64_t arg2;
+};
+
+struct trace_key {
+    volatile int enabled;
+};
+
+// One per call site, collected into __trace_sites by the linker
+struct trace_site {
+    uint64_t code;          // Address of the NOP
+    uint64_t target;        // Where the branch goes when enabled
+    struct trace_key* key;
+};
+
+extern struct trace_key trace_keys[TRACE_NR_EVENTS];
+
+// The NOP and its site entry. Must be inlined so every caller gets its
+// own site and key is a link-time constant.
+static inline __attribute__((always_inline)) int trace_site_enabled(struct trace_key* key) {
+    __asm__ goto("1: nop\n\t"
+                 ".pushsection __trace_sites, \"aw\"\n\t"
+                 ".balign 8\n\t"
+                 ".quad 1b, %l[enabled], %c0\n\t"
+                 ".popsection"
+                 :: "i"(key) :: enabled);
+    return 0;
+enabled:
+    return 1;
+}
+
+#define TRACE_SITE(event)   trace_site_enabled(&trace_keys[event])
+
+void __trace_record(uint16_t event, uint32_t arg0, uint64_t arg1, uint64_t arg2);
+
+// Patch the sites of every event in mask (1 << TRACE_*) to record, and
+// every other site back to a NOP
+void trace_enable(uint32_t mask);
+
+// Records currently held in all rings
+uint64_t trace_buffered(void);
+
+// Print the rings between TRACE-BEGIN/TRACE-END markers and empty them.
+// Tracing is paused while dumping and resumed afterwards.
+void trace_dump(void);
+
+static inline void trace_sched_switch(uint32_t prev_id, uint32_t next_id, uint64_t prev_state) {
+    if (TRACE_SITE(TRACE_SCHED_SWITCH))
+        __trace_record(TRACE_SCHED_SWITCH, next_id, prev_id, prev_state);
+}
+
+static inline void trace_irq_entry(uint32_t intid) {
+    if (TRACE_SITE(TRACE_IRQ_ENTRY))
+        __trace_record(TRACE_IRQ_ENTRY, intid, 0, 0);
+}
+
+static inline void trace_irq_exit(uint32_t intid) {
+    if (TRACE_SITE(TRACE_IRQ_EXIT))
+        __trace_record(TRACE_IRQ_EXIT, intid, 0, 0);
+}
+
+static inline void trace_syscall(uint64_t nr, uint64_t ret, uint64_t entry_ts) {
+    if (TRACE_SITE(TRACE_SYSCALL))
+        __trace_record(TRACE_SYSCALL, (uint32_t)nr, ret, entry_ts);
+}
+
+static inline void trace_pmm_alloc(uint64_t addr, uint32_t pages) {
+    if (TRACE_SITE(TRACE_PMM_ALLOC))
+        __trace_record(TRACE_PMM_ALLOC, pages, addr, 0);
+}
+
+#endif /* TRACE_H */
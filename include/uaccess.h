@@ -0,0 +1,14 @@
+#ifndef UACCESS_H
+#define UACCESS_H
+
+#include "types.h"
+
+// Nonzero if EL0 may read every byte of [uaddr, uaddr + len) under the
+// current translation tables (checked per page with AT S1E0R)
+int access_ok(const void* uaddr, size_t len);
+
+// Copy n bytes from user space after checking them with access_ok().
+// Returns the number of bytes NOT copied: 0 on success, n on a fault.
+size_t copy_from_user(void* dst, const void* usrc, size_t n);
+
+#endif
@@ -52,7 +52,7 @@
 // Global flag to track MMU status
 extern bool mmu_enabled;
 
-// Global string buffers for MMU transition safety
+// Staging buffers for uart_puts_late() during the MMU transition window
 extern volatile char global_string_buffer[];
 extern volatile char global_temp_buffer[];
 
@@ -109,6 +109,40 @@ void uart_putx(uint64_t value);
 void uart_putc_raw(char c);
 void uart_panic(const char* str);
 
+// Interrupt-driven I/O - located in uart_irq.c. Ring sizes must be powers
+// of two.
+#define UART_TX_RING_SIZE   4096
+#define UART_RX_RING_SIZE   1024
+
+// Route the PL011 TX/RX interrupts through the GIC and switch uart_write()
+// and uart_putc() from polling to the TX ring
+void uart_irq_init(void);
+int uart_tx_irq_enabled(void);
+
+// Queue up to len bytes for transmission without waiting for the UART;
+// returns how many were taken (all of them, polled, before uart_irq_init())
+size_t uart_write(const void* buf, size_t len);
+
+// uart_write() with the TX interrupt armed up front, so it fires even if
+// the FIFO accepts everything immediately; for checking the IRQ route
+size_t uart_write_tx_armed(const void* buf, size_t len);
+
+// TX interrupts serviced since uart_irq_init()
+uint64_t uart_tx_irq_count(void);
+
+// Wait until the TX ring has room. Sleeps in task context; with IRQs
+// masked or in interrupt context it polls one FIFO's worth out instead.
+void uart_tx_wait_room(void);
+
+// Copy out up to len received bytes. uart_read() never blocks;
+// uart_read_wait() sleeps until at least one byte is available, or
+// polls the RX FIFO if uart_irq_init() has not run yet.
+size_t uart_read(void* buf, size_t len);
+size_t uart_read_wait(void* buf, size_t len);
+
+// Received bytes lost to a full RX ring or a FIFO overrun
+uint64_t uart_rx_dropped_count(void);
+
 // UART base address update function - called during MMU transition
 void uart_set_base(void* addr);
 
@@ -0,0 +1,33 @@
+#ifndef VDSO_H
+#define VDSO_H
+
+#include "types.h"
+
+// Fixed EL0 address of the read-only time data page; inside the TTBR0
+// range for both the 39- and 48-bit VA layouts
+#define VDSO_USER_VA    0x0000007FFFFFE000UL
+
+#define VDSO_DATA_VERSION   1
+
+// Published by the kernel, read by EL0 without a syscall:
+//
+//   ns = (CNTVCT_EL0 * mult) >> shift
+//
+// is on the kernel's ktime_get_ns() time base (needs CNTKCTL_EL1.EL0VCTEN,
+// which timer_init() sets). seq is odd while the kernel updates the other
+// fields, so a reader retries until it sees the same even value before
+// and after its reads. The page is filled before it is mapped and never
+// changes yet, but readers must follow the protocol.
+struct vdso_data {
+    volatile uint32_t seq;
+    uint32_t version;          // VDSO_DATA_VERSION
+    uint64_t freq;             // CNTFRQ_EL0, Hz
+    uint64_t mult;
+    uint32_t shift;
+    uint32_t pad;
+};
+
+// Map the data page into EL0 and publish the clocksource (timer_init())
+void vdso_init(void);
+
+#endif
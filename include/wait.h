@@ -0,0 +1,69 @@
+#ifndef WAIT_H
+#define WAIT_H
+
+#include "types.h"
+#include "task.h"
+#include "interrupts.h"
+
+// Wait queues: tasks sleep in TASK_BLOCKED, off the CPU, until another
+// task or an interrupt wakes them. Entries live on the sleeper's stack and
+// are doubly linked, so enqueue, dequeue and waking the first waiter are
+// all O(1).
+//
+// The queues are protected by masking IRQs; with NR_CPUS == 1 that is
+// enough to exclude every other context that could touch them.
+struct wait_queue_entry {
+    struct wait_queue_entry* next;
+    struct wait_queue_entry* prev;
+    task_t* task;               // NULL for the boot thread
+    volatile int woken;         // Set by the waker after dequeueing
+};
+
+struct wait_queue_head {
+    struct wait_queue_entry* first;
+    struct wait_queue_entry* last;
+};
+
+#define WAIT_QUEUE_HEAD_INIT    { NULL, NULL }
+
+#define DECLARE_WAIT_QUEUE_HEAD(name) \
+    struct wait_queue_head name = WAIT_QUEUE_HEAD_INIT
+
+static inline void init_waitqueue_head(struct wait_queue_head* wq) {
+    wq->first = NULL;
+    wq->last = NULL;
+}
+
+static inline int waitqueue_active(const struct wait_queue_head* wq) {
+    return wq->first != NULL;
+}
+
+// Low-level interface, IRQs must be masked by the caller. prepare_to_wait()
+// queues the current task at the tail and marks it TASK_BLOCKED;
+// wait_block() switches away until the entry is woken; finish_wait()
+// dequeues it if nobody else did (wakeups that raced with a timeout or a
+// condition that became true on its own).
+void prepare_to_wait(struct wait_queue_head* wq, struct wait_queue_entry* wait);
+void wait_block(struct wait_queue_entry* wait);
+void finish_wait(struct wait_queue_head* wq, struct wait_queue_entry* wait);
+
+// Wake the first waiter / every waiter. Safe from any context, including
+// IRQ and softirq handlers. Return the number of tasks woken.
+int wake_up(struct wait_queue_head* wq);
+int wake_up_all(struct wait_queue_head* wq);
+
+// Sleep until cond is true. cond is evaluated with IRQs masked, so a
+// waker that sets it and calls wake_up() from an interrupt cannot be lost
+// between the check and the block.
+#define wait_event(wq, cond) do {                                   \
+        struct wait_queue_entry __wait;                             \
+        unsigned long __flags = local_irq_save();                   \
+        while (!(cond)) {                                           \
+            prepare_to_wait(&(wq), &__wait);                        \
+            wait_block(&__wait);                                    \
+            finish_wait(&(wq), &__wait);                            \
+        }                                                           \
+        local_irq_restore(__flags);                                 \
+    } while (0)
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include "types.h"
+
+// Deferred work that may take long or block, run by a per-CPU worker
+// kernel thread in task context
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct* work);
+
+struct work_struct {
+    struct work_struct* next;
+    work_func_t func;
+    volatile int pending;
+};
+
+#define INIT_WORK(w, f) do {    \
+        (w)->next = NULL;       \
+        (w)->func = (f);        \
+        (w)->pending = 0;       \
+    } while (0)
+
+// Queue work on this CPU's worker. Safe from IRQ and softirq context.
+// Returns 0 if it was already queued and has not started yet.
+int queue_work(struct work_struct* work);
+
+// Create the worker threads (after the scheduler's task table is set up)
+void workqueue_init(void);
+
+#endif
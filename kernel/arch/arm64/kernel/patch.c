@@ -0,0 +1,59 @@
+/*
+ * patch.c - Single-instruction kernel text patching
+ *
+ * Kernel text is mapped PTE_KERN_TEXT (read-only) once the MMU is up, so
+ * the new instruction is written through a writable, non-executable alias
+ * of the same physical page. Text is identity mapped, which makes the
+ * alias target simply the page of the instruction's address. The alias
+ * is torn down again before returning, so no writable mapping of text
+ * outlives the patch. A 32-bit aligned store is single-copy atomic, so a
+ * CPU executing the site sees either the old or the new instruction,
+ * never a mix.
+ */
+
+#include "../../../../include/patch.h"
+#include "../../../../include/pmm.h"
+#include "../../../../include/memory_config.h"
+#include "../../../../include/interrupts.h"
+
+// Scratch kernel VA for the alias, two pages below the vDSO data page
+#define TEXT_POKE_VA    0x0000007FFFFFC000UL
+
+uint32_t aarch64_insn_gen_branch(uint64_t pc, uint64_t target) {
+    int64_t offset = (int64_t)(target - pc);
+
+    return 0x14000000U | ((uint32_t)(offset >> 2) & 0x03FFFFFFU);
+}
+
+int aarch64_insn_patch_text(void* addr, uint32_t insn) {
+    uint64_t va = (uint64_t)addr;
+    volatile uint32_t* dst = (volatile uint32_t*)addr;
+
+    if (va & 3) {
+        return -1;
+    }
+
+    unsigned long flags = local_irq_save();
+
+    if (mmu_enabled) {
+        map_kernel_page(TEXT_POKE_VA, va & ~(uint64_t)(PAGE_SIZE - 1), PTE_KERN_DATA);
+        dst = (volatile uint32_t*)(TEXT_POKE_VA + (va & (PAGE_SIZE - 1)));
+    }
+    *dst = insn;
+
+    // Clean the written line to the point of unification, then drop any
+    // stale copy of the executed VA from the I-cache
+    __asm__ volatile("dc cvau, %0\n"
+                     "dsb ish\n"
+                     "ic ivau, %1\n"
+                     "dsb ish\n"
+                     "isb"
+                     :: "r"(dst), "r"(addr) : "memory");
+
+    if (mmu_enabled) {
+        unmap_kernel_page(TEXT_POKE_VA);
+    }
+
+    local_irq_restore(flags);
+    return 0;
+}
@@ -0,0 +1,371 @@
+/*
+ * printf.c - Freestanding vsnprintf engine
+ *
+ * Every formatted-output path in the kernel ends up here: snprintf(), the
+ * klog drain (bstr_snprintf(), arguments from stored words) and the
+ * uart/early-console hex helpers. Integers are converted right to left
+ * into a small stack buffer; decimal emits two digits per division using
+ * a "00".."99" pair table, hex is a shift and a nibble-table lookup.
+ */
+
+#include "../../../../include/printf.h"
+
+#define PF_LEFT     0x01    // '-'
+#define PF_ZERO     0x02    // '0'
+#define PF_PLUS     0x04    // '+'
+#define PF_SPACE    0x08    // ' '
+#define PF_ALT      0x10    // '#'
+
+// Length modifiers
+#define LEN_HH      0
+#define LEN_H       1
+#define LEN_INT     2
+#define LEN_LONG    3       // l, ll, z, j, t: all 64-bit here
+
+static const char digit_pairs[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char hex_lower[16] = "0123456789abcdef";
+static const char hex_upper[16] = "0123456789ABCDEF";
+
+struct pf_out {
+    char* buf;
+    size_t size;
+    size_t len;             // Would-be length; may exceed size
+};
+
+// Argument source: a va_list, or an array of 64-bit words
+struct pf_args {
+    __builtin_va_list* ap;
+    const uint64_t* words;
+    int nwords;
+    int next;
+};
+
+static inline void out_char(struct pf_out* o, char c) {
+    if (o->len + 1 < o->size) {
+        o->buf[o->len] = c;
+    }
+    o->len++;
+}
+
+static void out_mem(struct pf_out* o, const char* s, size_t n) {
+    while (n--) {
+        out_char(o, *s++);
+    }
+}
+
+static void out_fill(struct pf_out* o, char c, int n) {
+    while (n-- > 0) {
+        out_char(o, c);
+    }
+}
+
+static uint64_t next_arg(struct pf_args* a, int len) {
+    if (a->ap) {
+        if (len == LEN_LONG) {
+            return __builtin_va_arg(*a->ap, uint64_t);
+        }
+        return __builtin_va_arg(*a->ap, unsigned int);
+    }
+    if (a->next >= a->nwords) {
+        return 0;
+    }
+    return a->words[a->next++];
+}
+
+static const char* next_ptr_arg(struct pf_args* a) {
+    if (a->ap) {
+        return __builtin_va_arg(*a->ap, const char*);
+    }
+    return (const char*)(uintptr_t)next_arg(a, LEN_LONG);
+}
+
+// Write v in decimal ending just before end; returns the first digit
+static char* fmt_dec(char* end, uint64_t v) {
+    char* p = end;
+
+    while (v >= 100) {
+        uint64_t q = v / 100;
+        unsigned int r = (unsigned int)(v - q * 100);
+        p -= 2;
+        p[0] = digit_pairs[2 * r];
+        p[1] = digit_pairs[2 * r + 1];
+        v = q;
+    }
+    if (v >= 10) {
+        p -= 2;
+        p[0] = digit_pairs[2 * v];
+        p[1] = digit_pairs[2 * v + 1];
+    } else {
+        *--p = (char)('0' + v);
+    }
+    return p;
+}
+
+static char* fmt_hex(char* end, uint64_t v, const char* digits) {
+    char* p = end;
+
+    do {
+        *--p = digits[v & 0xF];
+        v >>= 4;
+    } while (v);
+    return p;
+}
+
+// Narrow/sign-extend a raw argument word to the conversion's length
+static uint64_t narrow(uint64_t v, int len, int is_signed) {
+    switch (len) {
+    case LEN_HH:
+        return is_signed ? (uint64_t)(int64_t)(signed char)v : (unsigned char)v;
+    case LEN_H:
+        return is_signed ? (uint64_t)(int64_t)(short)v : (unsigned short)v;
+    case LEN_INT:
+        return is_signed ? (uint64_t)(int64_t)(int)v : (unsigned int)v;
+    default:
+        return v;
+    }
+}
+
+static void emit_number(struct pf_out* o, uint64_t v, int base, int upper,
+                        int is_signed, int flags, int width, int prec) {
+    char tmp[24];
+    char* end = tmp + sizeof(tmp);
+    char prefix[2];
+    int plen = 0;
+    char* s;
+    int n;
+
+    if (is_signed) {
+        if ((int64_t)v < 0) {
+            prefix[plen++] = '-';
+            v = 0 - v;
+        } else if (flags & PF_PLUS) {
+            prefix[plen++] = '+';
+        } else if (flags & PF_SPACE) {
+            prefix[plen++] = ' ';
+        }
+    } else if ((flags & PF_ALT) && base == 16 && v) {
+        prefix[plen++] = '0';
+        prefix[plen++] = upper ? 'X' : 'x';
+    }
+
+    if (prec == 0 && v == 0) {
+        s = end;            // "%.0d" of zero prints no digits
+    } else if (base == 10) {
+        s = fmt_dec(end, v);
+    } else {
+        s = fmt_hex(end, v, upper ? hex_upper : hex_lower);
+    }
+    n = (int)(end - s);
+
+    int zeros = prec > n ? prec - n : 0;
+    int pad = width - plen - zeros - n;
+
+    // '0' is ignored with '-' or an explicit precision
+    if ((flags & PF_ZERO) && !(flags & PF_LEFT) && prec < 0 && pad > 0) {
+        zeros += pad;
+        pad = 0;
+    }
+
+    if (!(flags & PF_LEFT)) {
+        out_fill(o, ' ', pad);
+    }
+    out_mem(o, prefix, plen);
+    out_fill(o, '0', zeros);
+    out_mem(o, s, n);
+    if (flags & PF_LEFT) {
+        out_fill(o, ' ', pad);
+    }
+}
+
+static void emit_str(struct pf_out* o, const char* s, int flags, int width, int prec) {
+    int n = 0;
+
+    if (!s) {
+        s = "(null)";
+    }
+    while ((prec < 0 || n < prec) && s[n]) {
+        n++;
+    }
+    if (!(flags & PF_LEFT)) {
+        out_fill(o, ' ', width - n);
+    }
+    out_mem(o, s, n);
+    if (flags & PF_LEFT) {
+        out_fill(o, ' ', width - n);
+    }
+}
+
+static int pf_format(char* buf, size_t size, const char* fmt, struct pf_args* a) {
+    struct pf_out o = { buf, size, 0 };
+
+    while (*fmt) {
+        // Copy the literal run up to the next conversion
+        const char* lit = fmt;
+        while (*fmt && *fmt != '%') {
+            fmt++;
+        }
+        out_mem(&o, lit, fmt - lit);
+        if (!*fmt) {
+            break;
+        }
+
+        const char* spec = fmt++;     // At '%'
+        int flags = 0;
+        int width = 0;
+        int prec = -1;
+        int len = LEN_INT;
+
+        for (;; fmt++) {
+            if (*fmt == '-') flags |= PF_LEFT;
+            else if (*fmt == '0') flags |= PF_ZERO;
+            else if (*fmt == '+') flags |= PF_PLUS;
+            else if (*fmt == ' ') flags |= PF_SPACE;
+            else if (*fmt == '#') flags |= PF_ALT;
+            else break;
+        }
+
+        if (*fmt == '*') {
+            width = (int)next_arg(a, LEN_INT);
+            if (width < 0) {
+                flags |= PF_LEFT;
+                width = -width;
+            }
+            fmt++;
+        } else {
+            while (*fmt >= '0' && *fmt <= '9') {
+                width = width * 10 + (*fmt++ - '0');
+            }
+        }
+
+        if (*fmt == '.') {
+            fmt++;
+            prec = 0;
+            if (*fmt == '*') {
+                prec = (int)next_arg(a, LEN_INT);
+                if (prec < 0) {
+                    prec = -1;
+                }
+                fmt++;
+            } else {
+                while (*fmt >= '0' && *fmt <= '9') {
+                    prec = prec * 10 + (*fmt++ - '0');
+                }
+            }
+        }
+
+        switch (*fmt) {
+        case 'h':
+            len = LEN_H;
+            if (*++fmt == 'h') {
+                len = LEN_HH;
+                fmt++;
+            }
+            break;
+        case 'l':
+            len = LEN_LONG;
+            if (*++fmt == 'l') {
+                fmt++;
+            }
+            break;
+        case 'z':
+        case 'j':
+        case 't':
+            len = LEN_LONG;
+            fmt++;
+            break;
+        }
+
+        char c = *fmt;
+        if (!c) {
+            out_mem(&o, spec, fmt - spec);    // Dangling '%' at end of format
+            break;
+        }
+        fmt++;
+
+        switch (c) {
+        case 'd':
+        case 'i':
+            emit_number(&o, narrow(next_arg(a, len), len, 1), 10, 0, 1,
+                        flags, width, prec);
+            break;
+        case 'u':
+            emit_number(&o, narrow(next_arg(a, len), len, 0), 10, 0, 0,
+                        flags, width, prec);
+            break;
+        case 'x':
+        case 'X':
+            emit_number(&o, narrow(next_arg(a, len), len, 0), 16, c == 'X', 0,
+                        flags, width, prec);
+            break;
+        case 'p':
+            emit_number(&o, (uintptr_t)next_ptr_arg(a), 16, 0, 0,
+                        flags | PF_ALT, width, prec);
+            break;
+        case 's':
+            emit_str(&o, next_ptr_arg(a), flags, width, prec);
+            break;
+        case 'c': {
+            char ch = (char)next_arg(a, LEN_INT);
+            if (!(flags & PF_LEFT)) {
+                out_fill(&o, ' ', width - 1);
+            }
+            out_char(&o, ch);
+            if (flags & PF_LEFT) {
+                out_fill(&o, ' ', width - 1);
+            }
+            break;
+        }
+        case '%':
+            out_char(&o, '%');
+            break;
+        default:
+            // Unknown conversion: print it verbatim
+            out_mem(&o, spec, fmt - spec);
+            break;
+        }
+    }
+
+    if (size) {
+        buf[o.len < size ? o.len : size - 1] = '\0';
+    }
+    return (int)o.len;
+}
+
+int vsnprintf(char* buf, size_t size, const char* fmt, __builtin_va_list ap) {
+    __builtin_va_list cp;
+    int n;
+
+    // Work on a copy: a va_list parameter cannot portably be addressed
+    __builtin_va_copy(cp, ap);
+    struct pf_args a = { &cp, 0, 0, 0 };
+    n = pf_format(buf, size, fmt, &a);
+    __builtin_va_end(cp);
+    return n;
+}
+
+int snprintf(char* buf, size_t size, const char* fmt, ...) {
+    __builtin_va_list ap;
+    int n;
+
+    __builtin_va_start(ap, fmt);
+    n = vsnprintf(buf, size, fmt, ap);
+    __builtin_va_end(ap);
+    return n;
+}
+
+int bstr_snprintf(char* buf, size_t size, const char* fmt,
+                  const uint64_t* args, int nargs) {
+    struct pf_args a = { 0, args, nargs, 0 };
+    return pf_format(buf, size, fmt, &a);
+}
@@ -0,0 +1,50 @@
+/*
+ * uaccess.c - Checked access to EL0 memory
+ *
+ * Tasks have no VMA list to consult, so the page tables are the
+ * authority: AT S1E0R asks the MMU whether an EL0 load from a VA would
+ * succeed with the tables currently installed, which also rejects
+ * kernel-only mappings that happen to sit in the user range.
+ */
+
+#include "../../../../include/uaccess.h"
+#include "../../../../include/string.h"
+#include "../../../../include/interrupts.h"
+#include "../../../../include/uart.h"
+
+#define UACCESS_PAGE_SIZE   4096UL
+#define PAR_EL1_F           (1UL << 0)      // Translation aborted
+
+// User addresses live in the TTBR0 half of the address space
+#define USER_VA_END         (1UL << (64 - TCR_T0SZ))
+
+static int user_page_readable(uint64_t va) {
+    uint64_t par;
+    // PAR_EL1 is shared with any AT in a nested interrupt
+    unsigned long flags = local_irq_save();
+    __asm__ volatile("at s1e0r, %1\n"
+                     "isb\n"
+                     "mrs %0, par_el1" : "=r"(par) : "r"(va) : "memory");
+    local_irq_restore(flags);
+    return !(par & PAR_EL1_F);
+}
+
+int access_ok(const void* uaddr, size_t len) {
+    uint64_t start = (uint64_t)uaddr;
+    uint64_t end = start + len;
+
+    if (!mmu_enabled) return 0;
+    if (end < start || end > USER_VA_END) return 0;
+    if (!len) return 1;
+
+    for (uint64_t page = start & ~(UACCESS_PAGE_SIZE - 1); page < end; page += UACCESS_PAGE_SIZE) {
+        if (!user_page_readable(page)) return 0;
+    }
+    return 1;
+}
+
+size_t copy_from_user(void* dst, const void* usrc, size_t n) {
+    if (!access_ok(usrc, n)) return n;
+    memcpy(dst, usrc, n);
+    return 0;
+}
@@ -1,27 +1,20 @@
 #include "../../../include/interrupts.h"
 #include "../../../include/scheduler.h"
 #include "../../../include/uart.h"
+#include "../../../include/irq.h"
+#include "../../../include/klog.h"
+#include "../../../include/percpu.h"
+#include "../../../include/clocksource.h"
 
 // Add include for debug_print
 extern void debug_print(const char* msg);
 
-// ARM Generic Timer and GIC registers
-#define GICC_BASE       0x08010000
-#define GICC_IAR        (GICC_BASE + 0x00C)  // Interrupt Acknowledge Register
-#define GICC_EOIR       (GICC_BASE + 0x010)  // End of Interrupt Register
-
-#define TIMER_INTERVAL  100000  // Must match timer.c value
-#define TIMER_IRQ_ID    30      // Physical timer IRQ ID
-
 // Hardware UART registers for direct access
 #define UART0_BASE     0x09000000
 #define UART0_DR       (UART0_BASE + 0x00)   // Data Register
 #define UART0_FR       (UART0_BASE + 0x18)   // Flag Register
 #define UART0_FR_TXFF  (1 << 5)              // Transmit FIFO Full
 
-// Global counter to track IRQ calls
-static volatile int irq_counter = 0;
-
 // Ultra-low level UART output that doesn't rely on any system services
 static void raw_uart_putc(char c) {
     // Get pointers to UART registers
@@ -44,68 +37,26 @@ static void raw_uart_puts(const char *s) {
     }
 }
 
-// IRQ handler - this function is called directly from the vector table
-// This is the critical handler for timer interrupts that enables task switching
-void irq_handler(void) {
-    // Increment IRQ counter
-    irq_counter++;
-    
-    // Try multiple UART output methods to ensure visibility
-    
-    // 1. Simple uart_putc
-    uart_putc('I');
-    
-    // 2. Direct memory write to UART (simple pointer method)
-    volatile uint32_t* uart_raw = (volatile uint32_t*)0x09000000;
-    *uart_raw = 'I'; // I for IRQ entry marker
-    *uart_raw = 'R'; 
-    *uart_raw = 'Q';
-    *uart_raw = '#';
-    
-    // Print counter value
-    char digit = '0' + (irq_counter % 10);
-    *uart_raw = digit;
-    
-    *uart_raw = '!';
-    *uart_raw = '\r';
-    *uart_raw = '\n';
-    
-    // 3. Ultra-reliable raw UART output with register handling
-    raw_uart_puts("\n[IRQ] DIRECT: Handler invoked!\n");
-    
-    // 4. Read Interrupt Acknowledge Register to get interrupt ID
-    uint32_t iar = *((volatile uint32_t*)GICC_IAR);
-    uint32_t irq_id = iar & 0x3FF;  // Extract interrupt ID
-    
-    // Convert IRQ ID to character for raw output
-    digit = (irq_id < 10) ? ('0' + irq_id) : ('A' + (irq_id - 10));
-    raw_uart_puts("[IRQ] ID: ");
-    raw_uart_putc(digit);
-    raw_uart_puts("\n");
-    
-    // 5. Verify this is a timer interrupt (ID 30)
-    if (irq_id == TIMER_IRQ_ID) {
-        raw_uart_puts("[IRQ] Timer interrupt confirmed\n");
-        
-        // 6. Call the scheduler to switch tasks
-        schedule();
-        
-        // 7. Reset the timer for next interrupt
-        asm volatile("msr cntp_tval_el0, %0" :: "r"(TIMER_INTERVAL));
-        
-        // 8. Clear the timer interrupt status
-        asm volatile("mov x0, #0\n"
-                     "msr cntp_ctl_el0, x0\n"      // Disable timer temporarily
-                     "mov x0, #1\n"
-                     "msr cntp_ctl_el0, x0");      // Re-enable timer
-    } else {
-        raw_uart_puts("[IRQ] Unknown interrupt\n");
-    }
-    
-    // 9. Write to End of Interrupt Register to acknowledge it
-    *((volatile uint32_t*)GICC_EOIR) = iar;
-    
-    raw_uart_puts("[IRQ] Handler complete\n");
+// Entry timestamps of the last IRQ, per CPU (irq_last_stamp())
+static struct irq_stamp irq_stamps[NR_CPUS];
+
+const struct irq_stamp* irq_last_stamp(void) {
+    return &irq_stamps[smp_processor_id()];
+}
+
+// IRQ handler - called from el1_irq/el0_irq in entry.S with the saved
+// register frame. Dispatch goes through the INTID table in irq.c (see
+// request_irq()); the return to the interrupted context is the common
+// exit path in entry.S.
+void irq_handler(struct pt_regs* regs, uint64_t vector_cntvct) {
+    struct irq_stamp* stamp = &irq_stamps[smp_processor_id()];
+    
+    stamp->vector = vector_cntvct;
+    stamp->handler = clocksource_read();
+    
+    struct pt_regs* prev = irq_enter(regs);
+    handle_irq();
+    irq_exit(prev);
 }
 
 // Function to explicitly enable interrupts
@@ -170,8 +121,9 @@ void enable_irq(void) {
         "isb"                // Instruction synchronization barrier
     );
     
-    // Output message to confirm
-    debug_print("[INT] IRQs enabled\n");
+    if (KLOG_ENABLED(KLOG_DEBUG)) {
+        debug_print("[INT] IRQs enabled\n");
+    }
 }
 
 // Disable IRQs by setting the I bit in DAIF
@@ -182,8 +134,9 @@ void disable_irq(void) {
         "isb"                // Instruction synchronization barrier
     );
     
-    // Output message to confirm
-    debug_print("[INT] IRQs disabled\n");
+    if (KLOG_ENABLED(KLOG_DEBUG)) {
+        debug_print("[INT] IRQs disabled\n");
+    }
 }
 
 // Returns true if IRQs are enabled, false otherwise
@@ -1,84 +1,183 @@
+#include "../../../include/irq.h"
 #include "../../../include/interrupts.h"
 #include "../../../include/scheduler.h"
-#include "../../../include/uart.h"
-#include "../../../include/timer.h"
-
-// Add debug print declaration
-extern void debug_print(const char* msg);
-
-// GIC (Generic Interrupt Controller) registers
-#define GICD_BASE       0x08000000  // Distributor
-#define GICC_BASE       0x08010000  // CPU Interface
-
-// GIC CPU Interface registers
-#define GICC_IAR        (GICC_BASE + 0x00C)  // Interrupt Acknowledge Register
-#define GICC_EOIR       (GICC_BASE + 0x010)  // End of Interrupt Register
-
-// Timer configuration
-#define TIMER_IRQ       30          // Physical timer IRQ ID
-#define TIMER_INTERVAL  100000      // Default timer interval
-
-void handle_irq() {
-    // VERY FIRST OUTPUT - Raw UART output to confirm entry
-    volatile uint32_t *uart_raw = (volatile uint32_t *)0x09000000;
-    *uart_raw = 'I';  // 'I' for IRQ handler
-    *uart_raw = 'R';
-    *uart_raw = 'Q';
-    *uart_raw = '!';
-    *uart_raw = '\r';
-    *uart_raw = '\n';
-    
-    // Vector debug check
-    debug_print("[VECTOR] IRQ vector active\n");
-    
-    // Regular debug output
-    debug_print("************************\n");
-    debug_print("[IRQ] Interrupt received!\n");
-    debug_print("************************\n");
-    uart_puts("[IRQ] Interrupt received!\n");
-
-    // Read interrupt ID from GIC
-    uint32_t iar = *((volatile uint32_t*)GICC_IAR);
-    uint32_t id = iar & 0x3FF; // Extract interrupt ID (bits 0-9)
-
-    debug_print("[IRQ] Interrupt ID: ");
-    if (id == TIMER_IRQ) {
-        debug_print("30 (Timer)\n");
-        uart_puts("[IRQ] Timer interrupt!\n");
-        
-        // 1. Reset the timer to clear the pending state
-        asm volatile("msr cntp_tval_el0, %0" :: "r"(TIMER_INTERVAL));
-        
-        // 2. Explicitly clear the timer interrupt by toggling control bits
-        uint64_t ctrl;
-        asm volatile("mrs %0, cntp_ctl_el0" : "=r"(ctrl));
-        asm volatile("msr cntp_ctl_el0, xzr");  // Disable timer temporarily
-        asm volatile("msr cntp_ctl_el0, %0" :: "r"(ctrl));  // Re-enable with same settings
-        
-        debug_print("[IRQ] Timer reset for next interrupt\n");
-        
-        // 3. Call scheduler to switch tasks
-        debug_print("[IRQ] About to call scheduler...\n");
-        schedule();
-        debug_print("[IRQ] Returned from scheduler!\n");
-    } else if (id == 0) {
-        debug_print("Spurious interrupt\n");
+#include "../../../include/klog.h"
+#include "../../../include/gic.h"
+#include "../../../include/percpu.h"
+#include "../../../include/softirq.h"
+#include "../../../include/trace.h"
+
+// One entry per INTID; the fast path touches a single entry
+struct irq_desc {
+    irq_handler_t handler;
+    void* data;
+    uint64_t count;
+};
+
+static struct irq_desc irq_table[NR_IRQS];
+static uint64_t irq_spurious;
+
+// IRQ nesting depth and innermost frame, per CPU
+static unsigned int irq_nesting[NR_CPUS];
+static struct pt_regs* irq_regs[NR_CPUS];
+
+// With a split EOI, the outermost interrupt stays active until its
+// bottom halves have run
+static int irq_deactivate_pending[NR_CPUS];
+static uint32_t irq_deferred_iar[NR_CPUS];
+
+void irq_enable(uint32_t irq) {
+    if (irq >= NR_IRQS) return;
+    gic->enable(irq);
+}
+
+void irq_disable(uint32_t irq) {
+    if (irq >= NR_IRQS) return;
+    gic->disable(irq);
+}
+
+void irq_set_priority(uint32_t irq, uint8_t priority) {
+    if (irq >= NR_IRQS) return;
+    gic->set_priority(irq, priority);
+}
+
+void irq_send_sgi(uint32_t sgi, uint8_t target_mask) {
+    if (sgi >= IRQ_PPI_BASE) return;
+    gic->send_sgi(sgi, target_mask);
+}
+
+int request_irq(uint32_t irq, irq_handler_t handler, void* data) {
+    if (irq >= NR_IRQS || !handler) return -1;
+
+    struct irq_desc* desc = &irq_table[irq];
+    unsigned long flags = local_irq_save();
+
+    if (desc->handler && (desc->handler != handler || desc->data != data)) {
+        local_irq_restore(flags);
+        return -1;
+    }
+
+    desc->data = data;
+    desc->handler = handler;
+
+    gic_init();
+    irq_set_priority(irq, IRQ_DEFAULT_PRIORITY);
+    irq_enable(irq);
+
+    local_irq_restore(flags);
+    return 0;
+}
+
+void free_irq(uint32_t irq) {
+    if (irq >= NR_IRQS) return;
+
+    unsigned long flags = local_irq_save();
+    irq_disable(irq);
+    irq_table[irq].handler = NULL;
+    irq_table[irq].data = NULL;
+    local_irq_restore(flags);
+}
+
+uint64_t irq_get_count(uint32_t irq) {
+    return irq < NR_IRQS ? irq_table[irq].count : 0;
+}
+
+uint64_t irq_get_spurious_count(void) {
+    return irq_spurious;
+}
+
+// Slow path kept out of line so handle_irq() stays small. klog() only
+// queues the report; never print from IRQ context.
+static void __attribute__((noinline)) irq_unhandled(uint32_t id) {
+    irq_spurious++;
+    klog(KLOG_WARNING, "Unhandled INTID %d", id);
+}
+
+void handle_irq(void) {
+    uint32_t iar;
+    uint32_t id = gic->ack(&iar);
+
+    // 1020-1023: nothing to acknowledge (1023 = spurious)
+    if (id >= NR_IRQS) {
+        irq_spurious++;
+        return;
+    }
+
+    struct irq_desc* desc = &irq_table[id];
+    desc->count++;
+
+    // The acknowledge raised the running priority to this interrupt's
+    // group, so unmasking only admits strictly more urgent interrupts
+    trace_irq_entry(id);
+    __asm__ volatile("msr daifclr, #2" ::: "memory");
+    if (desc->handler) {
+        desc->handler(id, desc->data);
     } else {
-        debug_print("Unknown (");
-        // Print the IRQ number
-        char digit = '0' + (id % 10);
-        if (id >= 10) {
-            char tens = '0' + (id / 10);
-            debug_print(&tens);
-        }
-        debug_print(&digit);
-        debug_print(")\n");
-        uart_puts("[IRQ] Unknown interrupt!\n");
+        irq_unhandled(id);
+    }
+    __asm__ volatile("msr daifset, #2" ::: "memory");
+    trace_irq_exit(id);
+
+    // Drop priority only now: any earlier would let equal and lower
+    // priorities nest on top of a running handler
+    gic->eoi(iar);
+    if (!gic->eoi_split) {
+        return;
+    }
+
+    // Keep the outermost INTID active through its softirqs, so it cannot
+    // fire again while its deferred work is pending. Interrupts nested in
+    // a handler or taken during softirqs have no bottom half of their own.
+    unsigned int cpu = smp_processor_id();
+    if (irq_nesting[cpu] == 1 && !in_softirq()) {
+        irq_deferred_iar[cpu] = iar;
+        irq_deactivate_pending[cpu] = 1;
+    } else {
+        gic->deactivate(iar);
+    }
+}
+
+struct pt_regs* irq_enter(struct pt_regs* regs) {
+    unsigned int cpu = smp_processor_id();
+    struct pt_regs* prev = irq_regs[cpu];
+
+    irq_regs[cpu] = regs;
+    irq_nesting[cpu]++;
+    return prev;
+}
+
+void irq_exit(struct pt_regs* prev_regs) {
+    unsigned int cpu = smp_processor_id();
+
+    irq_regs[cpu] = prev_regs;
+    if (--irq_nesting[cpu] != 0) {
+        return;
     }
 
-    // 4. Acknowledge the interrupt at the GIC level
-    *((volatile uint32_t*)GICC_EOIR) = iar;
-    debug_print("[IRQ] Interrupt acknowledged at GIC\n");
-    
-    debug_print("[IRQ] Handler complete\n");
-} 
\ No newline at end of file
+    // Bottom halves run after EOI with IRQs unmasked. An interrupt taken
+    // while they run exits here too, but must neither restart them nor
+    // switch away underneath them; the interrupted exit does both.
+    do_softirq();
+    if (in_softirq()) {
+        return;
+    }
+
+    if (irq_deactivate_pending[cpu]) {
+        irq_deactivate_pending[cpu] = 0;
+        gic->deactivate(irq_deferred_iar[cpu]);
+    }
+
+    // Outermost level: the interrupted task's frame is the only one on
+    // this stack, so switching away here is a plain preemption
+    if (need_resched) {
+        schedule();
+    }
+}
+
+unsigned int in_interrupt(void) {
+    return irq_nesting[smp_processor_id()] + in_softirq();
+}
+
+struct pt_regs* get_irq_regs(void) {
+    return irq_regs[smp_processor_id()];
+}
@@ -0,0 +1,78 @@
+/*
+ * softirq.c - Bottom halves run at interrupt exit
+ *
+ * A top half acknowledges its device, grabs whatever the hardware will not
+ * hold on to and raises a softirq. irq_exit() runs the pending actions
+ * once the outermost interrupt has been EOI'd, with IRQs unmasked, so
+ * further interrupts are only held off by the top halves themselves.
+ * Softirqs raised faster than they can be handled are passed to the
+ * workqueue after SOFTIRQ_MAX_RESTART rounds instead of starving tasks.
+ */
+
+#include "../../../include/softirq.h"
+#include "../../../include/workqueue.h"
+#include "../../../include/interrupts.h"
+#include "../../../include/percpu.h"
+
+static softirq_action_t softirq_vec[NR_SOFTIRQS];
+
+// Pending bitmap and "running actions" flag, per CPU
+static volatile uint32_t softirq_pending[NR_CPUS];
+static unsigned int softirq_active[NR_CPUS];
+
+static void softirq_overflow(struct work_struct* work);
+static struct work_struct softirq_overflow_work = { .func = softirq_overflow };
+
+void open_softirq(unsigned int nr, softirq_action_t action) {
+    if (nr >= NR_SOFTIRQS) return;
+    softirq_vec[nr] = action;
+}
+
+void raise_softirq(unsigned int nr) {
+    if (nr >= NR_SOFTIRQS) return;
+
+    unsigned long flags = local_irq_save();
+    softirq_pending[smp_processor_id()] |= 1U << nr;
+    local_irq_restore(flags);
+}
+
+unsigned int in_softirq(void) {
+    return softirq_active[smp_processor_id()];
+}
+
+// Worker-thread fallback for softirqs still pending after the restarts
+static void softirq_overflow(struct work_struct* work) {
+    (void)work;
+    unsigned long flags = local_irq_save();
+    do_softirq();
+    local_irq_restore(flags);
+}
+
+void do_softirq(void) {
+    unsigned int cpu = smp_processor_id();
+    int restart = SOFTIRQ_MAX_RESTART;
+
+    // A nested interrupt exiting on top of running actions leaves its
+    // softirqs for the loop below
+    if (softirq_active[cpu] || !softirq_pending[cpu]) return;
+    softirq_active[cpu] = 1;
+
+    do {
+        uint32_t pending = softirq_pending[cpu];
+        softirq_pending[cpu] = 0;
+
+        __asm__ volatile("msr daifclr, #2" ::: "memory");
+        while (pending) {
+            unsigned int nr = __builtin_ctz(pending);
+            pending &= pending - 1;
+            if (softirq_vec[nr]) softirq_vec[nr]();
+        }
+        __asm__ volatile("msr daifset, #2" ::: "memory");
+    } while (softirq_pending[cpu] && --restart);
+
+    softirq_active[cpu] = 0;
+
+    if (softirq_pending[cpu]) {
+        queue_work(&softirq_overflow_work);
+    }
+}
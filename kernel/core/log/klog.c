@@ -0,0 +1,177 @@
+/*
+ * klog.c - Binary kernel log with deferred formatting
+ *
+ * klog() does not format anything. It copies a timestamp, the format
+ * pointer and the raw argument words into a per-CPU ring and returns, so
+ * the cost of a log call is a few stores no matter how slow the console
+ * is. klog_task() drains the rings from task context, formats each record
+ * and hands the text to the console. Until the scheduler is running there
+ * is no drain task, and the boot thread flushes synchronously instead.
+ */
+
+#include "../../../include/klog.h"
+#include "../../../include/debug_config.h"
+#include "../../../include/interrupts.h"
+#include "../../../include/percpu.h"
+#include "../../../include/clocksource.h"
+#include "../../../include/console.h"
+#include "../../../include/task.h"
+#include "../../../include/scheduler.h"
+#include "../../../include/irq.h"
+#include "../../../include/wait.h"
+#include "../../../include/printf.h"
+
+// Start with everything that was compiled in
+#define KLOG_DEFAULT_LEVEL  DEBUG_LOG_LEVEL
+
+struct klog_entry {
+    uint64_t ts;               // ktime_get_ns() at record time
+    const char* fmt;
+    uint8_t level;
+    uint8_t nargs;
+    uint64_t args[KLOG_MAX_ARGS];
+};
+
+// head is written only by the owning CPU, tail only by the drain; keep
+// them on separate lines so neither side bounces the other's line
+struct klog_ring {
+    volatile uint32_t head;
+    uint64_t dropped;
+    volatile uint32_t tail __attribute__((aligned(64)));
+    struct klog_entry entries[KLOG_ENTRIES] __attribute__((aligned(64)));
+};
+
+_Static_assert((KLOG_ENTRIES & (KLOG_ENTRIES - 1)) == 0, "KLOG_ENTRIES must be a power of two");
+
+static struct klog_ring klog_rings[NR_CPUS];
+static uint64_t klog_reported_drops;
+static volatile int klog_level = KLOG_DEFAULT_LEVEL;
+static DECLARE_WAIT_QUEUE_HEAD(klog_wait);
+
+void klog_set_level(int level) {
+    if (level < KLOG_EMERG) level = KLOG_EMERG;
+    if (level > KLOG_DEBUG) level = KLOG_DEBUG;
+    klog_level = level;
+}
+
+int klog_get_level(void) {
+    return klog_level;
+}
+
+uint64_t klog_dropped(void) {
+    uint64_t total = 0;
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        total += klog_rings[cpu].dropped;
+    }
+    return total;
+}
+
+void klog_record(int level, const char* fmt, int nargs, ...) {
+    if (level > klog_level || !fmt) return;
+    if (nargs > KLOG_MAX_ARGS) nargs = KLOG_MAX_ARGS;
+
+    struct klog_ring* ring = &klog_rings[smp_processor_id()];
+
+    // Only this CPU produces, but a nested interrupt may; masking IRQs
+    // for a few stores is cheaper than an atomic reservation
+    unsigned long flags = local_irq_save();
+
+    uint32_t head = ring->head;
+    if (head - ring->tail >= KLOG_ENTRIES) {
+        ring->dropped++;
+        local_irq_restore(flags);
+        return;
+    }
+
+    struct klog_entry* e = &ring->entries[head & (KLOG_ENTRIES - 1)];
+    __builtin_va_list ap;
+
+    e->ts = ktime_get_ns();
+    e->fmt = fmt;
+    e->level = (uint8_t)level;
+    e->nargs = (uint8_t)nargs;
+    __builtin_va_start(ap, nargs);
+    for (int i = 0; i < nargs; i++) {
+        e->args[i] = __builtin_va_arg(ap, uint64_t);
+    }
+    __builtin_va_end(ap);
+
+    // Publish the entry before the new head
+    __asm__ volatile("dmb ishst" ::: "memory");
+    ring->head = head + 1;
+
+    local_irq_restore(flags);
+
+    // No drain task until sched_start() hands the CPU to the tasks
+    // (selftest fixtures may set current_task before that): print now
+    if (!scheduler_initialized && !in_interrupt()) {
+        klog_flush();
+    } else if (waitqueue_active(&klog_wait)) {
+        wake_up(&klog_wait);
+    }
+}
+
+static void klog_emit(const struct klog_entry* e) {
+    char line[KLOG_LINE_MAX];
+    uint64_t us = e->ts / NSEC_PER_USEC;
+    size_t len, room;
+    int n;
+
+    len = (size_t)snprintf(line, sizeof(line), "[%5llu.%06llu] ",
+                           us / 1000000, us % 1000000);
+
+    // Arguments are replayed from the stored words; 32-bit conversions
+    // take the low half, which is what the caller passed. One byte stays
+    // free for the newline.
+    room = sizeof(line) - len - 1;
+    n = bstr_snprintf(line + len, room, e->fmt, e->args, e->nargs);
+    len += (size_t)n < room ? (size_t)n : room - 1;
+
+    if (line[len - 1] != '\n') line[len++] = '\n';
+    console_write(line, len);
+}
+
+void klog_flush(void) {
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        struct klog_ring* ring = &klog_rings[cpu];
+        uint32_t tail = ring->tail;
+
+        while (tail != ring->head) {
+            // Read the entry only after observing the head that covers it
+            __asm__ volatile("dmb ishld" ::: "memory");
+            struct klog_entry e = ring->entries[tail & (KLOG_ENTRIES - 1)];
+
+            // Hand the slot back before the slow console output
+            __asm__ volatile("dmb ish" ::: "memory");
+            ring->tail = ++tail;
+
+            klog_emit(&e);
+        }
+    }
+
+    uint64_t dropped = klog_dropped();
+    if (dropped != klog_reported_drops) {
+        char buf[64];
+        int n = snprintf(buf, sizeof(buf), "[klog] %d messages dropped\n",
+                         (int)(dropped - klog_reported_drops));
+        console_write(buf, (size_t)n);
+        klog_reported_drops = dropped;
+    }
+
+    console_flush();
+}
+
+static int klog_pending(void) {
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        if (klog_rings[cpu].head != klog_rings[cpu].tail) return 1;
+    }
+    return 0;
+}
+
+// Background drain: sleeps until klog_record() queues something
+void klog_task(void) {
+    while (1) {
+        wait_event(klog_wait, klog_pending());
+        klog_flush();
+    }
+}
@@ -0,0 +1,145 @@
+/*
+ * perf.c - Per-region and per-task PMU accounting
+ *
+ * Regions add their deltas into a struct perf_region and link themselves
+ * onto a report list the first time they complete. Tasks are charged at
+ * every schedule(): the outgoing task gets the counters since it was
+ * switched in. The time between that snapshot and the incoming task
+ * resuming from cpu_switch_to() is itself the "context_switch" region.
+ */
+
+#include "../../../include/perf.h"
+#include "../../../include/task.h"
+#include "../../../include/interrupts.h"
+#include "../../../include/percpu.h"
+#include "../../../include/uart.h"
+#include "../../../include/printf.h"
+
+static struct perf_region* perf_regions;
+
+static PERF_REGION(perf_ctx_switch, "context_switch");
+
+// Snapshot taken by perf_task_switch(), closed by perf_task_switch_done()
+static struct pmu_sample perf_switch_start[NR_CPUS];
+static bool perf_switch_pending[NR_CPUS];
+
+static void perf_account(struct pmu_sample* total, const struct pmu_sample* delta) {
+    for (int i = 0; i < PMU_NR_COUNTERS; i++) {
+        total->v[i] += delta->v[i];
+    }
+}
+
+void perf_region_end(struct perf_region* region, const struct pmu_sample* start) {
+    struct pmu_sample now, delta;
+
+    if (!pmu_active) return;
+
+    pmu_read(&now);
+    pmu_delta(&delta, &now, start);
+
+    unsigned long flags = local_irq_save();
+    region->calls++;
+    for (int i = 0; i < PMU_NR_COUNTERS; i++) {
+        region->total[i] += delta.v[i];
+    }
+    if (delta.v[PMU_CYCLES] > region->max_cycles) {
+        region->max_cycles = delta.v[PMU_CYCLES];
+    }
+    if (!region->registered) {
+        region->registered = true;
+        region->next = perf_regions;
+        perf_regions = region;
+    }
+    local_irq_restore(flags);
+}
+
+void perf_task_switch(struct task* prev, struct task* next) {
+    unsigned int cpu = smp_processor_id();
+    struct pmu_sample* now = &perf_switch_start[cpu];
+    struct pmu_sample delta;
+
+    if (!pmu_active) return;
+
+    pmu_read(now);
+    pmu_delta(&delta, now, &prev->perf_in);
+    perf_account(&prev->perf, &delta);
+    next->perf_in = *now;
+    perf_switch_pending[cpu] = true;
+}
+
+void perf_task_switch_done(void) {
+    unsigned int cpu = smp_processor_id();
+
+    if (!perf_switch_pending[cpu]) return;
+
+    perf_switch_pending[cpu] = false;
+    perf_region_end(&perf_ctx_switch, &perf_switch_start[cpu]);
+}
+
+void perf_reset(void) {
+    unsigned long flags = local_irq_save();
+
+    for (struct perf_region* r = perf_regions; r; r = r->next) {
+        r->calls = 0;
+        r->max_cycles = 0;
+        for (int i = 0; i < PMU_NR_COUNTERS; i++) {
+            r->total[i] = 0;
+        }
+    }
+    for (int t = 0; t < task_count; t++) {
+        if (task_list[t]) {
+            for (int i = 0; i < PMU_NR_COUNTERS; i++) {
+                task_list[t]->perf.v[i] = 0;
+            }
+        }
+    }
+    local_irq_restore(flags);
+}
+
+// Counters whose event the CPU does not implement print as "-"
+static int perf_format_counts(char* buf, size_t size, const uint64_t* v, uint64_t div) {
+    int len = 0;
+
+    for (int i = 0; i < PMU_NR_COUNTERS && len < (int)size; i++) {
+        if (pmu_counter_supported(i)) {
+            len += snprintf(buf + len, size - len, " %12llu", v[i] / div);
+        } else {
+            len += snprintf(buf + len, size - len, " %12s", "-");
+        }
+    }
+    return len;
+}
+
+void perf_report(void) {
+    char line[160];
+    int len;
+
+    if (!pmu_active) {
+        uart_puts("[PERF] PMU not available\n");
+        return;
+    }
+
+    len = snprintf(line, sizeof(line), "[PERF] %-16s %8s", "region/call", "calls");
+    for (int i = 0; i < PMU_NR_COUNTERS && len < (int)sizeof(line); i++) {
+        len += snprintf(line + len, sizeof(line) - len, " %12s", pmu_counter_name(i));
+    }
+    snprintf(line + len, sizeof(line) - len, " %12s\n", "max_cycles");
+    uart_puts(line);
+
+    for (struct perf_region* r = perf_regions; r; r = r->next) {
+        if (!r->calls) continue;
+        len = snprintf(line, sizeof(line), "[PERF] %-16s %8llu", r->name, r->calls);
+        len += perf_format_counts(line + len, sizeof(line) - len, r->total, r->calls);
+        snprintf(line + len, sizeof(line) - len, " %12llu\n", r->max_cycles);
+        uart_puts(line);
+    }
+
+    for (int t = 0; t < task_count; t++) {
+        task_t* task = task_list[t];
+        if (!task) continue;
+        len = snprintf(line, sizeof(line), "[PERF] task %-11.11s %8d", task->name, task->id);
+        len += perf_format_counts(line + len, sizeof(line) - len, task->perf.v, 1);
+        snprintf(line + len, sizeof(line) - len, "\n");
+        uart_puts(line);
+    }
+}
@@ -0,0 +1,132 @@
+/*
+ * perf_shell.c - Serial command task for the profiling tools
+ *
+ * Reads newline-terminated commands from the PL011 RX ring and runs the
+ * matching dump/control call. All output is the same line format the host
+ * scripts parse, so a serial log can be fed straight to
+ * scripts/profile_symbolize.py or scripts/trace_to_perfetto.py.
+ *
+ *   prof timer [hz] [bt]     start timer-driven sampling
+ *   prof pmu [cycles] [bt]   start PMU-overflow sampling
+ *   prof stop | prof dump
+ *   trace on [mask] | trace off | trace dump
+ *   perf | perf reset
+ */
+
+#include "../../../include/perf.h"
+#include "../../../include/profile.h"
+#include "../../../include/trace.h"
+#include "../../../include/uart.h"
+
+#define PERF_SHELL_LINE 64
+#define PERF_SHELL_ARGS 4
+
+static bool word_eq(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+// Decimal, or hex with a 0x prefix; def when absent
+static uint64_t parse_num(const char* s, uint64_t def) {
+    uint64_t v = 0;
+    int base = 10;
+
+    if (!s || !*s) return def;
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        base = 16;
+        s += 2;
+    }
+    for (; *s; s++) {
+        int d;
+        if (*s >= '0' && *s <= '9') d = *s - '0';
+        else if (base == 16 && *s >= 'a' && *s <= 'f') d = *s - 'a' + 10;
+        else if (base == 16 && *s >= 'A' && *s <= 'F') d = *s - 'A' + 10;
+        else return def;
+        v = v * base + d;
+    }
+    return v;
+}
+
+static void cmd_prof(int argc, char** argv) {
+    if (argc >= 2 && (word_eq(argv[1], "timer") || word_eq(argv[1], "pmu"))) {
+        bool pmu = word_eq(argv[1], "pmu");
+        unsigned int flags = 0;
+        const char* period = NULL;
+
+        for (int i = 2; i < argc; i++) {
+            if (word_eq(argv[i], "bt")) flags |= PROFILE_BACKTRACE;
+            else period = argv[i];
+        }
+        if (profile_start(pmu ? PROFILE_SRC_PMU : PROFILE_SRC_TIMER,
+                          parse_num(period, 0), flags) != 0) {
+            uart_puts("prof: source not available\n");
+        }
+    } else if (argc >= 2 && word_eq(argv[1], "stop")) {
+        profile_stop();
+    } else if (argc >= 2 && word_eq(argv[1], "dump")) {
+        profile_dump();
+    } else {
+        uart_puts("usage: prof timer [hz] [bt] | prof pmu [cycles] [bt] | prof stop | prof dump\n");
+    }
+}
+
+static void cmd_trace(int argc, char** argv) {
+    if (argc >= 2 && word_eq(argv[1], "on")) {
+        trace_enable((uint32_t)parse_num(argc >= 3 ? argv[2] : NULL, TRACE_ALL));
+    } else if (argc >= 2 && word_eq(argv[1], "off")) {
+        trace_enable(0);
+    } else if (argc >= 2 && word_eq(argv[1], "dump")) {
+        trace_dump();
+    } else {
+        uart_puts("usage: trace on [mask] | trace off | trace dump\n");
+    }
+}
+
+static void cmd_perf(int argc, char** argv) {
+    if (argc >= 2 && word_eq(argv[1], "reset")) {
+        perf_reset();
+    } else {
+        perf_report();
+    }
+}
+
+static void perf_shell_run(char* line) {
+    char* argv[PERF_SHELL_ARGS];
+    int argc = 0;
+
+    // Split on spaces in place
+    while (*line && argc < PERF_SHELL_ARGS) {
+        while (*line == ' ') *line++ = '\0';
+        if (!*line) break;
+        argv[argc++] = line;
+        while (*line && *line != ' ') line++;
+    }
+    *line = '\0';
+    if (!argc) return;
+
+    if (word_eq(argv[0], "prof")) cmd_prof(argc, argv);
+    else if (word_eq(argv[0], "trace")) cmd_trace(argc, argv);
+    else if (word_eq(argv[0], "perf")) cmd_perf(argc, argv);
+    else uart_puts("commands: prof, trace, perf\n");
+}
+
+void perf_shell_task(void) {
+    char line[PERF_SHELL_LINE];
+    size_t len = 0;
+
+    while (1) {
+        char c;
+        if (!uart_read_wait(&c, 1)) continue;
+
+        if (c == '\r' || c == '\n') {
+            line[len] = '\0';
+            perf_shell_run(line);
+            len = 0;
+        } else if (len < sizeof(line) - 1) {
+            line[len++] = c;
+        }
+    }
+}
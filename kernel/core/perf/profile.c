@@ -0,0 +1,252 @@
+/*
+ * profile.c - PC sampling profiler
+ *
+ * The timer source piggybacks on timer_interrupt(): it keeps its own
+ * deadline in the one-shot comparator through timer_request_wakeup() and
+ * samples when that deadline has passed, so scheduler ticks and sleeper
+ * wakeups in between add no samples. The PMU source samples from the
+ * cycle-counter overflow interrupt (pmu_overflow_start()). Either way the
+ * sample is the innermost IRQ frame, i.e. whatever the CPU was executing
+ * when the interrupt arrived.
+ */
+
+#include "../../../include/profile.h"
+#include "../../../include/pmu.h"
+#include "../../../include/timer.h"
+#include "../../../include/irq.h"
+#include "../../../include/ptrace.h"
+#include "../../../include/interrupts.h"
+#include "../../../include/percpu.h"
+#include "../../../include/task.h"
+#include "../../../include/uart.h"
+#include "../../../include/printf.h"
+#include "../../../include/memory_config.h"
+
+#define PROFILE_NO_TASK     (-2)
+
+struct profile_buffer {
+    uint64_t head;             // Samples ever taken; index = head % size
+    struct profile_sample samples[PROFILE_BUF_ENTRIES];
+};
+
+static struct profile_buffer profile_buffers[NR_CPUS];
+
+static volatile bool profile_running;
+static enum profile_source profile_src;
+static unsigned int profile_flags;
+static uint64_t profile_period;
+static uint64_t profile_period_ticks;  // Timer source
+static uint64_t profile_deadline;
+
+// End of the kernel stack sp is on. Apart from the boot thread's, every
+// stack is a single page-aligned page (alloc_page() for tasks, idle_stack
+// in scheduler.c); sp == top is an empty stack.
+static uint64_t profile_stack_top(uint64_t sp) {
+    if (sp > BOOT_STACK_TOP - BOOT_STACK_SIZE && sp <= BOOT_STACK_TOP) {
+        return BOOT_STACK_TOP;
+    }
+    return ((sp - 1) & ~(uint64_t)(PAGE_SIZE - 1)) + PAGE_SIZE;
+}
+
+// Follow {fp, lr} frame records up the interrupted kernel stack. Every
+// record must be aligned, above the previous one and below the top of
+// that stack, so a build without frame pointers just yields a short or
+// empty trace.
+static void profile_backtrace(const struct pt_regs* regs, uint64_t* bt) {
+    uint64_t low = regs->sp;
+    uint64_t high = profile_stack_top(regs->sp);
+    uint64_t fp = regs->regs[29];
+    int depth = 0;
+
+    while (depth < PROFILE_BT_DEPTH && fp >= low && fp + 16 <= high && !(fp & 0xF)) {
+        const uint64_t* record = (const uint64_t*)fp;
+        uint64_t lr = record[1];
+
+        if (!lr) break;
+        bt[depth++] = lr;
+        low = fp + 16;
+        fp = record[0];
+    }
+    while (depth < PROFILE_BT_DEPTH) {
+        bt[depth++] = 0;
+    }
+}
+
+void profile_sample(struct pt_regs* regs) {
+    if (!profile_running || !regs) return;
+
+    struct profile_buffer* buf = &profile_buffers[smp_processor_id()];
+    unsigned long flags = local_irq_save();
+    struct profile_sample* s = &buf->samples[buf->head & (PROFILE_BUF_ENTRIES - 1)];
+
+    s->pc = regs->pc;
+    s->task = current_task ? current_task->id : PROFILE_NO_TASK;
+    s->flags = user_mode(regs) ? PROFILE_SAMPLE_USER : 0;
+    if ((profile_flags & PROFILE_BACKTRACE) && !user_mode(regs)) {
+        profile_backtrace(regs, s->bt);
+    } else {
+        for (int i = 0; i < PROFILE_BT_DEPTH; i++) {
+            s->bt[i] = 0;
+        }
+    }
+    buf->head++;
+
+    local_irq_restore(flags);
+}
+
+void profile_timer_tick(uint64_t now) {
+    if (!profile_running || profile_src != PROFILE_SRC_TIMER || now < profile_deadline) {
+        return;
+    }
+
+    profile_sample(get_irq_regs());
+
+    // Stay on the original grid unless we fell more than a period behind
+    profile_deadline += profile_period_ticks;
+    if (profile_deadline <= now) {
+        profile_deadline = now + profile_period_ticks;
+    }
+    timer_request_wakeup(profile_deadline);
+}
+
+int profile_start(enum profile_source source, uint64_t period, unsigned int flags) {
+    profile_stop();
+
+    profile_src = source;
+    profile_flags = flags;
+
+    if (source == PROFILE_SRC_TIMER) {
+        uint64_t hz = period ? period : PROFILE_DEFAULT_HZ;
+        profile_period = hz;
+        profile_period_ticks = timer_get_frequency() / hz;
+        if (!profile_period_ticks) profile_period_ticks = 1;
+
+        unsigned long irq = local_irq_save();
+        profile_running = true;
+        profile_deadline = timer_read_counter() + profile_period_ticks;
+        timer_request_wakeup(profile_deadline);
+        local_irq_restore(irq);
+        return 0;
+    }
+
+    if (source == PROFILE_SRC_PMU) {
+        uint64_t cycles = period ? period : PROFILE_DEFAULT_CYCLES;
+        if (cycles > 0xFFFFFFFFULL) cycles = 0xFFFFFFFFULL;
+        profile_period = cycles;
+
+        pmu_init();
+        profile_running = true;
+        if (pmu_overflow_start((uint32_t)cycles, profile_sample) != 0) {
+            profile_running = false;
+            return -1;
+        }
+        return 0;
+    }
+
+    return -1;
+}
+
+void profile_stop(void) {
+    if (profile_running && profile_src == PROFILE_SRC_PMU) {
+        pmu_overflow_stop();
+    }
+    // A pending timer deadline just fires once more and finds us stopped
+    profile_running = false;
+}
+
+const struct profile_sample* profile_samples(uint64_t* count) {
+    struct profile_buffer* buf = &profile_buffers[smp_processor_id()];
+
+    *count = buf->head < PROFILE_BUF_ENTRIES ? buf->head : PROFILE_BUF_ENTRIES;
+    return buf->samples;
+}
+
+void profile_clear(void) {
+    for (unsigned int cpu = 0; cpu < NR_CPUS; cpu++) {
+        profile_buffers[cpu].head = 0;
+    }
+}
+
+// Order by stack, then task, so identical samples end up adjacent
+static int profile_cmp(const struct profile_sample* a, const struct profile_sample* b) {
+    if (a->pc != b->pc) return a->pc < b->pc ? -1 : 1;
+    for (int i = 0; i < PROFILE_BT_DEPTH; i++) {
+        if (a->bt[i] != b->bt[i]) return a->bt[i] < b->bt[i] ? -1 : 1;
+    }
+    if (a->task != b->task) return a->task < b->task ? -1 : 1;
+    if (a->flags != b->flags) return a->flags < b->flags ? -1 : 1;
+    return 0;
+}
+
+// Shell sort; the rings are small and only sorted when dumped
+static void profile_sort(struct profile_sample* s, uint64_t n) {
+    static const uint64_t gaps[] = { 701, 301, 132, 57, 23, 10, 4, 1 };
+
+    for (unsigned int g = 0; g < sizeof(gaps) / sizeof(gaps[0]); g++) {
+        uint64_t gap = gaps[g];
+        for (uint64_t i = gap; i < n; i++) {
+            struct profile_sample tmp = s[i];
+            uint64_t j = i;
+            while (j >= gap && profile_cmp(&s[j - gap], &tmp) > 0) {
+                s[j] = s[j - gap];
+                j -= gap;
+            }
+            s[j] = tmp;
+        }
+    }
+}
+
+static void profile_print_stack(const struct profile_sample* s, uint64_t count) {
+    char line[160];
+    int len;
+
+    len = snprintf(line, sizeof(line), "PS %llu %d %x %llx", count, s->task, s->flags, s->pc);
+    for (int i = 0; i < PROFILE_BT_DEPTH && s->bt[i]; i++) {
+        len += snprintf(line + len, sizeof(line) - len, " %llx", s->bt[i]);
+    }
+    snprintf(line + len, sizeof(line) - len, "\n");
+    uart_puts(line);
+}
+
+void profile_dump(void) {
+    char line[128];
+
+    profile_stop();
+
+    uint64_t total = 0, lost = 0;
+    for (unsigned int cpu = 0; cpu < NR_CPUS; cpu++) {
+        uint64_t head = profile_buffers[cpu].head;
+        total += head < PROFILE_BUF_ENTRIES ? head : PROFILE_BUF_ENTRIES;
+        lost += head > PROFILE_BUF_ENTRIES ? head - PROFILE_BUF_ENTRIES : 0;
+    }
+
+    snprintf(line, sizeof(line), "PROFILE-BEGIN v1 source=%s period=%llu samples=%llu overwritten=%llu\n",
+             profile_src == PROFILE_SRC_PMU ? "pmu" : "timer", profile_period, total, lost);
+    uart_puts(line);
+
+    for (int i = 0; i < task_count; i++) {
+        if (task_list[i]) {
+            snprintf(line, sizeof(line), "TN %d %s\n", task_list[i]->id, task_list[i]->name);
+            uart_puts(line);
+        }
+    }
+
+    // One line per distinct (stack, task): count, task, flags, pc, callers
+    for (unsigned int cpu = 0; cpu < NR_CPUS; cpu++) {
+        struct profile_buffer* buf = &profile_buffers[cpu];
+        uint64_t n = buf->head < PROFILE_BUF_ENTRIES ? buf->head : PROFILE_BUF_ENTRIES;
+
+        profile_sort(buf->samples, n);
+        for (uint64_t i = 0; i < n; ) {
+            uint64_t j = i + 1;
+            while (j < n && profile_cmp(&buf->samples[i], &buf->samples[j]) == 0) {
+                j++;
+            }
+            profile_print_stack(&buf->samples[i], j - i);
+            i = j;
+        }
+        buf->head = 0;
+    }
+
+    uart_puts("PROFILE-END\n");
+}
@@ -0,0 +1,75 @@
+/*
+ * mutex.c - Sleeping mutex and condition variables
+ */
+
+#include "../../../include/mutex.h"
+#include "../../../include/interrupts.h"
+
+// The boot thread has no task_t; it owns mutexes under this tag
+#define MUTEX_OWNER_BOOT    ((task_t*)1)
+
+static inline task_t* mutex_self(void) {
+    return current_task ? current_task : MUTEX_OWNER_BOOT;
+}
+
+int mutex_trylock(struct mutex* lock) {
+    task_t* unlocked = NULL;
+
+    return __atomic_compare_exchange_n(&lock->owner, &unlocked, mutex_self(), 0,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void mutex_lock_slowpath(struct mutex* lock) {
+    struct wait_queue_entry wait;
+    unsigned long flags = local_irq_save();
+
+    if (!mutex_trylock(lock)) {
+        // mutex_unlock() makes us the owner before waking us
+        prepare_to_wait(&lock->wait, &wait);
+        wait_block(&wait);
+        finish_wait(&lock->wait, &wait);
+    }
+    local_irq_restore(flags);
+}
+
+void mutex_lock(struct mutex* lock) {
+    if (__builtin_expect(mutex_trylock(lock), 1)) return;
+    mutex_lock_slowpath(lock);
+}
+
+void mutex_unlock(struct mutex* lock) {
+    unsigned long flags = local_irq_save();
+    struct wait_queue_entry* next = lock->wait.first;
+
+    if (next) {
+        // Hand off: the lock never becomes free while someone waits
+        lock->owner = next->task ? next->task : MUTEX_OWNER_BOOT;
+        wake_up(&lock->wait);
+    } else {
+        __atomic_store_n(&lock->owner, NULL, __ATOMIC_RELEASE);
+    }
+
+    local_irq_restore(flags);
+}
+
+void condvar_wait(struct condvar* cv, struct mutex* lock) {
+    struct wait_queue_entry wait;
+    unsigned long flags = local_irq_save();
+
+    // Queue before dropping the lock so a signal in between is not lost
+    prepare_to_wait(&cv->wait, &wait);
+    mutex_unlock(lock);
+    wait_block(&wait);
+    finish_wait(&cv->wait, &wait);
+
+    local_irq_restore(flags);
+    mutex_lock(lock);
+}
+
+void condvar_signal(struct condvar* cv) {
+    wake_up(&cv->wait);
+}
+
+void condvar_broadcast(struct condvar* cv) {
+    wake_up_all(&cv->wait);
+}
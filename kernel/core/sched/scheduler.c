@@ -3,26 +3,47 @@
 #include "../../../include/uart.h"
 #include "../../../include/pmm.h"  // Add include for memory allocation
 #include "../../../include/debug.h"  // Include new debug header
+#include "../../../include/timer.h"  // One-shot slice and wakeup deadlines
+#include "../../../include/interrupts.h"  // local_irq_save/restore
+#include "../../../include/trace.h"
+#include "../../../include/perf.h"
+#include "../../../include/klog.h"
 
 // Add include for debug_print
 extern void debug_print(const char* msg);
 extern void debug_hex64(const char* label, uint64_t value);
 
 // External declarations for assembly functions
+extern void cpu_switch_to(task_t* prev, task_t* next);
 extern void save_context(task_t* task);
 extern void restore_context(task_t* task);
 extern void full_restore_context(task_t* task);
 
+// Context the boot thread is parked in on the first switch to a task
+static task_t boot_task;
+
+// Idle task - runs with the scheduler tick stopped when nothing is runnable.
+// One page-aligned page of stack, like every task stack (profile.c relies
+// on it to bound backtraces).
+#define IDLE_STACK_WORDS 512
+static task_t idle_task;
+static uint64_t idle_stack[IDLE_STACK_WORDS] __attribute__((aligned(4096)));
+
+// Set from interrupt context, consumed by schedule()
+volatile int need_resched = 0;
+
 // Function prototypes
 task_t* pick_next_task(void);
 
 // Force visibility of scheduler initialization with special attributes
 int scheduler_initialized __attribute__((used, externally_visible, section(".data"))) = 0;
 
-// Helper function to print a task's info
+// Helper function to print a task's info (debug log level only)
 void print_task_info(task_t* task) {
     volatile uint32_t *uart_raw = (volatile uint32_t *)0x09000000;
     
+    if (!KLOG_ENABLED(KLOG_DEBUG)) return;
+    
     // Print task ID
     *uart_raw = '#';
     *uart_raw = '0' + task->id;
@@ -54,24 +75,232 @@ void print_task_info(task_t* task) {
     *uart_raw = ' ';
 }
 
-// Original schedule function kept with original implementation
+// Request a reschedule at the next IRQ exit
+void set_need_resched(void) {
+    need_resched = 1;
+}
+
+// Runnable tasks (READY or RUNNING) as one ring per class through
+// next/prev. A task that blocks is taken off by schedule() and put back
+// by wake_up_task(), so picking and waking are O(1) however many tasks
+// are asleep.
+static task_t* runqueue[SCHED_NR_PRIO];
+
+// Normal picks in a row while a low-priority task was runnable
+static unsigned int low_prio_waits;
+
+static inline int task_on_rq(const task_t* task) {
+    return task->prev != NULL;
+}
+
+void enqueue_task(task_t* task) {
+    task_t** head = &runqueue[task->prio];
+    
+    if (task_on_rq(task)) return;
+    
+    if (!*head) {
+        task->next = task;
+        task->prev = task;
+        *head = task;
+        return;
+    }
+    
+    // Insert at the tail, just before the head
+    task->next = *head;
+    task->prev = (*head)->prev;
+    (*head)->prev->next = task;
+    (*head)->prev = task;
+}
+
+void dequeue_task(task_t* task) {
+    task_t** head = &runqueue[task->prio];
+    
+    if (!task_on_rq(task)) return;
+    
+    if (task->next == task) {
+        *head = NULL;
+    } else {
+        task->prev->next = task->next;
+        task->next->prev = task->prev;
+        if (*head == task) *head = task->next;
+    }
+    task->next = NULL;
+    task->prev = NULL;
+}
+
+void sched_set_prio(task_t* task, int prio) {
+    if (prio < 0 || prio >= SCHED_NR_PRIO) return;
+    
+    unsigned long flags = local_irq_save();
+    int queued = task_on_rq(task);
+    
+    dequeue_task(task);
+    task->prio = prio;
+    if (queued) enqueue_task(task);
+    local_irq_restore(flags);
+}
+
+// Called with the task schedule() is about to run (possibly the current
+// one again). Low-priority tasks take turns by rotating their ring's head.
+static void sched_account(task_t* next) {
+    if (next->prio == SCHED_PRIO_LOW) {
+        runqueue[SCHED_PRIO_LOW] = next->next;
+        low_prio_waits = 0;
+    } else if (runqueue[SCHED_PRIO_LOW]) {
+        low_prio_waits++;
+    }
+}
+
+int wake_up_task(task_t* task) {
+    unsigned long flags = local_irq_save();
+    int woken = task->state == TASK_BLOCKED;
+    
+    if (woken) {
+        task->state = TASK_READY;
+        enqueue_task(task);
+        set_need_resched();
+    }
+    local_irq_restore(flags);
+    return woken;
+}
+
+// Idle loop: the slice timer is stopped, so the core sleeps in wfi until a
+// sleeper wakeup (or any other interrupt) makes a task runnable again
+static void idle_loop(void) {
+    while (1) {
+        asm volatile("msr daifclr, #2\n"
+                     "wfi" ::: "memory");
+        if (pick_next_task()) {
+            schedule();
+        }
+    }
+}
+
+static task_t* get_idle_task(void) {
+    if (!idle_task.context.lr) {
+        idle_task.id = -1;
+        idle_task.state = TASK_READY;
+        task_init_context(&idle_task, idle_loop, idle_stack + IDLE_STACK_WORDS);
+    }
+    return &idle_task;
+}
+
+// Pick the next task and switch to it. Returns when prev is scheduled again.
 void schedule() {
-    // Get next task according to scheduling policy
+    unsigned long flags = local_irq_save();
+    need_resched = 0;
+    
+    // Get next task according to scheduling policy. A task that blocked
+    // itself leaves the run queue here; its successor keeps the RR order.
     task_t* next = pick_next_task();
-    if (!next) return;  // No tasks to run
+    if (current_task && current_task->state == TASK_BLOCKED) {
+        dequeue_task(current_task);
+        if (next == current_task) next = pick_next_task();
+    }
+    if (next) {
+        sched_account(next);
+    } else {
+        // Nothing runnable: keep going if the current task still can,
+        // otherwise fall into idle with the tick stopped
+        if (current_task && current_task->state == TASK_RUNNING) {
+            local_irq_restore(flags);
+            return;
+        }
+        next = get_idle_task();
+    }
     
-    // Update task states
-    if (current_task) current_task->state = TASK_READY;
+    task_t* prev = current_task ? current_task : &boot_task;
+    if (next == prev) {
+        local_irq_restore(flags);
+        return;
+    }
+    
+    // Update task states (a task that blocked itself stays blocked)
+    if (current_task && current_task->state == TASK_RUNNING) current_task->state = TASK_READY;
     next->state = TASK_RUNNING;
     current_task = next;
     
-    // Perform context switch
-    full_restore_context(current_task);
+    // One-shot tick: arm the end of next's slice, or stop the tick in idle
+    if (next == &idle_task) {
+        timer_stop_tick();
+    } else {
+        timer_set_slice_deadline(timer_read_counter() + timer_slice_ticks());
+    }
+    
+    trace_sched_switch(prev->id, next->id, prev->state);
+    perf_task_switch(prev, next);
+    
+    // Perform context switch (callee-saved state only, see context.S)
+    cpu_switch_to(prev, next);
+    
+    perf_task_switch_done();
+    local_irq_restore(flags);
+}
+
+// First C code of a new task (cpu_task_entry). The switch into it came
+// from schedule() or an IRQ exit with IRQs masked, and the tail of that
+// schedule() call (closing the switch's perf region, local_irq_restore())
+// belongs to the task that was switched away from, so redo it here.
+void schedule_tail(void) {
+    perf_task_switch_done();
+    asm volatile("msr daifclr, #2" ::: "memory");
+}
+
+// Hand the CPU from the boot thread to the current (or first) task, at
+// the end of kernel_main() with IRQs masked. Returns only if some task
+// later switches back to boot_task.
+void sched_start(void) {
+    task_t* first = current_task ? current_task : pick_next_task();
+    if (!first) return;
+    
+    scheduler_initialized = 1;
+    first->state = TASK_RUNNING;
+    current_task = first;
+    timer_set_slice_deadline(timer_read_counter() + timer_slice_ticks());
+    perf_task_switch(&boot_task, first);
+    cpu_switch_to(&boot_task, first);
+}
+
+// Timer wheel callback for sleep_us(): make the sleeper runnable again
+static void sleep_timeout(void* arg) {
+    task_t* task = (task_t*)arg;
+    
+    task->wake_at = 0;
+    wake_up_task(task);
+}
+
+// Block the current task until at least `us` microseconds have passed.
+// The wakeup is a timer wheel entry, so the CPU idles meanwhile.
+void sleep_us(uint64_t us) {
+    uint64_t deadline = timer_read_counter() + timer_us_to_ticks(us);
+    
+    if (!current_task || current_task == &idle_task) {
+        // Boot thread: no task to block, wait in wfi for the deadline
+        timer_request_wakeup(deadline);
+        while (timer_read_counter() < deadline) {
+            asm volatile("wfi");
+        }
+        return;
+    }
+    
+    ktimer_t timer = {0};
+    unsigned long flags = local_irq_save();
+    current_task->wake_at = deadline ? deadline : 1;
+    current_task->state = TASK_BLOCKED;
+    timer_start(&timer, deadline, sleep_timeout, current_task);
+    schedule();
+    
+    // Woken early by someone else: the timer lives on our stack
+    timer_cancel(&timer);
+    local_irq_restore(flags);
+}
+
+void msleep(uint64_t ms) {
+    sleep_us(ms * 1000);
 }
 
 // Function to yield CPU to next task
 void yield() {
-    debug_print("[YIELD] Called\n");
     schedule();
 }
 
@@ -94,23 +323,21 @@ void init_task_scheduler() {
     init_tasks();  // Defined in task.c
 }
 
+// Round-robin over the normal ring: the task after the current one, or
+// the head if the current task is not on it (boot thread, idle, blocked,
+// low priority). The low ring only when the normal one is empty or has
+// been picked SCHED_LOW_PRIO_STARVE times in a row.
 task_t* pick_next_task(void) {
-    if (task_count < 1) return NULL;
-    
-    // Find current task index
-    int current_idx = 0;
-    for (int i = 0; i < task_count; i++) {
-        if (task_list[i] == current_task) {
-            current_idx = i;
-            break;
-        }
-    }
-    
-    // Simple round-robin for now
-    int next_idx = (current_idx + 1) % task_count;
+    task_t* normal = runqueue[SCHED_PRIO_NORMAL];
+    task_t* low = runqueue[SCHED_PRIO_LOW];
     
-    // Return the next runnable task
-    return task_list[next_idx];
+    if (!normal || (low && low_prio_waits >= SCHED_LOW_PRIO_STARVE)) {
+        return low;
+    }
+    if (current_task && task_on_rq(current_task) && current_task->prio == SCHED_PRIO_NORMAL) {
+        return current_task->next;
+    }
+    return normal;
 }
 
 // Task counter variables
@@ -184,16 +411,6 @@ void task_d_test() {
 }
 
 void timer_handler() {
-    // Display a dot to show timer firing
-    uart_putc('.');
-    
-    // Save current task's context
-    if (current_task) {
-        save_context(current_task);
-    }
-    
-    // Schedule the next task
+    // Schedule the next task - cpu_switch_to() saves the current context
     schedule();
-    
-    // Won't reach here - schedule() doesn't return
 }
@@ -0,0 +1,40 @@
+/*
+ * semaphore.c - Counting semaphores
+ */
+
+#include "../../../include/semaphore.h"
+#include "../../../include/interrupts.h"
+
+void down(struct semaphore* sem) {
+    struct wait_queue_entry wait;
+    unsigned long flags = local_irq_save();
+
+    if (sem->count > 0) {
+        sem->count--;
+    } else {
+        // up() passes its unit to us instead of bumping count
+        prepare_to_wait(&sem->wait, &wait);
+        wait_block(&wait);
+        finish_wait(&sem->wait, &wait);
+    }
+
+    local_irq_restore(flags);
+}
+
+int down_trylock(struct semaphore* sem) {
+    unsigned long flags = local_irq_save();
+    int taken = sem->count > 0;
+
+    if (taken) sem->count--;
+
+    local_irq_restore(flags);
+    return taken;
+}
+
+void up(struct semaphore* sem) {
+    unsigned long flags = local_irq_save();
+
+    if (!wake_up(&sem->wait)) sem->count++;
+
+    local_irq_restore(flags);
+}
@@ -0,0 +1,95 @@
+/*
+ * wait.c - Wait queues
+ *
+ * A sleeper links an entry from its own stack into the queue, marks
+ * itself TASK_BLOCKED and calls schedule(), which leaves it off the CPU
+ * until wake_up() dequeues the entry and makes the task runnable again.
+ * All queue manipulation happens with IRQs masked.
+ */
+
+#include "../../../include/wait.h"
+#include "../../../include/scheduler.h"
+
+static void wait_queue_unlink(struct wait_queue_head* wq, struct wait_queue_entry* wait) {
+    if (wait->prev) wait->prev->next = wait->next;
+    else wq->first = wait->next;
+
+    if (wait->next) wait->next->prev = wait->prev;
+    else wq->last = wait->prev;
+
+    wait->next = NULL;
+    wait->prev = NULL;
+}
+
+void prepare_to_wait(struct wait_queue_head* wq, struct wait_queue_entry* wait) {
+    wait->task = current_task;
+    wait->woken = 0;
+    wait->next = NULL;
+    wait->prev = wq->last;
+
+    if (wq->last) wq->last->next = wait;
+    else wq->first = wait;
+    wq->last = wait;
+
+    if (current_task) current_task->state = TASK_BLOCKED;
+}
+
+void wait_block(struct wait_queue_entry* wait) {
+    while (!wait->woken) {
+        if (!wait->task) {
+            // Boot thread: nothing to switch away from, wait in wfi
+            __asm__ volatile("msr daifclr, #2\n"
+                             "wfi\n"
+                             "msr daifset, #2" ::: "memory");
+            continue;
+        }
+
+        // Also re-blocks after a wake_up_task() that was not ours
+        wait->task->state = TASK_BLOCKED;
+        schedule();
+    }
+}
+
+void finish_wait(struct wait_queue_head* wq, struct wait_queue_entry* wait) {
+    if (!wait->woken) wait_queue_unlink(wq, wait);
+
+    if (wait->task && wait->task->state == TASK_BLOCKED) {
+        wait->task->state = TASK_RUNNING;
+    }
+}
+
+// Dequeue and wake one entry (IRQs masked). The entry lives on the
+// sleeper's stack, so nothing may touch it once woken is set.
+static void wake_entry(struct wait_queue_head* wq, struct wait_queue_entry* wait) {
+    task_t* task = wait->task;
+
+    wait_queue_unlink(wq, wait);
+    __atomic_store_n(&wait->woken, 1, __ATOMIC_RELEASE);
+    if (task) wake_up_task(task);
+}
+
+int wake_up(struct wait_queue_head* wq) {
+    unsigned long flags = local_irq_save();
+    int woken = 0;
+
+    if (wq->first) {
+        wake_entry(wq, wq->first);
+        woken = 1;
+    }
+
+    local_irq_restore(flags);
+    return woken;
+}
+
+int wake_up_all(struct wait_queue_head* wq) {
+    unsigned long flags = local_irq_save();
+    int woken = 0;
+
+    while (wq->first) {
+        wake_entry(wq, wq->first);
+        woken++;
+    }
+
+    local_irq_restore(flags);
+    return woken;
+}
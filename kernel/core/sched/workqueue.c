@@ -0,0 +1,70 @@
+/*
+ * workqueue.c - Deferred work in kernel threads
+ *
+ * For bottom halves that take too long for softirq context or need to
+ * sleep. Each CPU has a FIFO of work items and one worker thread that
+ * sleeps on a wait queue while the FIFO is empty; queue_work() only links
+ * the item and wakes the worker, so it is cheap enough for interrupt
+ * context.
+ */
+
+#include "../../../include/workqueue.h"
+#include "../../../include/scheduler.h"
+#include "../../../include/wait.h"
+#include "../../../include/interrupts.h"
+#include "../../../include/percpu.h"
+
+struct worker_pool {
+    struct work_struct* head;
+    struct work_struct** tail;
+    struct wait_queue_head more_work;
+};
+
+static struct worker_pool worker_pools[NR_CPUS];
+
+int queue_work(struct work_struct* work) {
+    struct worker_pool* pool = &worker_pools[smp_processor_id()];
+    unsigned long flags = local_irq_save();
+
+    if (work->pending) {
+        local_irq_restore(flags);
+        return 0;
+    }
+
+    if (!pool->tail) pool->tail = &pool->head;
+    work->pending = 1;
+    work->next = NULL;
+    *pool->tail = work;
+    pool->tail = &work->next;
+
+    wake_up(&pool->more_work);
+
+    local_irq_restore(flags);
+    return 1;
+}
+
+static void worker_thread(void) {
+    struct worker_pool* pool = &worker_pools[smp_processor_id()];
+
+    while (1) {
+        wait_event(pool->more_work, pool->head);
+
+        unsigned long flags = local_irq_save();
+        struct work_struct* work = pool->head;
+
+        pool->head = work->next;
+        if (!pool->head) pool->tail = &pool->head;
+
+        // Cleared before the call so the item may requeue itself
+        work->pending = 0;
+        local_irq_restore(flags);
+
+        work->func(work);
+    }
+}
+
+// Tasks are not bound to CPUs yet; with NR_CPUS == 1 the boot CPU's
+// worker is the only one
+void workqueue_init(void) {
+    create_task(worker_thread);
+}
@@ -1,68 +1,195 @@
 #include "../../../include/syscall.h"
 #include "../../../include/uart.h"  // for uart_puts() and uart_hex64()
+#include "../../../include/klog.h"
+#include "../../../include/scheduler.h"  // for sleep_us()
+#include "../../../include/clocksource.h"
+#include "../../../include/percpu.h"
+#include "../../../include/uaccess.h"
+#include "../../../include/console.h"
+#include "../../../include/trace.h"
 
-// Debug helper function to display a clear syscall boundary
-void syscall_debug_marker(void) {
-    uart_puts("\n====================\n");
-    uart_puts("SYSCALL DEBUG MARKER\n");
-    uart_puts("====================\n");
+// Kernel bounce buffer per sys_write() round; the console batches across
+// rounds and is flushed once per call
+#define SYS_WRITE_CHUNK 256
+
+// Table entries take the saved frame and pick their own arguments out of
+// x0-x5, so every handler has the same signature
+typedef uint64_t (*syscall_fn_t)(const struct pt_regs* regs);
+
+struct syscall_entry {
+    syscall_fn_t fn;
+    uint8_t nargs;              // Arguments shown by the trace
+    const char* name;
+};
+
+static struct syscall_stat syscall_stats[NR_CPUS][NR_SYSCALLS];
+
+// Checked once per call; prints only happen when set
+static volatile int syscall_trace;
+
+void syscall_set_trace(int enable) {
+    syscall_trace = enable;
 }
 
 void sys_hello(void) {
-    syscall_debug_marker();
     uart_puts("[SYSCALL] Hello from user task!\n");
 }
 
-void sys_write(uint64_t arg0) {
-    syscall_debug_marker();
-    uart_puts("[SYSCALL] Write called with arg: ");
-    uart_hex64(arg0);
-    uart_puts("\n");
+uint64_t sys_write(uint64_t fd, const void* buf, size_t len) {
+    char chunk[SYS_WRITE_CHUNK];
+    const char* ubuf = (const char*)buf;
+    size_t done = 0;
+    
+    if (fd != STDOUT_FILENO && fd != STDERR_FILENO) return (uint64_t)-EBADF;
+    if (!access_ok(buf, len)) return (uint64_t)-EFAULT;
+    
+    while (done < len) {
+        size_t n = len - done < SYS_WRITE_CHUNK ? len - done : SYS_WRITE_CHUNK;
+        if (copy_from_user(chunk, ubuf + done, n)) break;
+        console_write(chunk, n);
+        done += n;
+    }
+    console_flush();
+    
+    // A mapping that vanished mid-copy still reports the partial write
+    if (!done && len) return (uint64_t)-EFAULT;
+    return done;
 }
 
 void sys_exit(uint64_t exit_code) {
-    syscall_debug_marker();
-    uart_puts("[SYSCALL] Exit called with code: ");
-    uart_hex64(exit_code);
-    uart_puts("\n");
-    // In a real implementation, this would terminate the current process
-    // For now, just print the exit code
+    // In a real implementation, this would terminate the current process.
+    // The exit code is visible in the trace.
+    (void)exit_code;
 }
 
 void sys_yield(void) {
-    syscall_debug_marker();
-    uart_puts("[SYSCALL] Yield called - would switch to next task\n");
     // In a real implementation, this would trigger a context switch
-    // For now, just print a message
 }
 
-void syscall_dispatch(uint64_t num, struct trap_frame* tf) {
-    // Add a clear marker to show the syscall dispatch is being called
-    uart_puts("\n[SYSCALL DISPATCH] Received syscall #");
-    uart_hex64(num);
-    uart_puts("\n");
+void sys_nanosleep(uint64_t ns) {
+    // Block on the timer wheel; microsecond resolution, rounded up
+    sleep_us((ns + 999) / 1000);
+}
+
+uint64_t sys_getpid(void) {
+    return current_task ? (uint64_t)current_task->id : 0;
+}
+
+uint64_t sys_syscall_stats(uint64_t nr, uint64_t which) {
+    struct syscall_stat stat;
     
-    switch (num) {
-        case SYS_HELLO:
-            uart_puts("[SYSCALL] Dispatching SYS_HELLO\n");
-            sys_hello();
-            break;
-        case SYS_WRITE:
-            uart_puts("[SYSCALL] Dispatching SYS_WRITE\n");
-            sys_write(tf ? tf->x0 : 0);
-            break;
-        case SYS_EXIT:
-            uart_puts("[SYSCALL] Dispatching SYS_EXIT\n");
-            sys_exit(tf ? tf->x0 : 0);
-            break;
-        case SYS_YIELD:
-            uart_puts("[SYSCALL] Dispatching SYS_YIELD\n");
-            sys_yield();
-            break;
+    if (syscall_get_stats(nr, &stat) < 0) return (uint64_t)-EINVAL;
+    
+    switch (which) {
+        case SYSCALL_STAT_COUNT:
+            return stat.count;
+        case SYSCALL_STAT_CYCLES:
+            return stat.cycles;
         default:
-            uart_puts("[SYSCALL] Unknown syscall number: ");
-            uart_hex64(num);
-            uart_puts("\n");
-            break;
+            return (uint64_t)-EINVAL;
+    }
+}
+
+int syscall_get_stats(unsigned int nr, struct syscall_stat* out) {
+    if (nr >= NR_SYSCALLS) return -1;
+    
+    out->count = 0;
+    out->cycles = 0;
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        out->count += syscall_stats[cpu][nr].count;
+        out->cycles += syscall_stats[cpu][nr].cycles;
     }
+    return 0;
+}
+
+static uint64_t __sys_hello(const struct pt_regs* regs) {
+    (void)regs;
+    sys_hello();
+    return 0;
+}
+
+static uint64_t __sys_write(const struct pt_regs* regs) {
+    return sys_write(regs->regs[0], (const void*)regs->regs[1], regs->regs[2]);
+}
+
+static uint64_t __sys_exit(const struct pt_regs* regs) {
+    sys_exit(regs->regs[0]);
+    return 0;
+}
+
+static uint64_t __sys_yield(const struct pt_regs* regs) {
+    (void)regs;
+    sys_yield();
+    return 0;
+}
+
+static uint64_t __sys_nanosleep(const struct pt_regs* regs) {
+    sys_nanosleep(regs->regs[0]);
+    return 0;
+}
+
+static uint64_t __sys_getpid(const struct pt_regs* regs) {
+    (void)regs;
+    return sys_getpid();
+}
+
+static uint64_t __sys_syscall_stats(const struct pt_regs* regs) {
+    return sys_syscall_stats(regs->regs[0], regs->regs[1]);
+}
+
+static const struct syscall_entry sys_call_table[NR_SYSCALLS] = {
+    [SYS_HELLO]         = { __sys_hello,         0, "hello" },
+    [SYS_WRITE]         = { __sys_write,         3, "write" },
+    [SYS_EXIT]          = { __sys_exit,          1, "exit" },
+    [SYS_YIELD]         = { __sys_yield,         0, "yield" },
+    [SYS_NANOSLEEP]     = { __sys_nanosleep,     1, "nanosleep" },
+    [SYS_GETPID]        = { __sys_getpid,        0, "getpid" },
+    [SYS_SYSCALL_STATS] = { __sys_syscall_stats, 2, "syscall_stats" },
+};
+
+// Slow path kept out of line so the dispatch stays small
+static void __attribute__((noinline)) syscall_trace_entry(uint64_t num, const struct pt_regs* regs) {
+    uart_puts("[SYSCALL] ");
+    if (num < NR_SYSCALLS) {
+        const struct syscall_entry* entry = &sys_call_table[num];
+        uart_puts(entry->name);
+        uart_puts("(");
+        for (int i = 0; i < entry->nargs; i++) {
+            if (i) uart_puts(", ");
+            uart_hex64(regs->regs[i]);
+        }
+        uart_puts(")\n");
+    } else {
+        uart_puts("unknown #");
+        uart_hex64(num);
+        uart_puts("\n");
+    }
+}
+
+static void __attribute__((noinline)) syscall_trace_exit(uint64_t ret) {
+    uart_puts("[SYSCALL]   = ");
+    uart_hex64(ret);
+    uart_puts("\n");
+}
+
+uint64_t syscall_dispatch(uint64_t num, struct pt_regs* regs) {
+    // Tracing is compiled out of builds without debug-level output
+    int trace = KLOG_ENABLED(KLOG_DEBUG) && syscall_trace;
+    
+    if (trace) syscall_trace_entry(num, regs);
+    if (num >= NR_SYSCALLS) {
+        if (trace) syscall_trace_exit((uint64_t)-ENOSYS);
+        return (uint64_t)-ENOSYS;
+    }
+    
+    struct syscall_stat* stat = &syscall_stats[smp_processor_id()][num];
+    uint64_t start = clocksource_read();
+    uint64_t ret = sys_call_table[num].fn(regs);
+    
+    stat->cycles += clocksource_read() - start;
+    stat->count++;
+    trace_syscall(num, ret, start);
+    
+    if (trace) syscall_trace_exit(ret);
+    return ret;
 }
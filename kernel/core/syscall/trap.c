@@ -4,7 +4,8 @@
 #include "../../../include/syscall.h"  // Include syscall header
 
 // Export symbols for vector table
-void sync_el0_handler(void) __attribute__((used, externally_visible));
+void sync_el0_handler(struct pt_regs* regs, uint64_t esr) __attribute__((used, externally_visible));
+void bad_mode_el0_32(struct pt_regs* regs, uint64_t esr) __attribute__((used, externally_visible));
 void irq_el0_handler(void) __attribute__((used, externally_visible));
 void fiq_el0_handler(void) __attribute__((used, externally_visible));
 void serror_el0_handler(void) __attribute__((used, externally_visible));
@@ -19,152 +20,44 @@ void print_current_el(void) {
     uart_puts("\n");
 }
 
-void sync_el0_handler(void) {
+// Non-SVC synchronous exception from EL0. SVCs never get here: el0_sync
+// in entry.S dispatches them directly.
+void sync_el0_handler(struct pt_regs* regs, uint64_t esr) {
     uart_puts("\n!!! [TRAP] Synchronous trap from EL0 received !!!\n");
     
-    // Log CurrentEL to verify if this is really from EL0
-    uint64_t currentEL;
-    asm volatile("mrs %0, CurrentEL" : "=r"(currentEL));
-    currentEL = (currentEL >> 2) & 0x3; // Extract EL bits
-    uart_puts("[TRAP] CurrentEL: ");
-    uart_puthex(currentEL);
-    uart_puts("\n");
-    
-    print_current_el(); // This is redundant now but kept for backward compatibility
-    
-    // Read ESR_EL1 to determine the cause of the exception
-    uint64_t esr;
-    asm volatile("mrs %0, esr_el1" : "=r"(esr));
-    
     // Extract exception class (EC) field
     uint32_t ec = (esr >> 26) & 0x3F;
     
-    uart_puts("[TRAP] Exception class (EC): 0x");
+    uart_puts("[TRAP] Exception class (EC): ");
     uart_puthex(ec);
+    uart_puts("\n[TRAP] ELR_EL1: ");
+    uart_hex64(regs->pc);
+    uart_puts("\n[TRAP] SP_EL0: ");
+    uart_hex64(regs->sp);
     uart_puts("\n");
     
-    // Check if it's an SVC instruction (EC = 0x15 for AArch64 SVC)
-    if (ec == 0x15) {
-        // Extract the immediate value from the SVC instruction
-        uint32_t svc_imm = esr & 0xFFFF;
-        
-        // Print the SVC number
-        uart_puts("[TRAP] SVC #");
-        uart_puthex(svc_imm);
-        uart_puts(" called from EL0\n");
-        
-        // Read the x0 register value that was passed from EL0
-        uint64_t x0_value;
-        asm volatile("mrs x0, elr_el1\n"  // Get ELR_EL1 (PC where exception occurred)
-                     "add x0, x0, #4\n"   // Skip over the SVC instruction (4 bytes)
-                     "msr elr_el1, x0\n"  // Update ELR_EL1 to return after SVC
-                     "mrs %0, sp_el0" : "=r"(x0_value)); // Get user's x0 from sp_el0
-        
-        // Display x0 value from user
-        uart_puts("[TRAP] x0 value from user: 0x");
-        uart_puthex(x0_value);
-        uart_puts("\n");
-        
-        // Create a basic trap frame with the x0 value
-        struct trap_frame tf;
-        tf.x0 = x0_value;
-        
-        uart_puts("[TRAP] Calling syscall_dispatch with number: ");
-        uart_puthex(svc_imm);
-        uart_puts("\n");
-        
-        // Call the syscall dispatcher with the syscall number and trap frame
-        syscall_dispatch(svc_imm, &tf);
-        
-        // For now, after handling the syscall, just indicate we're returning to EL0
-        uart_puts("[TRAP] Returning to EL0\n");
-            
-        // Eventually in Step 5, we'll restore user state and return properly
-        // But for now, we'll still halt the system
-        uart_puts("[TRAP] Halting system after syscall - NOT returning to user mode\n");
-    } else {
-        // Not an SVC - display the exception class
-        uart_puts("[TRAP] Synchronous exception with EC=0x");
-        uart_puthex(ec);
-        uart_puts("\n");
-    }
-    
     // Halt in an infinite loop
     uart_puts("[TRAP] Halting in infinite loop\n");
     while (1);
 }
 
 // Add handlers for EL1 exceptions to help debugging
-void sync_el1_handler(void) __attribute__((used, externally_visible));
 void irq_el1_handler(void) __attribute__((used, externally_visible));
 void fiq_el1_handler(void) __attribute__((used, externally_visible));
 void serror_el1_handler(void) __attribute__((used, externally_visible));
 
-void sync_el1_handler(void) {
-    uart_puts("\n!!! [TRAP] Synchronous trap from EL1 received !!!\n");
-    print_current_el();
-    
-    // Read ESR_EL1 to determine the cause of the exception
-    uint64_t esr;
-    asm volatile("mrs %0, esr_el1" : "=r"(esr));
-    
-    // Extract exception class (EC) field
-    uint32_t ec = (esr >> 26) & 0x3F;
-    
-    uart_puts("[TRAP] Exception class (EC): 0x");
-    uart_puthex(ec);
+// Synchronous exception from an AArch32 EL0 context. Nothing ever starts
+// one, so there is no AArch32 syscall ABI to dispatch to.
+void bad_mode_el0_32(struct pt_regs* regs, uint64_t esr) {
+    uart_puts("\n!!! [TRAP] Bad mode: synchronous trap from EL0/AArch32 !!!\n");
+    uart_puts("[TRAP] ESR_EL1: ");
+    uart_puthex((uint32_t)esr);
+    uart_puts("\n[TRAP] ELR_EL1: ");
+    uart_hex64(regs->pc);
     uart_puts("\n");
     
-    // Check if it's an SVC instruction (EC = 0x15 for AArch64 SVC)
-    if (ec == 0x15) {
-        // Extract the immediate value from the SVC instruction
-        uint32_t svc_imm = esr & 0xFFFF;
-        
-        // Print the SVC number
-        uart_puts("[TRAP] SVC #");
-        uart_puthex(svc_imm);
-        uart_puts(" called from EL1\n");
-        
-        // Read ELR_EL1 for PC where exception occurred
-        uint64_t elr;
-        asm volatile("mrs %0, elr_el1" : "=r"(elr));
-        uart_puts("[TRAP] ELR_EL1 (PC): 0x");
-        uart_hex64(elr);
-        uart_puts("\n");
-        
-        // Get x0 value
-        uint64_t x0_value;
-        asm volatile("mov %0, x0" : "=r"(x0_value));
-        
-        // Display x0 value
-        uart_puts("[TRAP] x0 value: 0x");
-        uart_hex64(x0_value);
-        uart_puts("\n");
-        
-        // Create a basic trap frame with the x0 value
-        struct trap_frame tf;
-        tf.x0 = x0_value;
-        
-        // Call the syscall dispatcher with the syscall number and trap frame
-        syscall_dispatch(svc_imm, &tf);
-        
-        // Skip over SVC instruction for return
-        asm volatile(
-            "mrs x0, elr_el1\n"
-            "add x0, x0, #4\n"
-            "msr elr_el1, x0\n"
-            "eret"
-        );
-    } else {
-        // Not an SVC - display the exception class
-        uart_puts("[TRAP] Synchronous exception from EL1 with EC=0x");
-        uart_puthex(ec);
-        uart_puts("\n");
-        
-        // Halt in an infinite loop
-        uart_puts("[TRAP] Halting in infinite loop\n");
-        while (1);
-    }
+    uart_puts("[TRAP] Halting in infinite loop\n");
+    while (1);
 }
 
 void irq_el0_handler(void) {
@@ -3,6 +3,13 @@
 #include "../../../include/string.h"
 #include "../../../include/types.h" // For uint64_t and other types
 #include "../../../include/uart.h"  // For uart_puts
+#include "../../../include/workqueue.h"
+#include "../../../include/klog.h"
+#include "../../../include/printf.h"
+#include "../../../include/perf.h"
+#include "../../../include/ptrace.h"
+#include "../../../include/scheduler.h"
+#include "../../../include/interrupts.h"
 
 // External function declarations
 extern void full_restore_context(task_t* task);
@@ -17,121 +24,31 @@ typedef __builtin_va_list va_list;
 #define va_arg(v,l) __builtin_va_arg(v,l)
 // size_t is already defined in types.h
 
-// Forward declare debug_print for use with snprintf
-extern void debug_print(const char* msg);
-
-// Simple snprintf implementation (for debugging)
-int snprintf(char* buffer, size_t count, const char* format, ...) {
-    va_list args;
-    va_start(args, format);
-    
-    int written = 0;
-    size_t i;
-    
-    // Only handle a limited set of format specifiers for debugging
-    for (i = 0; format[i] != '\0' && written < count - 1; i++) {
-        if (format[i] != '%') {
-            buffer[written++] = format[i];
-            continue;
-        }
-        
-        i++; // Skip '%'
-        
-        switch (format[i]) {
-            case 'x': {
-                // Handle hex format
-                uint64_t val = va_arg(args, uint64_t);
-                char hex_chars[] = "0123456789abcdef";
-                
-                // Skip leading zeros
-                int started = 0;
-                for (int shift = 60; shift >= 0; shift -= 4) {
-                    int digit = (val >> shift) & 0xF;
-                    if (digit != 0 || started || shift == 0) {
-                        started = 1;
-                        buffer[written++] = hex_chars[digit];
-                        if (written >= count - 1) break;
-                    }
-                }
-                break;
-            }
-            case 'l': {
-                // Handle %lx format
-                if (format[++i] != 'x') {
-                    buffer[written++] = '%';
-                    buffer[written++] = 'l';
-                    buffer[written++] = format[i];
-                    break;
-                }
-                
-                uint64_t val = va_arg(args, uint64_t);
-                char hex_chars[] = "0123456789abcdef";
-                
-                // Add 0x prefix
-                buffer[written++] = '0';
-                if (written >= count - 1) break;
-                buffer[written++] = 'x';
-                if (written >= count - 1) break;
-                
-                // Skip leading zeros
-                int started = 0;
-                for (int shift = 60; shift >= 0; shift -= 4) {
-                    int digit = (val >> shift) & 0xF;
-                    if (digit != 0 || started || shift == 0) {
-                        started = 1;
-                        buffer[written++] = hex_chars[digit];
-                        if (written >= count - 1) break;
-                    }
-                }
-                break;
-            }
-            case 'd': {
-                // Handle decimal format
-                int val = va_arg(args, int);
-                
-                // Handle negative numbers
-                if (val < 0) {
-                    buffer[written++] = '-';
-                    if (written >= count - 1) break;
-                    val = -val;
-                }
-                
-                // Convert to digits
-                char digits[20];
-                int ndigits = 0;
-                
-                do {
-                    digits[ndigits++] = '0' + (val % 10);
-                    val /= 10;
-                } while (val > 0 && ndigits < 19);
-                
-                // Output in correct order
-                for (int j = ndigits - 1; j >= 0 && written < count - 1; j--) {
-                    buffer[written++] = digits[j];
-                }
-                break;
-            }
-            case 's': {
-                // Handle string format
-                char* str = va_arg(args, char*);
-                while (*str && written < count - 1) {
-                    buffer[written++] = *str++;
-                }
-                break;
-            }
-            default:
-                // Just output the character
-                buffer[written++] = format[i];
-                break;
-        }
-        
-        if (written >= count - 1) break;
-    }
-    
-    buffer[written] = '\0';
-    va_end(args);
-    return written;
-}
+// context.S addresses task_t through the offsets in task.h
+_Static_assert(__builtin_offsetof(task_t, next) == TASK_NEXT, "TASK_NEXT out of sync");
+_Static_assert(__builtin_offsetof(task_t, state) == TASK_STATE, "TASK_STATE out of sync");
+_Static_assert(__builtin_offsetof(task_t, id) == TASK_ID, "TASK_ID out of sync");
+_Static_assert(__builtin_offsetof(task_t, wake_at) == TASK_WAKE_AT, "TASK_WAKE_AT out of sync");
+_Static_assert(__builtin_offsetof(task_t, prev) == TASK_PREV, "TASK_PREV out of sync");
+_Static_assert(__builtin_offsetof(task_t, prio) == TASK_PRIO, "TASK_PRIO out of sync");
+_Static_assert(TASK_PRIO + sizeof(int) <= CACHE_LINE_SIZE, "hot header must fit one cache line");
+_Static_assert(__builtin_offsetof(task_t, context) == TASK_CONTEXT, "TASK_CONTEXT out of sync");
+_Static_assert(TASK_REGSAVE % CACHE_LINE_SIZE == 0, "register save area must be line aligned");
+_Static_assert(__builtin_offsetof(task_t, stack_ptr) == TASK_STACK_PTR, "TASK_STACK_PTR out of sync");
+_Static_assert(__builtin_offsetof(task_t, regs) == TASK_REGS, "TASK_REGS out of sync");
+_Static_assert(__builtin_offsetof(task_t, pc) == TASK_PC, "TASK_PC out of sync");
+_Static_assert(__builtin_offsetof(task_t, spsr) == TASK_SPSR, "TASK_SPSR out of sync");
+_Static_assert(__builtin_offsetof(task_t, name) == TASK_COLD, "TASK_COLD out of sync");
+_Static_assert(sizeof(task_t) % CACHE_LINE_SIZE == 0, "task_t must be a whole number of lines");
+_Static_assert(__builtin_offsetof(cpu_context_t, x19) == CTX_X19, "CTX_X19 out of sync");
+_Static_assert(__builtin_offsetof(cpu_context_t, x21) == CTX_X21, "CTX_X21 out of sync");
+_Static_assert(__builtin_offsetof(cpu_context_t, x23) == CTX_X23, "CTX_X23 out of sync");
+_Static_assert(__builtin_offsetof(cpu_context_t, x25) == CTX_X25, "CTX_X25 out of sync");
+_Static_assert(__builtin_offsetof(cpu_context_t, x27) == CTX_X27, "CTX_X27 out of sync");
+_Static_assert(__builtin_offsetof(cpu_context_t, fp) == CTX_FP, "CTX_FP out of sync");
+_Static_assert(__builtin_offsetof(cpu_context_t, lr) == CTX_FP + 8, "LR must follow FP");
+_Static_assert(__builtin_offsetof(cpu_context_t, sp) == CTX_SP, "CTX_SP out of sync");
+_Static_assert(__builtin_offsetof(cpu_context_t, tpidr) == CTX_SP + 8, "TPIDR must follow SP");
 
 #define MAX_TASKS 8
 task_t* task_list[MAX_TASKS];
@@ -139,6 +56,21 @@ int current_task_index = 0;
 task_t* current_task = NULL;
 int task_count = 0;
 
+// First-run entry for cpu_switch_to(), defined in context.S
+extern void cpu_task_entry(void);
+
+// Exception return to EL0 from the frame at SP, defined in entry.S
+extern void ret_to_user(void);
+
+// Prepare a task's kernel context so the first cpu_switch_to() into it
+// starts entry_point on stack_top with a clean frame chain
+void task_init_context(task_t* task, void (*entry_point)(void), uint64_t* stack_top) {
+    memset(&task->context, 0, sizeof(task->context));
+    task->context.x19 = (uint64_t)entry_point;
+    task->context.lr = (uint64_t)cpu_task_entry;
+    task->context.sp = (uint64_t)stack_top & ~0xFUL;
+}
+
 // Known good function that's used for testing/verifying
 void known_alive_function() {
     volatile uint32_t *uart_raw = (volatile uint32_t *)0x09000000;
@@ -248,18 +180,7 @@ void init_tasks() {
         task_list[i] = NULL;
     }
     
-    // Direct UART messages to show progress
-    volatile uint32_t* uart = (volatile uint32_t*)0x09000000;
-    *uart = '[';
-    *uart = 'I';
-    *uart = 'N';
-    *uart = 'I';
-    *uart = 'T';
-    *uart = '_';
-    *uart = 'T';
-    *uart = ']';
-    *uart = '\r';
-    *uart = '\n';
+    pr_debug("[TASK] Creating kernel tasks");
     
     // Create test tasks (for scheduler testing)
     extern void task_a_test(void);
@@ -270,32 +191,31 @@ void init_tasks() {
     // Check if we're being called from test_scheduler()
     void* caller_address;
     __asm__ volatile("mov %0, x30" : "=r"(caller_address));
-    
-    char buf[64];
-    snprintf(buf, sizeof(buf), "Called from: 0x%lx\n", (uint64_t)caller_address);
-    debug_print(buf);
+    pr_debug("[TASK] init_tasks called from 0x%lx", (uint64_t)caller_address);
     
     // Create the scheduler test tasks
-    *uart = 'C';  // Creating tasks
-    *uart = 'T';
-    *uart = 'A';
     create_task(task_a_test);
-    *uart = 'B';
     create_task(task_b_test);
-    *uart = 'C';
     create_task(task_c_test);
-    *uart = 'D';
     create_task(task_d_test);
     
+    // Background drain for klog() records; only runs when the CPU would
+    // otherwise be idle (or when it has been passed over for too long)
+    int klog_id = task_count;
+    create_task(klog_task);
+    if (task_count > klog_id) sched_set_prio(task_list[klog_id], SCHED_PRIO_LOW);
+    
+    // Worker thread(s) for queue_work()
+    workqueue_init();
+    
+    // Serial commands for perf/trace/profile dumps
+    create_task(perf_shell_task);
+    
     // Set current task
-    *uart = 'S';  // Setting current task
     current_task = task_list[0];
     current_task->state = TASK_RUNNING;
-    
-    // Print out confirmation that tasks are set up
-    snprintf(buf, sizeof(buf), "Task A PC: 0x%lx, Entry: 0x%lx\n", 
+    pr_debug("[TASK] Task A PC: 0x%lx, Entry: 0x%lx",
              current_task->pc, (uint64_t)current_task->entry_point);
-    debug_print(buf);
     
     uart_puts("[TASK] Tasks initialized, ready to run\n");
     
@@ -303,83 +223,34 @@ void init_tasks() {
 }
 
 void create_task(void (*entry_point)()) {
-    // Print direct UART debug for task creation
-    volatile uint32_t *uart_raw = (volatile uint32_t *)0x09000000;
-    *uart_raw = 'T'; // T for Task create
-    *uart_raw = 'C';
-    *uart_raw = ':';
-    
-    // Emergency pointer check - print without using snprintf
     if (entry_point == NULL) {
-        *uart_raw = '0';  // Null pointer!
-        *uart_raw = '!';
+        // Never start a task at address 0
         debug_print("FATAL: entry_point is NULL in create_task!\n");
-        
-        // Don't proceed with null function pointer
         for (;;) {
-            *uart_raw = 'n';  // Null function pointer loop
+            __asm__ volatile("wfe");
         }
     }
     
-    // Directly print the address bytes for critical debugging
-    *uart_raw = '@';  // Marker for raw address bytes
-    
-    // Print entry point address as bytes
-    uint8_t* ep_bytes = (uint8_t*)&entry_point;
-    for (int i = 7; i >= 0; i--) {
-        uint8_t byte = ep_bytes[i];
-        uint8_t high = (byte >> 4) & 0xF;
-        uint8_t low = byte & 0xF;
-        
-        *uart_raw = high < 10 ? '0' + high : 'A' + (high - 10);
-        *uart_raw = low < 10 ? '0' + low : 'A' + (low - 10);
-    }
-    
-    // Add newline after raw bytes
-    *uart_raw = '\r';
-    *uart_raw = '\n';
-    
-    // Print detailed entry point address for debugging
-    char buf[32];
-    snprintf(buf, sizeof(buf), "EP: 0x%lx\n", (uint64_t)entry_point);
-    debug_print(buf);
-    
-    // Print address of task_a for comparison (to ensure it's imported correctly)
-    snprintf(buf, sizeof(buf), "task_a addr: 0x%lx\n", (uint64_t)task_a);
-    debug_print(buf);
-    
-    // Print address of our test pattern
-    snprintf(buf, sizeof(buf), "test pattern addr: 0x%lx\n", (uint64_t)eret_test_pattern);
-    debug_print(buf);
-    
-    // Print entry point address first 8 bits in hex to UART directly
-    uint64_t ep_high = ((uint64_t)entry_point >> 28) & 0xF;
-    if (ep_high < 10) {
-        *uart_raw = '0' + ep_high;
-    } else {
-        *uart_raw = 'A' + (ep_high - 10);
-    }
+    pr_debug("[TASK] create_task: entry 0x%lx (task_a 0x%lx, test pattern 0x%lx)",
+             (uint64_t)entry_point, (uint64_t)task_a, (uint64_t)eret_test_pattern);
     
     // Check if we've reached maximum number of tasks
     if (task_count >= MAX_TASKS) {
-        *uart_raw = 'M'; // M for Max reached
+        pr_err("[TASK] create_task: MAX_TASKS reached");
         return;  // Cannot create more tasks
     }
     
     // Allocate memory for task stack (one page = 4KB)
     void* stack = alloc_page();
     if (!stack) {
-        *uart_raw = 'S'; // S for Stack alloc failed
+        pr_err("[TASK] create_task: stack allocation failed");
         return;  // Failed to allocate memory
     }
     
-    // Show stack base address (first character)
-    *uart_raw = '0' + ((uint64_t)stack >> 24 & 0xF);
-    
     // Initialize the task structure
     task_t* new_task = (task_t*)alloc_page();
     if (!new_task) {
-        *uart_raw = 'T'; // T for Task struct alloc failed
+        pr_err("[TASK] create_task: task_t allocation failed");
         free_page(stack);
         return;  // Failed to allocate memory
     }
@@ -387,119 +258,29 @@ void create_task(void (*entry_point)()) {
     // Clear the task structure completely
     memset(new_task, 0, sizeof(task_t));
     
-    // Verify entry_point is valid
-    if (entry_point == 0) {
-        *uart_raw = 'E'; // E for Entry point invalid
-        free_page(stack);
-        free_page(new_task);
-        return;
-    }
-    
-    // Show entry point address (first character)
-    *uart_raw = '0' + ((uint64_t)entry_point >> 24 & 0xF);
-    
     // Set up the stack pointer (points to the top of the stack)
     // Stack grows downward on ARM64, so point to the end of the allocated page
-    uint64_t* stack_top = (uint64_t*)((uint64_t)stack + PAGE_SIZE);
-    
     // Ensure 16-byte alignment as required by ARM64 ABI
-    stack_top = (uint64_t*)((uint64_t)stack_top & ~0xFUL);
-    
-    // First, keep the original stack top for reference
-    uint64_t* orig_stack_top = stack_top;
-    
-    // Print raw address of stack memory and top
-    char stk_buf[64];
-    snprintf(stk_buf, sizeof(stk_buf), "Stack mem: 0x%lx Stack top: 0x%lx\n", 
-            (uint64_t)stack, (uint64_t)stack_top);
-    debug_print(stk_buf);
-    
-    // Add logging to confirm stack allocation and alignment
-    uart_puts("[DEBUG] task stack VA: ");
-    uart_puthex((uint64_t)stack);
-    uart_puts("\n");
-    
-    // Verify stack alignment
-    if (((uint64_t)stack_top & 0xF) != 0) {
-        debug_print("ERROR: Stack pointer is not 16-byte aligned!\n");
-        uart_puts("[ERROR] Task stack not 16-byte aligned!\n");
-        *uart_raw = 'A'; // Alignment error
-        *uart_raw = '!';
-        free_page(stack);
-        free_page(new_task);
-        return;
-    }
-    
-    // Reserve stack space for register saves (x19-x30, +fp)
-    // ARM64 requires 16-byte alignment for the stack
-    stack_top -= 16;  // Reserve 128 bytes (16 words) for safe measure
-    
-    // Re-verify alignment after adjustment
-    if (((uint64_t)stack_top & 0xF) != 0) {
-        debug_print("ERROR: Adjusted stack pointer is not 16-byte aligned!\n");
-        *uart_raw = 'A'; // Alignment error
-        *uart_raw = '2';
-        free_page(stack);
-        free_page(new_task);
-        return;
-    }
-    
-    // Print raw address of stack base
-    snprintf(stk_buf, sizeof(stk_buf), "Final stack ptr: 0x%lx (aligned: %s)\n", 
-            (uint64_t)stack_top, ((uint64_t)stack_top & 0xF) == 0 ? "YES" : "NO");
-    debug_print(stk_buf);
-    
-    // Write a test value to the stack to ensure it's writable
-    *stack_top = 0xDEADBEEF;
-    
-    // Try to read it back to verify memory is accessible
-    uint64_t test_value = *stack_top;
-    snprintf(stk_buf, sizeof(stk_buf), "Stack test: wrote 0xDEADBEEF, read back 0x%lx\n", test_value);
-    debug_print(stk_buf);
+    uint64_t* stack_top = (uint64_t*)(((uint64_t)stack + PAGE_SIZE) & ~0xFUL);
     
-    // Write test pattern to top 64 bytes of stack
-    for (int i = 0; i < 64; i++) {
-        ((volatile char*)stack)[i] = 0xAA;
-    }
-    uart_puts("[DEBUG] Wrote 0xAA pattern to top 64 bytes of stack\n");
-    
-    // Add a specific pattern to help debug stack corruption
-    uint64_t* stack_pattern = (uint64_t*)stack;
-    for (int i = 0; i < 8; i++) {
-        stack_pattern[i] = 0xDEADBEEF00000000ULL | i;
-    }
-    uart_puts("[DEBUG] Added 0xDEADBEEF pattern to stack\n");
-    
-    // Verify memory is mapped and accessible
-    if (test_value != 0xDEADBEEF) {
-        debug_print("ERROR: Stack memory read verification failed!\n");
-        *uart_raw = 'M'; // Memory error
-        *uart_raw = '!';
-        free_page(stack);
-        free_page(new_task);
-        return;
-    }
+    pr_debug("[TASK] stack 0x%lx top 0x%lx", (uint64_t)stack, (uint64_t)stack_top);
     
-    // CRITICAL: Ensure memory is cleared to avoid stack corruption
-    memset(stack_top, 0, 128);  // Clear register save area
+    // Clear the 128 bytes below the top (register save area)
+    memset(stack_top - 16, 0, 128);
     
-    // Now set the stack pointer in the task structure
-    new_task->stack_ptr = (uint64_t*)((uint64_t)stack + PAGE_SIZE);  // stack grows downward
-    new_task->stack_ptr = (uint64_t*)((uint64_t)new_task->stack_ptr & ~0xF);  // ensure 16-byte alignment
-    
-    // Double check the stack pointer was set correctly
-    if (new_task->stack_ptr != stack_top) {
-        debug_print("ERROR: Stack pointer not correctly assigned to task!\n");
-        *uart_raw = 'P'; // Pointer error
-        *uart_raw = '!';
-        free_page(stack);
-        free_page(new_task);
-        return;
+    if (KLOG_ENABLED(KLOG_DEBUG)) {
+        // Recognisable patterns at the stack limit make overflows and
+        // corruption obvious in a memory dump
+        for (int i = 0; i < 64; i++) {
+            ((volatile char*)stack)[i] = 0xAA;
+        }
+        uint64_t* stack_pattern = (uint64_t*)stack;
+        for (int i = 0; i < 8; i++) {
+            stack_pattern[i] = 0xDEADBEEF00000000ULL | i;
+        }
     }
     
-    // Print confirmation that stack pointer is set
-    snprintf(stk_buf, sizeof(stk_buf), "Task stack_ptr set to: 0x%lx\n", (uint64_t)new_task->stack_ptr);
-    debug_print(stk_buf);
+    new_task->stack_ptr = stack_top;
     
     // Initialize bottom 16 registers with known pattern
     for (int i = 0; i < 16; i++) {
@@ -512,125 +293,45 @@ void create_task(void (*entry_point)()) {
         new_task->regs[i] = 0xBB00000000000000UL | i;
     }
     
-    // Set up the initial CPU state
-    // For first task debugging
-    if (task_count == 0) {  // For the first task only
-        debug_print("Using provided entry point function\n");
-        
-        // Immediately verify that the address is non-zero
-        if (entry_point == 0 || entry_point == NULL) {
-            debug_print("ERROR: entry_point symbol address resolves to NULL!\n");
-            *uart_raw = '!';
-            *uart_raw = '!';
-            *uart_raw = '!';
-            // Don't continue with a null function pointer
-            while (1) {
-                *uart_raw = 'N';  // Signal that address is NULL
-            }
-        }
-        
-        // CRITICAL: Advanced diagnostics for the entry point
-        volatile uint32_t *debug_uart = (volatile uint32_t *)0x09000000;
-        debug_uart[0] = 'D';
-        debug_uart[0] = 'I';
-        debug_uart[0] = 'A';
-        debug_uart[0] = 'G';
-        debug_uart[0] = ':';
-        debug_uart[0] = ' ';
-        
-        // Attempt to read the first instruction at the entry point to verify accessibility
-        // This will confirm MMU mappings and permissions are correct
-        uint32_t *instr_ptr = (uint32_t*)entry_point;
-        uint32_t first_instr = 0;
-        
-        // Read using a volatile pointer to ensure the load is actually performed
-        // This is a critical test of memory access before jumping!
-        first_instr = *((volatile uint32_t*)entry_point);
-        
-        // Output first bytes of entry_point
-        debug_uart[0] = 'I';
-        debug_uart[0] = '=';
-        
-        // Display the instruction in hex, byte by byte
-        for (int i = 0; i < 4; i++) {
-            uint8_t byte = (first_instr >> (i * 8)) & 0xFF;
-            uint8_t high = (byte >> 4) & 0xF;
-            uint8_t low = byte & 0xF;
-            
-            debug_uart[0] = high < 10 ? '0' + high : 'A' + (high - 10);
-            debug_uart[0] = low < 10 ? '0' + low : 'A' + (low - 10);
-        }
-        
-        debug_uart[0] = '\r';
-        debug_uart[0] = '\n';
+    if (KLOG_ENABLED(KLOG_DEBUG) && task_count == 0) {
+        // Reading the first instruction proves the entry point is mapped
+        // and readable before anything jumps to it
+        pr_debug("[TASK] first task entry instruction 0x%x",
+                 *((volatile uint32_t*)entry_point));
     }
     
-    // Compare entry_point with all available test functions
-    char cmp_buf[80];
-    snprintf(cmp_buf, sizeof(cmp_buf), "task_a=0x%lx test_pattern=0x%lx known=0x%lx\n", 
-             (uint64_t)task_a, (uint64_t)eret_test_pattern, (uint64_t)known_alive_function);
-    debug_print(cmp_buf);
-    
     // For testing purposes, always use the function provided by the caller
     void *actual_entry_point = entry_point;
     
     // Force task_a for the very first task to ensure it's loaded correctly
     if (task_count == 0) {
         externally_visible_function_pointer = task_a;
-        debug_print_raw("FORCING TASK_A ENTRY POINT AT: 0x%x\n", (uint32_t)((uint64_t)task_a));
+        pr_debug("[TASK] forcing task_a entry point 0x%lx", (uint64_t)task_a);
         actual_entry_point = task_a;
     }
     
     // Set PC explicitly to the entry point with proper casting
     new_task->pc = (uint64_t)((uintptr_t)entry_point);
-    new_task->spsr = 0x3C5;  // EL1h mode, interrupts off (safe default)
-    
-    // Add debugging output for task PC
-    uart_puts("[DEBUG] Task PC: ");
-    uart_puthex((uint64_t)new_task->pc);
-    uart_puts("\n");
     
     // Store the entry point in the task structure
     new_task->entry_point = actual_entry_point;
     
-    // Print the exact address we're jumping to
-    char buf2[64];
-    snprintf(buf2, sizeof(buf2), "PC: 0x%lx [%s valid range]\n", 
-             (uint64_t)new_task->pc,
-             (new_task->pc >= 0 && new_task->pc < 0x200000) ? "INSIDE" : "OUTSIDE");
-    debug_print(buf2);
-    
-    // Print the address as raw bytes for comparison
-    snprintf(buf2, sizeof(buf2), "PC bytes: %02x %02x %02x %02x\n", 
-             (uint8_t)(new_task->pc >> 24),
-             (uint8_t)(new_task->pc >> 16),
-             (uint8_t)(new_task->pc >> 8),
-             (uint8_t)(new_task->pc));
-    debug_print(buf2);
-    
-    // Verify PC value is valid
-    if (new_task->pc == 0 || (new_task->pc & 0x3UL) != 0) {
-        *uart_raw = 'P'; // P for PC error
-        // PC must be valid and aligned
-        *uart_raw = '!';
-        // This is a fatal error
-        while(1) {
-            *uart_raw = 'e'; // Fatal loop
+    // Kernel context used by cpu_switch_to() on the first switch-in
+    task_init_context(new_task, entry_point, new_task->stack_ptr);
+    
+    // PC must be valid and aligned
+    if ((new_task->pc & 0x3UL) != 0) {
+        debug_print("FATAL: misaligned task PC in create_task!\n");
+        for (;;) {
+            __asm__ volatile("wfe");
         }
     }
     
-    // Verify PC is within executable range
-    if (new_task->pc < 0 || new_task->pc >= 0x200000) {
-        *uart_raw = 'R'; // R for Range error
-        debug_print("ERROR: PC outside executable range [0x0, 0x200000)\n");
+    if (new_task->pc >= 0x200000) {
         // We'll continue anyway but log it
+        pr_warn("[TASK] PC 0x%lx outside executable range [0x0, 0x200000)", new_task->pc);
     }
     
-    // Print PC value high bits for debugging
-    uint8_t pc_high = ((uint64_t)new_task->pc >> 24) & 0xFF;
-    *uart_raw = '0' + ((pc_high >> 4) & 0xF); // High nibble
-    *uart_raw = '0' + (pc_high & 0xF);        // Low nibble
-    
     // For task state, EL1h mode with interrupts masked for safety
     // 0x3C5 = 0b0000_0000_0000_0000_0000_0000_0000_0000_0000_0000_0000_0011_1100_0101
     // - M[3:0] = 0x5 = 0b0101 = EL1h mode (uses SP_EL1)
@@ -639,38 +340,21 @@ void create_task(void (*entry_point)()) {
     // This ensures we return to EL1 using SP_EL1 with interrupts disabled initially
     new_task->spsr = 0x3C5;
     
-    // Debug output for SPSR value
-    uart_puts("[DEBUG] SPSR = ");
-    uart_puthex(new_task->spsr);
-    uart_puts("\n");
-    
-    // Double check SPSR is properly set to avoid corruption
-    if (new_task->spsr != 0x3C5) {
-        debug_print("ERROR: SPSR corruption detected!\n");
-        new_task->spsr = 0x3C5;  // Force it again
-    }
-    
-    // Debug - show stack offset from top
-    *uart_raw = '0' + (uint64_t)(orig_stack_top - stack_top);
-    
     // Initialize other task fields
     new_task->id = task_count;
     new_task->state = TASK_STATE_READY;  // Start as READY, not RUNNING
     
-    // Link tasks for round-robin scheduling (create circular list)
-    if (task_count > 0) {
-        task_list[task_count - 1]->next = new_task;
-    }
-    new_task->next = task_list[0]; // Circular list for round-robin
+    // Make it runnable (round-robin run queue)
+    unsigned long flags = local_irq_save();
+    enqueue_task(new_task);
+    local_irq_restore(flags);
     
     // Add to the global task list
     task_list[task_count] = new_task;
     task_count++;
     
-    // Task created successfully
-    *uart_raw = 'K';  // K for OK
-    *uart_raw = '\r';
-    *uart_raw = '\n';
+    pr_debug("[TASK] created task %d pc 0x%lx sp 0x%lx", new_task->id,
+             new_task->pc, (uint64_t)new_task->stack_ptr);
     
     // Set current_task if this is the first task (bootstrap scheduler)
     if (task_count == 1) {
@@ -680,74 +364,41 @@ void create_task(void (*entry_point)()) {
 
 // Function to create a task that runs in EL0
 void create_el0_task(void (*entry_point)()) {
-    // Print direct UART debug for EL0 task creation
-    volatile uint32_t *uart_raw = (volatile uint32_t *)0x09000000;
-    uart_puts("[TASK] Creating EL0 task with entry point: 0x");
-    uart_hex64((uint64_t)entry_point);
-    uart_puts("\n");
-    
     // Check if we've reached maximum number of tasks
     if (task_count >= MAX_TASKS) {
-        uart_puts("[TASK] ERROR: Maximum task count reached\n");
-        return;
-    }
-    
-    // Allocate memory for task stack (one page = 4KB)
-    void* stack = alloc_page();
-    if (!stack) {
-        uart_puts("[TASK] ERROR: Failed to allocate stack for EL0 task\n");
+        pr_err("[TASK] ERROR: Maximum task count reached");
         return;
     }
     
-    // Initialize the task structure
+    // Kernel stack (exceptions from EL0 land here) and EL0 stack
+    void* kstack = alloc_page();
+    void* ustack = alloc_page();
     task_t* new_task = (task_t*)alloc_page();
-    if (!new_task) {
-        uart_puts("[TASK] ERROR: Failed to allocate task structure\n");
-        free_page(stack);
+    if (!kstack || !ustack || !new_task) {
+        pr_err("[TASK] ERROR: Failed to allocate EL0 task");
+        free_page(kstack);
+        free_page(ustack);
+        free_page(new_task);
         return;
     }
     
     // Clear the task structure
     memset(new_task, 0, sizeof(task_t));
     
-    // Set up the stack pointer (points to the top of the stack)
-    // Stack grows downward on ARM64, so point to the end of the allocated page
-    uint64_t* stack_top = (uint64_t*)((uint64_t)stack + PAGE_SIZE);
-    
-    // Ensure 16-byte alignment as required by ARM64 ABI
-    stack_top = (uint64_t*)((uint64_t)stack_top & ~0xFUL);
-    
-    // Reserve stack space for register saves
-    stack_top -= 16;  // Reserve 128 bytes (16 words) for safe measure
-    
-    // Initialize bottom 16 registers with known pattern
-    for (int i = 0; i < 16; i++) {
-        new_task->regs[i] = 0xEE00000000000000UL | i;
-    }
-    
-    // Initialize remaining registers (x16-x30) with different pattern
-    for (int i = 16; i < 31; i++) {
-        new_task->regs[i] = 0xFF00000000000000UL | i;
-    }
-    
-    // Set the stack pointer in the task structure
-    new_task->stack_ptr = stack_top;
-    
-    // Set PC to the entry point
-    new_task->pc = (uint64_t)entry_point;
-    
-    // Set SPSR for EL0t mode with interrupts masked
-    // 0x3C0 = 0b0000_0000_0000_0000_0000_0000_0000_0000_0000_0000_0000_0011_1100_0000
-    // - M[3:0] = 0x0 = 0b0000 = EL0t mode
-    // - DAIF[9:6] = 0xC = 0b1100 = Mask IRQ (I=1) and FIQ (F=1)
-    new_task->spsr = (1 << 6);  // EL0t mode with IRQ and FIQ masked
-    
-    // Debug output
-    uart_puts("[TASK] Created EL0 task with PC: 0x");
-    uart_hex64(new_task->pc);
-    uart_puts(", SPSR: 0x");
-    uart_hex64(new_task->spsr);
-    uart_puts("\n");
+    // Exception frame at the top of the kernel stack describing the EL0
+    // entry state: EL0t, interrupts unmasked, zeroed registers
+    struct pt_regs* regs = (struct pt_regs*)((uint64_t)kstack + PAGE_SIZE) - 1;
+    memset(regs, 0, sizeof(*regs));
+    regs->sp = ((uint64_t)ustack + PAGE_SIZE) & ~0xFUL;
+    regs->pc = (uint64_t)entry_point;
+    regs->pstate = 0;
+    
+    // First switch-in: cpu_task_entry -> schedule_tail() -> ret_to_user,
+    // which pops the frame and erets to entry_point
+    task_init_context(new_task, ret_to_user, (uint64_t*)regs);
+    new_task->stack_ptr = (uint64_t*)regs->sp;
+    new_task->pc = regs->pc;
+    new_task->spsr = regs->pstate;
     
     // Initialize other task fields
     new_task->id = task_count;
@@ -755,11 +406,10 @@ void create_el0_task(void (*entry_point)()) {
     snprintf(new_task->name, sizeof(new_task->name), "el0_task_%d", new_task->id);
     new_task->entry_point = entry_point;
     
-    // Link tasks for round-robin scheduling
-    if (task_count > 0) {
-        task_list[task_count - 1]->next = new_task;
-    }
-    new_task->next = task_list[0];  // Circular list
+    // Make it runnable (round-robin run queue)
+    unsigned long flags = local_irq_save();
+    enqueue_task(new_task);
+    local_irq_restore(flags);
     
     // Add to the global task list
     task_list[task_count] = new_task;
@@ -770,9 +420,8 @@ void create_el0_task(void (*entry_point)()) {
         current_task = new_task;
     }
     
-    uart_puts("[TASK] Created EL0 task at 0x");
-    uart_hex64((uint64_t)entry_point);
-    uart_puts("\n");
+    pr_debug("[TASK] Created EL0 task %d with PC 0x%lx, SPSR 0x%lx",
+             new_task->id, new_task->pc, new_task->spsr);
 }
 
 // Function to directly start a user task in EL0 mode
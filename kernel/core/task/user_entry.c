@@ -4,10 +4,19 @@
 void user_task_entry(void) {
     uart_puts(">>> EL0 USER TASK STARTED <<<\n");
     
-    asm volatile("mov x0, #0\n svc #0");         // sys_hello
-    asm volatile("mov x0, #0x1234\n svc #1");    // sys_write
-    asm volatile("svc #3");                      // sys_yield
-    asm volatile("mov x0, #42\n svc #2");        // sys_exit
+    // Number in x8, argument in x0
+    asm volatile("mov x8, #0\n svc #0" ::: "x0", "x8", "memory");                  // sys_hello
+    
+    // sys_write(1, msg, len): the buffer lives on the EL0 stack so it
+    // passes the kernel's copy_from_user() check
+    char msg[] = "EL0 sys_write\n";
+    register uint64_t fd __asm__("x0") = 1;
+    register const char* buf __asm__("x1") = msg;
+    register uint64_t len __asm__("x2") = sizeof(msg) - 1;
+    asm volatile("mov x8, #1\n svc #0" : "+r"(fd) : "r"(buf), "r"(len) : "x8", "memory");
+    
+    asm volatile("mov x8, #3\n svc #0" ::: "x0", "x8", "memory");                  // sys_yield
+    asm volatile("mov x0, #42\n mov x8, #2\n svc #0" ::: "x0", "x8", "memory");    // sys_exit
     
     while (1); // fallback loop
 } 
\ No newline at end of file
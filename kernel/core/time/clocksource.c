@@ -0,0 +1,34 @@
+/*
+ * clocksource.c - CNTVCT_EL0 clocksource and nanosecond time base
+ *
+ * CNTFRQ_EL0 is read once and turned into 32.32 fixed-point factors, so a
+ * timestamp is one counter read, one 64x64->128 multiply and a shift. The
+ * 128-bit product means the conversion cannot overflow for any uptime.
+ */
+
+#include "../../../include/clocksource.h"
+
+struct clocksource arch_clocksource;
+
+void clocksource_init(void) {
+    uint64_t freq;
+
+    if (arch_clocksource.mult) return;
+
+    __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    if (!freq) freq = 62500000;    // QEMU virt default if firmware left it unset
+
+    arch_clocksource.freq = freq;
+    arch_clocksource.shift = CLOCKSOURCE_SHIFT;
+    // freq < 2^32 on every real implementation, so these fit in 64 bits
+    arch_clocksource.mult = ((NSEC_PER_SEC << CLOCKSOURCE_SHIFT) + freq / 2) / freq;
+    arch_clocksource.ns_mult = ((freq << CLOCKSOURCE_SHIFT) + NSEC_PER_SEC - 1) / NSEC_PER_SEC;
+}
+
+uint64_t ktime_get_ns(void) {
+    return clocksource_cyc2ns(clocksource_read());
+}
+
+uint64_t sched_clock(void) {
+    return ktime_get_ns();
+}
@@ -0,0 +1,325 @@
+/*
+ * timer_wheel.c - Hierarchical hashed timer wheel
+ *
+ * Pending timers hash into one of LVL_DEPTH levels of LVL_SIZE buckets.
+ * Level n buckets are 8^n wheel units wide, so a timer lands on the level
+ * whose range covers its distance from the wheel clock and is never moved
+ * again (no cascading). Insert and cancel are O(1) list operations plus a
+ * bit in the per-level pending bitmap; finding the next expiry is one
+ * rotate+ctz per level. Expiry is rounded up to the bucket width, so a
+ * timer fires at most ~12% late and never early.
+ *
+ * The wheel only asks the one-shot clockevent for an interrupt at the
+ * earliest pending bucket, so the slice tick path never touches it,
+ * however many timers are pending. When that deadline passes,
+ * timer_interrupt() raises TIMER_SOFTIRQ and the wheel runs from the
+ * softirq after EOI. Callbacks are called with the caller's IRQ state;
+ * the wheel itself is only touched with IRQs masked.
+ */
+
+#include "../../../include/timer.h"
+#include "../../../include/interrupts.h"
+#include "../../../include/types.h"
+
+// One wheel unit is 2^TW_BASE_SHIFT counter ticks (~1us at 62.5MHz)
+#define TW_BASE_SHIFT       6
+
+// Each level has 64 buckets and is 8 times coarser than the previous one
+#define LVL_CLK_SHIFT       3
+#define LVL_CLK_DIV         (1UL << LVL_CLK_SHIFT)
+#define LVL_CLK_MASK        (LVL_CLK_DIV - 1)
+#define LVL_BITS            6
+#define LVL_SIZE            (1UL << LVL_BITS)
+#define LVL_MASK            (LVL_SIZE - 1)
+#define LVL_DEPTH           9
+#define WHEEL_SIZE          (LVL_SIZE * LVL_DEPTH)
+
+#define LVL_SHIFT(n)        ((n) * LVL_CLK_SHIFT)
+#define LVL_OFFS(n)         ((n) * LVL_SIZE)
+#define LVL_START(n)        ((LVL_SIZE - 1) << (((n) - 1) * LVL_CLK_SHIFT))
+
+// Timers further out are parked in the last level and re-queued on expiry
+#define WHEEL_TIMEOUT_CUTOFF    LVL_START(LVL_DEPTH)
+#define WHEEL_TIMEOUT_MAX       (WHEEL_TIMEOUT_CUTOFF - (1UL << LVL_SHIFT(LVL_DEPTH - 1)))
+#define NEXT_TIMER_MAX_DELTA    (1UL << 62)
+
+// ktimer_t.flags
+#define TIMER_IDX_MASK      0xFFFFU     // Bucket index while pending
+#define TIMER_POOLED        (1U << 31)  // Owned by timer_pool
+
+static ktimer_t* wheel[WHEEL_SIZE];
+static uint64_t pending_map[LVL_DEPTH];  // Bit per non-empty bucket
+static uint64_t wheel_clk;               // Units up to which buckets are processed
+static uint64_t next_expiry = NEXT_TIMER_MAX_DELTA;
+static uint32_t wheel_count;             // Pending timers
+static int next_expiry_recalc;           // A cancel emptied a bucket
+
+static ktimer_t timer_pool[TIMER_POOL_SIZE];
+static ktimer_t* pool_free;
+static int pool_initialized;
+
+static inline uint64_t ticks_to_units(uint64_t ticks) {
+    return ticks >> TW_BASE_SHIFT;
+}
+
+static inline uint64_t units_to_ticks(uint64_t units) {
+    return units << TW_BASE_SHIFT;
+}
+
+// Bucket for `expires` on level lvl, rounded up to the next bucket boundary
+static unsigned int calc_index(uint64_t expires, unsigned int lvl, uint64_t* bucket_expiry) {
+    expires = (expires >> LVL_SHIFT(lvl)) + 1;
+    *bucket_expiry = expires << LVL_SHIFT(lvl);
+    return LVL_OFFS(lvl) + (expires & LVL_MASK);
+}
+
+static unsigned int calc_wheel_index(uint64_t expires, uint64_t clk, uint64_t* bucket_expiry) {
+    uint64_t delta = expires - clk;
+
+    // Already expired: run on the next processed bucket
+    if ((int64_t)delta < 0) {
+        *bucket_expiry = clk;
+        return clk & LVL_MASK;
+    }
+
+    for (unsigned int lvl = 0; lvl < LVL_DEPTH - 1; lvl++) {
+        if (delta < LVL_START(lvl + 1)) {
+            return calc_index(expires, lvl, bucket_expiry);
+        }
+    }
+
+    if (delta >= WHEEL_TIMEOUT_CUTOFF) {
+        expires = clk + WHEEL_TIMEOUT_MAX;
+    }
+    return calc_index(expires, LVL_DEPTH - 1, bucket_expiry);
+}
+
+// Distance from bucket `clk` to the next pending bucket of a level, or -1
+static int next_pending_bucket(unsigned int lvl, unsigned int clk) {
+    uint64_t map = pending_map[lvl];
+    if (!map) return -1;
+
+    // Rotate so bit 0 is the current bucket; wrapped buckets follow
+    if (clk) map = (map >> clk) | (map << (LVL_SIZE - clk));
+    return __builtin_ctzll(map);
+}
+
+// Earliest pending bucket expiry in wheel units
+static uint64_t next_timer_interrupt(void) {
+    uint64_t clk = wheel_clk;
+    uint64_t next = wheel_clk + NEXT_TIMER_MAX_DELTA;
+
+    for (unsigned int lvl = 0; lvl < LVL_DEPTH; lvl++) {
+        int pos = next_pending_bucket(lvl, clk & LVL_MASK);
+        uint64_t lvl_clk = clk & LVL_CLK_MASK;
+
+        if (pos >= 0) {
+            uint64_t tmp = (clk + (uint64_t)pos) << LVL_SHIFT(lvl);
+            if (tmp < next) next = tmp;
+        }
+
+        // Bucket boundaries of the next level are reached one unit later
+        // unless this level's clock is already aligned
+        clk >>= LVL_CLK_SHIFT;
+        clk += lvl_clk ? 1 : 0;
+    }
+
+    return next;
+}
+
+static void enqueue_timer(ktimer_t* timer) {
+    uint64_t bucket_expiry;
+    uint64_t expires = ticks_to_units(timer->expires);
+
+    // A cancelled bucket may have left next_expiry in the past, which
+    // would hold wheel_clk back and file this timer in too coarse a level
+    if (next_expiry_recalc) {
+        next_expiry_recalc = 0;
+        next_expiry = next_timer_interrupt();
+    }
+
+    // An empty or idle wheel may lag far behind the counter; advance it
+    // to now, but never past a pending bucket
+    uint64_t now = ticks_to_units(timer_read_counter());
+    if (now > wheel_clk) {
+        wheel_clk = now < next_expiry ? now : next_expiry;
+    }
+
+    unsigned int idx = calc_wheel_index(expires, wheel_clk, &bucket_expiry);
+
+    timer->next = wheel[idx];
+    if (timer->next) timer->next->pprev = &timer->next;
+    wheel[idx] = timer;
+    timer->pprev = &wheel[idx];
+    timer->flags = (timer->flags & ~TIMER_IDX_MASK) | idx;
+    pending_map[idx / LVL_SIZE] |= 1UL << (idx % LVL_SIZE);
+    wheel_count++;
+
+    if (bucket_expiry < next_expiry) {
+        next_expiry = bucket_expiry;
+        timer_request_wakeup(units_to_ticks(bucket_expiry));
+    }
+}
+
+static void detach_timer(ktimer_t* timer) {
+    unsigned int idx = timer->flags & TIMER_IDX_MASK;
+
+    *timer->pprev = timer->next;
+    if (timer->next) timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+    wheel_count--;
+
+    if (!wheel[idx]) {
+        pending_map[idx / LVL_SIZE] &= ~(1UL << (idx % LVL_SIZE));
+        next_expiry_recalc = 1;
+    }
+    if (!wheel_count) {
+        next_expiry = NEXT_TIMER_MAX_DELTA;
+        next_expiry_recalc = 0;
+    }
+}
+
+static void pool_put(ktimer_t* timer) {
+    timer->next = pool_free;
+    pool_free = timer;
+}
+
+static ktimer_t* pool_get(void) {
+    if (!pool_initialized) {
+        for (int i = TIMER_POOL_SIZE - 1; i >= 0; i--) {
+            timer_pool[i].flags = TIMER_POOLED;
+            pool_put(&timer_pool[i]);
+        }
+        pool_initialized = 1;
+    }
+
+    ktimer_t* timer = pool_free;
+    if (timer) pool_free = timer->next;
+    return timer;
+}
+
+void timer_start(ktimer_t* timer, uint64_t deadline, timer_fn_t fn, void* arg) {
+    unsigned long flags = local_irq_save();
+
+    if (timer->pprev) detach_timer(timer);
+    timer->expires = deadline;
+    timer->fn = fn;
+    timer->arg = arg;
+    timer->flags &= TIMER_POOLED;
+    enqueue_timer(timer);
+
+    local_irq_restore(flags);
+}
+
+ktimer_t* timer_add(uint64_t deadline, timer_fn_t fn, void* arg) {
+    unsigned long flags = local_irq_save();
+
+    ktimer_t* timer = pool_get();
+    if (timer) {
+        timer->pprev = NULL;
+        timer_start(timer, deadline, fn, arg);
+    }
+
+    local_irq_restore(flags);
+    return timer;
+}
+
+int timer_cancel(ktimer_t* timer) {
+    int was_pending = 0;
+    unsigned long flags = local_irq_save();
+
+    if (timer->pprev) {
+        detach_timer(timer);
+        if (timer->flags & TIMER_POOLED) pool_put(timer);
+        was_pending = 1;
+    }
+
+    // An interrupt already requested for the cancelled bucket still fires
+    // and finds nothing; next_expiry itself is recomputed before the next
+    // enqueue or wheel run
+    local_irq_restore(flags);
+    return was_pending;
+}
+
+// Move every due bucket at wheel_clk onto lists[]; returns how many
+static int collect_expired_timers(ktimer_t** lists) {
+    uint64_t clk = wheel_clk = next_expiry;
+    int levels = 0;
+
+    for (unsigned int lvl = 0; lvl < LVL_DEPTH; lvl++) {
+        unsigned int idx = LVL_OFFS(lvl) + (clk & LVL_MASK);
+        uint64_t bit = 1UL << (idx % LVL_SIZE);
+
+        if (pending_map[lvl] & bit) {
+            pending_map[lvl] &= ~bit;
+            lists[levels] = wheel[idx];
+            lists[levels]->pprev = &lists[levels];
+            wheel[idx] = NULL;
+            levels++;
+        }
+
+        // Higher levels only have a bucket boundary when this one wraps
+        if (clk & LVL_CLK_MASK) break;
+        clk >>= LVL_CLK_SHIFT;
+    }
+
+    return levels;
+}
+
+static void expire_timers(ktimer_t** list, uint64_t now, unsigned long flags) {
+    while (*list) {
+        ktimer_t* timer = *list;
+
+        *list = timer->next;
+        if (timer->next) timer->next->pprev = list;
+        timer->next = NULL;
+        timer->pprev = NULL;
+        wheel_count--;
+
+        // Clamped beyond the wheel range: park it again
+        if (timer->expires > now) {
+            enqueue_timer(timer);
+            continue;
+        }
+
+        timer_fn_t fn = timer->fn;
+        void* arg = timer->arg;
+        if (timer->flags & TIMER_POOLED) pool_put(timer);
+
+        // The entry is off every list; a nested interrupt may now add or
+        // cancel timers (including ones still on *list, via pprev)
+        local_irq_restore(flags);
+        fn(arg);
+        local_irq_save();
+    }
+}
+
+// Called from the timer softirq once the requested wheel deadline has
+// passed
+void timer_wheel_run(uint64_t now) {
+    ktimer_t* lists[LVL_DEPTH];
+    uint64_t now_units = ticks_to_units(now);
+    unsigned long flags = local_irq_save();
+
+    while (wheel_count && now_units >= next_expiry) {
+        int levels = collect_expired_timers(lists);
+
+        wheel_clk++;
+        next_expiry = next_timer_interrupt();
+
+        while (levels--) {
+            expire_timers(&lists[levels], now, flags);
+        }
+    }
+
+    next_expiry_recalc = 0;
+    if (!wheel_count) {
+        next_expiry = NEXT_TIMER_MAX_DELTA;
+    } else {
+        next_expiry = next_timer_interrupt();
+        timer_request_wakeup(units_to_ticks(next_expiry));
+    }
+
+    local_irq_restore(flags);
+}
@@ -0,0 +1,32 @@
+/*
+ * vdso.c - Clock parameters shared read-only with EL0
+ *
+ * One page holds struct vdso_data and is mapped at VDSO_USER_VA with
+ * EL0 read-only permissions. Together with EL0 access to CNTVCT_EL0 this
+ * lets user code turn the counter into nanoseconds without trapping into
+ * the kernel (see vdso.h for the formula and the seq protocol).
+ */
+
+#include "../../../include/vdso.h"
+#include "../../../include/clocksource.h"
+#include "../../../include/memory_config.h"
+#include "../../../include/pmm.h"
+#include "../../../include/string.h"
+
+static struct vdso_data* vdso_data;
+
+void vdso_init(void) {
+    if (vdso_data) return;
+
+    struct vdso_data* vd = (struct vdso_data*)alloc_page();
+    if (!vd) return;
+    memset(vd, 0, 4096);
+
+    vd->version = VDSO_DATA_VERSION;
+    vd->freq = arch_clocksource.freq;
+    vd->mult = arch_clocksource.mult;
+    vd->shift = arch_clocksource.shift;
+    vdso_data = vd;
+
+    map_kernel_page(VDSO_USER_VA, (uint64_t)vd, PTE_USER_RODATA);
+}
@@ -0,0 +1,131 @@
+/*
+ * trace.c - Static tracepoint buffers and site patching
+ *
+ * Each trace_*() site is a NOP plus a struct trace_site entry in the
+ * __trace_sites section (see trace.h). Enabling an event rewrites its
+ * NOPs into branches to the recording path; disabling writes the NOPs
+ * back. Recording is a handful of stores into this CPU's ring with IRQs
+ * masked, so sites in IRQ handlers and in schedule() need no extra care.
+ */
+
+#include "../../../include/trace.h"
+#include "../../../include/patch.h"
+#include "../../../include/interrupts.h"
+#include "../../../include/percpu.h"
+#include "../../../include/clocksource.h"
+#include "../../../include/task.h"
+#include "../../../include/uart.h"
+#include "../../../include/printf.h"
+
+struct trace_buffer {
+    uint64_t head;             // Records ever written; index = head % size
+    struct trace_record records[TRACE_BUF_ENTRIES];
+};
+
+static struct trace_buffer trace_buffers[NR_CPUS];
+static uint32_t trace_mask;
+
+struct trace_key trace_keys[TRACE_NR_EVENTS];
+
+// Provided by the linker script
+extern const struct trace_site __trace_sites_start[];
+extern const struct trace_site __trace_sites_end[];
+
+static const char* const trace_event_names[TRACE_NR_EVENTS] = {
+    [TRACE_SCHED_SWITCH] = "sched_switch",
+    [TRACE_IRQ_ENTRY]    = "irq_entry",
+    [TRACE_IRQ_EXIT]     = "irq_exit",
+    [TRACE_SYSCALL]      = "syscall",
+    [TRACE_PMM_ALLOC]    = "pmm_alloc",
+};
+
+void __trace_record(uint16_t event, uint32_t arg0, uint64_t arg1, uint64_t arg2) {
+    unsigned int cpu = smp_processor_id();
+    struct trace_buffer* buf = &trace_buffers[cpu];
+    unsigned long flags = local_irq_save();
+
+    struct trace_record* rec = &buf->records[buf->head & (TRACE_BUF_ENTRIES - 1)];
+    rec->ts = clocksource_read();
+    rec->event = event;
+    rec->cpu = (uint16_t)cpu;
+    rec->arg0 = arg0;
+    rec->arg1 = arg1;
+    rec->arg2 = arg2;
+    buf->head++;
+
+    local_irq_restore(flags);
+}
+
+void trace_enable(uint32_t mask) {
+    mask &= TRACE_ALL;
+
+    for (int ev = 0; ev < TRACE_NR_EVENTS; ev++) {
+        trace_keys[ev].enabled = (mask >> ev) & 1;
+    }
+
+    for (const struct trace_site* site = __trace_sites_start; site < __trace_sites_end; site++) {
+        uint32_t* code = (uint32_t*)site->code;
+        int ev = (int)(site->key - trace_keys);
+        uint32_t insn = AARCH64_INSN_NOP;
+
+        if (ev >= 0 && ev < TRACE_NR_EVENTS && trace_keys[ev].enabled) {
+            insn = aarch64_insn_gen_branch(site->code, site->target);
+        }
+        if (*code != insn) {
+            aarch64_insn_patch_text(code, insn);
+        }
+    }
+
+    trace_mask = mask;
+}
+
+uint64_t trace_buffered(void) {
+    uint64_t total = 0;
+
+    for (unsigned int cpu = 0; cpu < NR_CPUS; cpu++) {
+        uint64_t head = trace_buffers[cpu].head;
+        total += head < TRACE_BUF_ENTRIES ? head : TRACE_BUF_ENTRIES;
+    }
+    return total;
+}
+
+void trace_dump(void) {
+    uint32_t mask = trace_mask;
+    char line[96];
+
+    trace_enable(0);
+
+    snprintf(line, sizeof(line), "TRACE-BEGIN v1 freq=%llu cpus=%d\n",
+             arch_clocksource.freq, NR_CPUS);
+    uart_puts(line);
+
+    for (int ev = 0; ev < TRACE_NR_EVENTS; ev++) {
+        snprintf(line, sizeof(line), "TE %d %s\n", ev, trace_event_names[ev]);
+        uart_puts(line);
+    }
+    for (int i = 0; i < task_count; i++) {
+        if (task_list[i]) {
+            snprintf(line, sizeof(line), "TN %d %s\n", task_list[i]->id, task_list[i]->name);
+            uart_puts(line);
+        }
+    }
+
+    // One record per line as its four little-endian 64-bit words
+    for (unsigned int cpu = 0; cpu < NR_CPUS; cpu++) {
+        struct trace_buffer* buf = &trace_buffers[cpu];
+        uint64_t n = buf->head < TRACE_BUF_ENTRIES ? buf->head : TRACE_BUF_ENTRIES;
+
+        for (uint64_t i = buf->head - n; i < buf->head; i++) {
+            const struct trace_record* rec = &buf->records[i & (TRACE_BUF_ENTRIES - 1)];
+            uint64_t w1 = rec->event | ((uint64_t)rec->cpu << 16) | ((uint64_t)rec->arg0 << 32);
+
+            snprintf(line, sizeof(line), "TR %016llx %016llx %016llx %016llx\n",
+                     rec->ts, w1, rec->arg1, rec->arg2);
+            uart_puts(line);
+        }
+        buf->head = 0;
+    }
+
+    uart_puts("TRACE-END\n");
+    trace_enable(mask);
+}
@@ -0,0 +1,52 @@
+/*
+ * gic.c - GIC version selection
+ *
+ * gic_probe() runs from start.S while the DTB at the start of RAM is still
+ * intact and records which controller QEMU was started with
+ * (-M virt,gic-version=2|3) together with its MMIO bases. Everything else
+ * reaches the controller through the selected struct gic_chip.
+ */
+
+#include "../../../include/gic.h"
+#include "../../../include/fdt.h"
+
+#define GICD_PIDR2          0xFFE8
+#define GICD_PIDR2_ARCHREV(v)   (((v) >> 4) & 0xF)
+
+const struct gic_chip* gic = &gic_v2_chip;
+
+struct gic_config gic_config = {
+    .dist_base = GIC_DIST_BASE_DEFAULT,
+    .cpu_base = GIC_CPU_BASE_DEFAULT,
+    .redist_base = GIC_REDIST_BASE_DEFAULT,
+};
+
+static int gic_initialized;
+
+void gic_probe(void) {
+    uint64_t reg[4];
+
+    if (fdt_find_compatible(FDT_DEFAULT_ADDR, "arm,gic-v3", reg, 2) >= 2) {
+        gic_config.dist_base = reg[0];
+        gic_config.redist_base = reg[2];
+        gic = &gic_v3_chip;
+        return;
+    }
+
+    if (fdt_find_compatible(FDT_DEFAULT_ADDR, "arm,cortex-a15-gic", reg, 2) >= 2) {
+        gic_config.dist_base = reg[0];
+        gic_config.cpu_base = reg[2];
+        gic = &gic_v2_chip;
+        return;
+    }
+
+    // No usable DTB: ask the distributor which architecture it implements
+    uint32_t pidr2 = *((volatile uint32_t*)(gic_config.dist_base + GICD_PIDR2));
+    gic = GICD_PIDR2_ARCHREV(pidr2) >= 3 ? &gic_v3_chip : &gic_v2_chip;
+}
+
+void gic_init(void) {
+    if (gic_initialized) return;
+    gic->init();
+    gic_initialized = 1;
+}
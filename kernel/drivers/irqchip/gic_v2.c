@@ -0,0 +1,105 @@
+/*
+ * gic_v2.c - GICv2 distributor and memory-mapped CPU interface
+ */
+
+#include "../../../include/gic.h"
+#include "../../../include/irq.h"
+
+// Distributor registers (offsets from gic_config.dist_base)
+#define GICD_CTLR           0x000
+#define GICD_TYPER          0x004
+#define GICD_ISENABLER(n)   (0x100 + 4 * ((n) / 32))
+#define GICD_ICENABLER(n)   (0x180 + 4 * ((n) / 32))
+#define GICD_ISPENDR(n)     (0x200 + 4 * ((n) / 32))
+#define GICD_ICPENDR(n)     (0x280 + 4 * ((n) / 32))
+#define GICD_IPRIORITYR(n)  (0x400 + (n))           // byte access
+#define GICD_ITARGETSR(n)   (0x800 + (n))           // byte access
+#define GICD_SGIR           0xF00
+
+// CPU interface registers (offsets from gic_config.cpu_base)
+#define GICC_CTLR           0x000
+#define GICC_PMR            0x004
+#define GICC_BPR            0x008
+#define GICC_IAR            0x00C
+#define GICC_EOIR           0x010
+#define GICC_RPR            0x014
+
+#define GICC_IAR_ID_MASK    0x3FF   // Bits 12:10 carry the SGI source CPU
+
+static inline volatile uint32_t* gicd32(uint32_t off) {
+    return (volatile uint32_t*)(gic_config.dist_base + off);
+}
+
+static inline volatile uint8_t* gicd8(uint32_t off) {
+    return (volatile uint8_t*)(gic_config.dist_base + off);
+}
+
+static inline volatile uint32_t* gicc32(uint32_t off) {
+    return (volatile uint32_t*)(gic_config.cpu_base + off);
+}
+
+static void gic_v2_init(void) {
+    *gicd32(GICD_CTLR) = 1;
+
+    *gicc32(GICC_PMR) = GIC_PRIO_IDLE;
+    // Group 0 binary point n splits priority at bit n+1
+    *gicc32(GICC_BPR) = 7 - GIC_PREEMPT_BITS;
+    *gicc32(GICC_CTLR) = 1;
+}
+
+static uint32_t gic_v2_ack(uint32_t* iar) {
+    *iar = *gicc32(GICC_IAR);
+    return *iar & GICC_IAR_ID_MASK;
+}
+
+static void gic_v2_eoi(uint32_t iar) {
+    *gicc32(GICC_EOIR) = iar;
+}
+
+static void gic_v2_enable(uint32_t irq) {
+    if (irq >= IRQ_SPI_BASE) {
+        *gicd8(GICD_ITARGETSR(irq)) = 0x01;   // Route SPIs to CPU0
+    }
+    *gicd32(GICD_ISENABLER(irq)) = 1U << (irq % 32);
+}
+
+static void gic_v2_disable(uint32_t irq) {
+    *gicd32(GICD_ICENABLER(irq)) = 1U << (irq % 32);
+}
+
+static void gic_v2_set_priority(uint32_t irq, uint8_t priority) {
+    *gicd8(GICD_IPRIORITYR(irq)) = priority;
+}
+
+static void gic_v2_set_pending(uint32_t irq) {
+    *gicd32(GICD_ISPENDR(irq)) = 1U << (irq % 32);
+}
+
+static void gic_v2_clear_pending(uint32_t irq) {
+    *gicd32(GICD_ICPENDR(irq)) = 1U << (irq % 32);
+}
+
+static void gic_v2_send_sgi(uint32_t sgi, uint8_t target_mask) {
+    *gicd32(GICD_SGIR) = ((uint32_t)target_mask << 16) | sgi;
+}
+
+static uint32_t gic_v2_running_priority(void) {
+    return *gicc32(GICC_RPR);
+}
+
+const struct gic_chip gic_v2_chip = {
+    .name = "GICv2",
+    .version = 2,
+    .eoi_split = 0,
+    .init = gic_v2_init,
+    .ack = gic_v2_ack,
+    .eoi = gic_v2_eoi,
+    .deactivate = gic_v2_eoi,
+    .enable = gic_v2_enable,
+    .disable = gic_v2_disable,
+    .set_priority = gic_v2_set_priority,
+    .set_pending = gic_v2_set_pending,
+    .clear_pending = gic_v2_clear_pending,
+    .send_sgi = gic_v2_send_sgi,
+    .running_priority = gic_v2_running_priority,
+};
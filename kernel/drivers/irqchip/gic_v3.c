@@ -0,0 +1,285 @@
+/*
+ * gic_v3.c - GICv3 distributor, redistributor and ICC_* system registers
+ *
+ * Acknowledge and completion use the system register CPU interface, which
+ * avoids an MMIO round trip per interrupt. ICC_CTLR_EL1.EOImode is set, so
+ * ICC_EOIR1_EL1 only drops the running priority and ICC_DIR_EL1
+ * deactivates. handle_irq() drops priority once the handler returns, which
+ * opens the CPU to every other interrupt, and irq_exit() deactivates only
+ * after the bottom halves have run, so the same INTID cannot fire again
+ * while its deferred work is still pending.
+ */
+
+#include "../../../include/gic.h"
+#include "../../../include/irq.h"
+
+// Distributor registers (offsets from gic_config.dist_base)
+#define GICD_CTLR               0x0000
+#define GICD_TYPER              0x0004
+#define GICD_IGROUPR(n)         (0x0080 + 4 * ((n) / 32))
+#define GICD_ISENABLER(n)       (0x0100 + 4 * ((n) / 32))
+#define GICD_ICENABLER(n)       (0x0180 + 4 * ((n) / 32))
+#define GICD_ISPENDR(n)         (0x0200 + 4 * ((n) / 32))
+#define GICD_ICPENDR(n)         (0x0280 + 4 * ((n) / 32))
+#define GICD_IPRIORITYR(n)      (0x0400 + (n))      // byte access
+#define GICD_IROUTER(n)         (0x6000 + 8 * (n))
+
+#define GICD_CTLR_RWP           (1U << 31)
+#define GICD_CTLR_ARE_NS        (1U << 4)
+#define GICD_CTLR_ENABLE_G1A    (1U << 1)
+#define GICD_CTLR_ENABLE_G1     (1U << 0)
+
+// Redistributor: RD_base frame, then SGI_base frame 64KB above it
+#define GICR_STRIDE             0x20000
+#define GICR_SGI_OFFSET         0x10000
+#define GICR_CTLR               0x0000
+#define GICR_TYPER              0x0008
+#define GICR_WAKER              0x0014
+#define GICR_IGROUPR0           0x0080
+#define GICR_ISENABLER0         0x0100
+#define GICR_ICENABLER0         0x0180
+#define GICR_ISPENDR0           0x0200
+#define GICR_ICPENDR0           0x0280
+#define GICR_IPRIORITYR(n)      (0x0400 + (n))
+
+#define GICR_CTLR_RWP           (1U << 3)
+#define GICR_TYPER_LAST         (1ULL << 4)
+#define GICR_WAKER_PROC_SLEEP   (1U << 1)
+#define GICR_WAKER_CHILD_ASLEEP (1U << 2)
+#define GICR_MAX_FRAMES         8
+
+// ICC_* registers by encoding so older assemblers accept them
+#define ICC_PMR_EL1             "S3_0_C4_C6_0"
+#define ICC_IAR1_EL1            "S3_0_C12_C12_0"
+#define ICC_EOIR1_EL1           "S3_0_C12_C12_1"
+#define ICC_BPR1_EL1            "S3_0_C12_C12_3"
+#define ICC_CTLR_EL1            "S3_0_C12_C12_4"
+#define ICC_SRE_EL1             "S3_0_C12_C12_5"
+#define ICC_IGRPEN1_EL1         "S3_0_C12_C12_7"
+#define ICC_DIR_EL1             "S3_0_C12_C11_1"
+#define ICC_RPR_EL1             "S3_0_C12_C11_3"
+#define ICC_SGI1R_EL1           "S3_0_C12_C11_5"
+
+#define ICC_SRE_SRE             (1UL << 0)
+#define ICC_CTLR_EOIMODE        (1UL << 1)
+
+#define GICV3_INTID_MASK        0xFFFFFF
+
+#define read_icc(reg, val)      __asm__ volatile("mrs %0, " reg : "=r"(val))
+#define write_icc(reg, val)     __asm__ volatile("msr " reg ", %0" :: "r"((uint64_t)(val)) : "memory")
+
+// Boot CPU redistributor, found by gic_v3_init()
+static uint64_t gicr_base;
+
+static inline volatile uint32_t* gicd32(uint32_t off) {
+    return (volatile uint32_t*)(gic_config.dist_base + off);
+}
+
+static inline volatile uint8_t* gicd8(uint32_t off) {
+    return (volatile uint8_t*)(gic_config.dist_base + off);
+}
+
+static inline volatile uint32_t* gicr32(uint32_t off) {
+    return (volatile uint32_t*)(gicr_base + off);
+}
+
+static inline volatile uint8_t* gicr_sgi8(uint32_t off) {
+    return (volatile uint8_t*)(gicr_base + GICR_SGI_OFFSET + off);
+}
+
+static inline volatile uint32_t* gicr_sgi32(uint32_t off) {
+    return (volatile uint32_t*)(gicr_base + GICR_SGI_OFFSET + off);
+}
+
+// MPIDR affinity in GICD_IROUTER / GICR_TYPER layout (Aff3 at 39:32)
+static uint64_t cpu_affinity(void) {
+    uint64_t mpidr;
+    __asm__ volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+    return mpidr & 0xFF00FFFFFFULL;
+}
+
+static void gic_v3_dist_wait_rwp(void) {
+    while (*gicd32(GICD_CTLR) & GICD_CTLR_RWP);
+}
+
+static void gic_v3_redist_wait_rwp(void) {
+    while (*gicr32(GICR_CTLR) & GICR_CTLR_RWP);
+}
+
+static void gic_v3_dist_init(void) {
+    uint32_t lines = ((*gicd32(GICD_TYPER) & 0x1F) + 1) * 32;
+    if (lines > NR_IRQS) lines = NR_IRQS;
+
+    *gicd32(GICD_CTLR) = 0;
+    gic_v3_dist_wait_rwp();
+
+    // All SPIs: Non-secure Group 1, disabled, default priority, to us
+    uint64_t aff = cpu_affinity();
+    for (uint32_t i = IRQ_SPI_BASE; i < lines; i += 32) {
+        *gicd32(GICD_IGROUPR(i)) = ~0U;
+        *gicd32(GICD_ICENABLER(i)) = ~0U;
+        *gicd32(GICD_ICPENDR(i)) = ~0U;
+    }
+    for (uint32_t i = IRQ_SPI_BASE; i < lines; i++) {
+        *gicd8(GICD_IPRIORITYR(i)) = IRQ_DEFAULT_PRIORITY;
+        *(volatile uint64_t*)(gic_config.dist_base + GICD_IROUTER(i)) = aff;
+    }
+    gic_v3_dist_wait_rwp();
+
+    *gicd32(GICD_CTLR) = GICD_CTLR_ARE_NS | GICD_CTLR_ENABLE_G1A | GICD_CTLR_ENABLE_G1;
+    gic_v3_dist_wait_rwp();
+}
+
+static int gic_v3_redist_init(void) {
+    uint64_t aff = cpu_affinity();
+    uint64_t want = ((aff >> 32) << 24) | (aff & 0xFFFFFF);   // Aff3.Aff2.Aff1.Aff0
+    uint64_t base = gic_config.redist_base;
+
+    gicr_base = 0;
+    for (int i = 0; i < GICR_MAX_FRAMES; i++, base += GICR_STRIDE) {
+        uint64_t typer = *(volatile uint64_t*)(base + GICR_TYPER);
+        if ((typer >> 32) == want) {
+            gicr_base = base;
+            break;
+        }
+        if (typer & GICR_TYPER_LAST) break;
+    }
+    if (!gicr_base) return -1;
+
+    // Wake the redistributor
+    *gicr32(GICR_WAKER) &= ~GICR_WAKER_PROC_SLEEP;
+    while (*gicr32(GICR_WAKER) & GICR_WAKER_CHILD_ASLEEP);
+
+    // SGIs enabled, PPIs disabled until requested, all Group 1
+    *gicr_sgi32(GICR_IGROUPR0) = ~0U;
+    *gicr_sgi32(GICR_ICENABLER0) = 0xFFFF0000U;
+    *gicr_sgi32(GICR_ISENABLER0) = 0x0000FFFFU;
+    for (uint32_t i = 0; i < IRQ_SPI_BASE; i++) {
+        *gicr_sgi8(GICR_IPRIORITYR(i)) = IRQ_DEFAULT_PRIORITY;
+    }
+    gic_v3_redist_wait_rwp();
+    return 0;
+}
+
+static void gic_v3_cpu_init(void) {
+    uint64_t val;
+
+    read_icc(ICC_SRE_EL1, val);
+    write_icc(ICC_SRE_EL1, val | ICC_SRE_SRE);
+    __asm__ volatile("isb");
+
+    write_icc(ICC_PMR_EL1, GIC_PRIO_IDLE);
+    // Group 1 binary point n splits priority at bit n
+    write_icc(ICC_BPR1_EL1, 8 - GIC_PREEMPT_BITS);
+
+    read_icc(ICC_CTLR_EL1, val);
+    write_icc(ICC_CTLR_EL1, val | ICC_CTLR_EOIMODE);
+
+    write_icc(ICC_IGRPEN1_EL1, 1);
+    __asm__ volatile("isb");
+}
+
+static void gic_v3_init(void) {
+    gic_v3_dist_init();
+    if (gic_v3_redist_init() != 0) return;
+    gic_v3_cpu_init();
+}
+
+static uint32_t gic_v3_ack(uint32_t* iar) {
+    uint64_t val;
+    read_icc(ICC_IAR1_EL1, val);
+    *iar = (uint32_t)val;
+    return *iar & GICV3_INTID_MASK;
+}
+
+// EOImode=1: priority drop only
+static void gic_v3_eoi(uint32_t iar) {
+    write_icc(ICC_EOIR1_EL1, iar);
+    __asm__ volatile("isb");
+}
+
+static void gic_v3_deactivate(uint32_t iar) {
+    write_icc(ICC_DIR_EL1, iar);
+    __asm__ volatile("isb");
+}
+
+static void gic_v3_enable(uint32_t irq) {
+    if (irq < IRQ_SPI_BASE) {
+        *gicr_sgi32(GICR_ISENABLER0) = 1U << irq;
+        gic_v3_redist_wait_rwp();
+    } else {
+        *(volatile uint64_t*)(gic_config.dist_base + GICD_IROUTER(irq)) = cpu_affinity();
+        *gicd32(GICD_ISENABLER(irq)) = 1U << (irq % 32);
+    }
+}
+
+static void gic_v3_disable(uint32_t irq) {
+    if (irq < IRQ_SPI_BASE) {
+        *gicr_sgi32(GICR_ICENABLER0) = 1U << irq;
+        gic_v3_redist_wait_rwp();
+    } else {
+        *gicd32(GICD_ICENABLER(irq)) = 1U << (irq % 32);
+        gic_v3_dist_wait_rwp();
+    }
+}
+
+static void gic_v3_set_priority(uint32_t irq, uint8_t priority) {
+    if (irq < IRQ_SPI_BASE) {
+        *gicr_sgi8(GICR_IPRIORITYR(irq)) = priority;
+    } else {
+        *gicd8(GICD_IPRIORITYR(irq)) = priority;
+    }
+}
+
+static void gic_v3_set_pending(uint32_t irq) {
+    if (irq < IRQ_SPI_BASE) {
+        *gicr_sgi32(GICR_ISPENDR0) = 1U << irq;
+    } else {
+        *gicd32(GICD_ISPENDR(irq)) = 1U << (irq % 32);
+    }
+}
+
+static void gic_v3_clear_pending(uint32_t irq) {
+    if (irq < IRQ_SPI_BASE) {
+        *gicr_sgi32(GICR_ICPENDR0) = 1U << irq;
+    } else {
+        *gicd32(GICD_ICPENDR(irq)) = 1U << (irq % 32);
+    }
+}
+
+// Targets are Aff0 bits within the boot CPU's Aff3.Aff2.Aff1 cluster
+static void gic_v3_send_sgi(uint32_t sgi, uint8_t target_mask) {
+    uint64_t aff = cpu_affinity();
+    uint64_t val = ((uint64_t)sgi << 24) | target_mask;
+
+    val |= ((aff >> 8) & 0xFF) << 16;           // Aff1
+    val |= ((aff >> 16) & 0xFF) << 32;          // Aff2
+    val |= ((aff >> 32) & 0xFF) << 48;          // Aff3
+
+    __asm__ volatile("dsb ishst" ::: "memory");
+    write_icc(ICC_SGI1R_EL1, val);
+    __asm__ volatile("isb");
+}
+
+static uint32_t gic_v3_running_priority(void) {
+    uint64_t val;
+    read_icc(ICC_RPR_EL1, val);
+    return (uint32_t)val;
+}
+
+const struct gic_chip gic_v3_chip = {
+    .name = "GICv3",
+    .version = 3,
+    .eoi_split = 1,
+    .init = gic_v3_init,
+    .ack = gic_v3_ack,
+    .eoi = gic_v3_eoi,
+    .deactivate = gic_v3_deactivate,
+    .enable = gic_v3_enable,
+    .disable = gic_v3_disable,
+    .set_priority = gic_v3_set_priority,
+    .set_pending = gic_v3_set_pending,
+    .clear_pending = gic_v3_clear_pending,
+    .send_sgi = gic_v3_send_sgi,
+    .running_priority = gic_v3_running_priority,
+};
@@ -0,0 +1,151 @@
+/*
+ * fdt.c - Minimal flattened device tree reader
+ *
+ * Just enough to look up a node by "compatible" and read its "reg"
+ * property. Runs before the MMU and PMM are up, so it uses no library
+ * helpers and never writes to memory.
+ */
+
+#include "../../../include/fdt.h"
+
+#define FDT_BEGIN_NODE  1
+#define FDT_END_NODE    2
+#define FDT_PROP        3
+#define FDT_NOP         4
+#define FDT_END         9
+
+struct fdt_header {
+    uint32_t magic;
+    uint32_t totalsize;
+    uint32_t off_dt_struct;
+    uint32_t off_dt_strings;
+    uint32_t off_mem_rsvmap;
+    uint32_t version;
+    uint32_t last_comp_version;
+    uint32_t boot_cpuid_phys;
+    uint32_t size_dt_strings;
+    uint32_t size_dt_struct;
+};
+
+// All FDT fields are big-endian
+static uint32_t fdt32(const void* p) {
+    const uint8_t* b = (const uint8_t*)p;
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+static uint32_t fdt_align(uint32_t len) {
+    return (len + 3) & ~3U;
+}
+
+static int fdt_streq(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static uint32_t fdt_strlen(const char* s) {
+    uint32_t n = 0;
+    while (s[n]) n++;
+    return n;
+}
+
+// "compatible" is a list of NUL-terminated strings
+static int fdt_stringlist_contains(const char* list, uint32_t len, const char* want) {
+    uint32_t pos = 0;
+    while (pos < len) {
+        if (fdt_streq(list + pos, want)) return 1;
+        pos += fdt_strlen(list + pos) + 1;
+    }
+    return 0;
+}
+
+static uint64_t fdt_read_cells(const uint8_t* p, uint32_t cells) {
+    uint64_t val = 0;
+    for (uint32_t i = 0; i < cells; i++) {
+        val = (val << 32) | fdt32(p + 4 * i);
+    }
+    return val;
+}
+
+int fdt_valid(uint64_t addr) {
+    const struct fdt_header* hdr = (const struct fdt_header*)addr;
+    return fdt32(&hdr->magic) == FDT_MAGIC && fdt32(&hdr->version) >= 16;
+}
+
+int fdt_find_compatible(uint64_t addr, const char* compat, uint64_t* reg, int max_regs) {
+    if (!fdt_valid(addr)) return -1;
+
+    const struct fdt_header* hdr = (const struct fdt_header*)addr;
+    const uint8_t* p = (const uint8_t*)addr + fdt32(&hdr->off_dt_struct);
+    const uint8_t* end = p + fdt32(&hdr->size_dt_struct);
+    const char* strings = (const char*)addr + fdt32(&hdr->off_dt_strings);
+
+    // Cell sizes come from the root node; matches QEMU virt where the
+    // devices we look up are its direct children
+    uint32_t addr_cells = 2, size_cells = 1;
+    int depth = 0;
+
+    while (p < end) {
+        uint32_t token = fdt32(p);
+        p += 4;
+
+        switch (token) {
+        case FDT_BEGIN_NODE: {
+            p += fdt_align(fdt_strlen((const char*)p) + 1);
+            depth++;
+
+            // Properties precede subnodes, so the whole set is here
+            const uint8_t* reg_data = NULL;
+            uint32_t reg_len = 0;
+            int match = 0;
+
+            while (p < end && (fdt32(p) == FDT_PROP || fdt32(p) == FDT_NOP)) {
+                if (fdt32(p) == FDT_NOP) {
+                    p += 4;
+                    continue;
+                }
+
+                uint32_t len = fdt32(p + 4);
+                const char* name = strings + fdt32(p + 8);
+                const uint8_t* data = p + 12;
+
+                if (depth == 1 && fdt_streq(name, "#address-cells")) {
+                    addr_cells = fdt32(data);
+                } else if (depth == 1 && fdt_streq(name, "#size-cells")) {
+                    size_cells = fdt32(data);
+                } else if (fdt_streq(name, "compatible")) {
+                    match = fdt_stringlist_contains((const char*)data, len, compat);
+                } else if (fdt_streq(name, "reg")) {
+                    reg_data = data;
+                    reg_len = len;
+                }
+
+                p = data + fdt_align(len);
+            }
+
+            if (match) {
+                uint32_t entry = 4 * (addr_cells + size_cells);
+                int n = 0;
+                for (uint32_t off = 0; reg_data && off + entry <= reg_len && n < max_regs; off += entry, n++) {
+                    reg[2 * n] = fdt_read_cells(reg_data + off, addr_cells);
+                    reg[2 * n + 1] = fdt_read_cells(reg_data + off + 4 * addr_cells, size_cells);
+                }
+                return n;
+            }
+            break;
+        }
+        case FDT_END_NODE:
+            depth--;
+            break;
+        case FDT_NOP:
+            break;
+        case FDT_END:
+        default:
+            return -1;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,193 @@
+/*
+ * arm_pmu.c - ARMv8 PMUv3 counter driver
+ *
+ * Programs the cycle counter and four event counters once and leaves them
+ * running; nothing here takes interrupts, so overflow is handled by the
+ * readers (64-bit cycle counter, 32-bit deltas for the event counters).
+ * Under QEMU the PMU is emulated for -cpu cortex-a53/a57/max; which events
+ * actually count is reported through PMCEID0_EL0.
+ */
+
+#include "../../../include/pmu.h"
+#include "../../../include/klog.h"
+#include "../../../include/irq.h"
+
+// ID_AA64DFR0_EL1.PMUVer
+#define ID_AA64DFR0_PMUVER_SHIFT    8
+#define ID_AA64DFR0_PMUVER_MASK     0xF
+#define ID_AA64DFR0_PMUVER_IMPDEF   0xF
+
+// PMCR_EL0
+#define PMCR_E          (1UL << 0)      // Enable
+#define PMCR_P          (1UL << 1)      // Reset event counters
+#define PMCR_C          (1UL << 2)      // Reset cycle counter
+#define PMCR_LC         (1UL << 6)      // 64-bit cycle counter overflow
+#define PMCR_N_SHIFT    11
+#define PMCR_N_MASK     0x1F
+
+#define PMCNTEN_CYCLES  (1UL << 31)
+
+// Event counter behind pmu_overflow_start()
+#define PMU_SAMPLE_COUNTER  4
+
+// Common architectural event numbers
+#define ARMV8_PMUV3_L1D_CACHE_REFILL    0x03
+#define ARMV8_PMUV3_L1D_TLB_REFILL      0x05
+#define ARMV8_PMUV3_INST_RETIRED        0x08
+#define ARMV8_PMUV3_BR_MIS_PRED         0x10
+#define ARMV8_PMUV3_CPU_CYCLES          0x11
+
+bool pmu_active;
+bool pmu_events_active;
+
+static uint64_t pmu_ceid0;
+static uint32_t pmu_nr_event_counters;
+
+static pmu_overflow_fn_t pmu_overflow_fn;
+static uint32_t pmu_overflow_period;
+static bool pmu_irq_claimed;
+
+static const struct {
+    const char* name;
+    uint32_t event;
+} pmu_counters[PMU_NR_COUNTERS] = {
+    [PMU_CYCLES]       = { "cycles",       ARMV8_PMUV3_CPU_CYCLES },
+    [PMU_INSTRUCTIONS] = { "instructions", ARMV8_PMUV3_INST_RETIRED },
+    [PMU_L1D_REFILL]   = { "l1d_refill",   ARMV8_PMUV3_L1D_CACHE_REFILL },
+    [PMU_TLB_REFILL]   = { "tlb_refill",   ARMV8_PMUV3_L1D_TLB_REFILL },
+    [PMU_BR_MISPRED]   = { "br_mispred",   ARMV8_PMUV3_BR_MIS_PRED },
+};
+
+const char* pmu_counter_name(int counter) {
+    if (counter < 0 || counter >= PMU_NR_COUNTERS) return "?";
+    return pmu_counters[counter].name;
+}
+
+bool pmu_counter_supported(int counter) {
+    if (!pmu_active || counter < 0 || counter >= PMU_NR_COUNTERS) return false;
+    if (counter == PMU_CYCLES) return true;
+    return pmu_events_active && ((pmu_ceid0 >> pmu_counters[counter].event) & 1);
+}
+
+int pmu_init(void) {
+    uint64_t dfr0, pmcr;
+
+    if (pmu_active) return 0;
+
+    __asm__ volatile("mrs %0, id_aa64dfr0_el1" : "=r"(dfr0));
+    uint64_t ver = (dfr0 >> ID_AA64DFR0_PMUVER_SHIFT) & ID_AA64DFR0_PMUVER_MASK;
+    if (ver == 0 || ver == ID_AA64DFR0_PMUVER_IMPDEF) {
+        klog(KLOG_WARNING, "PMU: no PMUv3 (PMUVer %d)", (int)ver);
+        return -1;
+    }
+
+    __asm__ volatile("mrs %0, pmcr_el0" : "=r"(pmcr));
+    uint32_t nr_events = (pmcr >> PMCR_N_SHIFT) & PMCR_N_MASK;
+    pmu_nr_event_counters = nr_events;
+    __asm__ volatile("mrs %0, pmceid0_el0" : "=r"(pmu_ceid0));
+
+    // Stop everything while programming. Filters of 0 count EL0 and EL1.
+    __asm__ volatile("msr pmcr_el0, %0\n"
+                     "msr pmcntenclr_el0, %1\n"
+                     "msr pmintenclr_el1, %1\n"
+                     "msr pmovsclr_el0, %1\n"
+                     "msr pmccfiltr_el0, xzr\n"
+                     "isb"
+                     :: "r"(0UL), "r"(~0UL));
+
+    uint64_t enable = PMCNTEN_CYCLES;
+    if (nr_events >= PMU_NR_COUNTERS - 1) {
+        __asm__ volatile("msr pmevtyper0_el0, %0\n"
+                         "msr pmevtyper1_el0, %1\n"
+                         "msr pmevtyper2_el0, %2\n"
+                         "msr pmevtyper3_el0, %3"
+                         :: "r"((uint64_t)pmu_counters[PMU_INSTRUCTIONS].event),
+                            "r"((uint64_t)pmu_counters[PMU_L1D_REFILL].event),
+                            "r"((uint64_t)pmu_counters[PMU_TLB_REFILL].event),
+                            "r"((uint64_t)pmu_counters[PMU_BR_MISPRED].event));
+        enable |= (1UL << (PMU_NR_COUNTERS - 1)) - 1;
+        pmu_events_active = true;
+    }
+
+    __asm__ volatile("msr pmcntenset_el0, %0\n"
+                     "msr pmcr_el0, %1\n"
+                     "isb"
+                     :: "r"(enable), "r"(PMCR_E | PMCR_P | PMCR_C | PMCR_LC)
+                     : "memory");
+    pmu_active = true;
+
+    klog(KLOG_INFO, "PMU: PMUv3 ver %d, %d event counters, PMCEID0 0x%lx",
+         (int)ver, (int)nr_events, pmu_ceid0);
+    return 0;
+}
+
+// Counting up from -period overflows after period cycles
+static inline void pmu_sample_counter_reload(void) {
+    uint64_t start = (uint32_t)(0 - pmu_overflow_period);
+
+    __asm__ volatile("msr pmselr_el0, %0\n"
+                     "isb\n"
+                     "msr pmxevcntr_el0, %1"
+                     :: "r"((uint64_t)PMU_SAMPLE_COUNTER), "r"(start));
+}
+
+static void pmu_irq(uint32_t irq, void* data) {
+    uint64_t ovs;
+    (void)irq;
+    (void)data;
+
+    __asm__ volatile("mrs %0, pmovsclr_el0" : "=r"(ovs));
+    if (!(ovs & (1UL << PMU_SAMPLE_COUNTER))) {
+        return;
+    }
+
+    // Clear the level-triggered source before EOI, then restart the period
+    __asm__ volatile("msr pmovsclr_el0, %0\n"
+                     "isb"
+                     :: "r"(1UL << PMU_SAMPLE_COUNTER));
+    pmu_sample_counter_reload();
+
+    pmu_overflow_fn_t fn = pmu_overflow_fn;
+    if (fn) {
+        fn(get_irq_regs());
+    }
+}
+
+int pmu_overflow_start(uint32_t period, pmu_overflow_fn_t fn) {
+    if (!pmu_active || pmu_nr_event_counters <= PMU_SAMPLE_COUNTER || !period || !fn) {
+        return -1;
+    }
+    if (!pmu_irq_claimed) {
+        if (request_irq(PMU_IRQ, pmu_irq, NULL) != 0) {
+            return -1;
+        }
+        pmu_irq_claimed = true;
+    }
+
+    pmu_overflow_stop();
+    pmu_overflow_period = period;
+    pmu_overflow_fn = fn;
+
+    __asm__ volatile("msr pmselr_el0, %0\n"
+                     "isb\n"
+                     "msr pmxevtyper_el0, %1"
+                     :: "r"((uint64_t)PMU_SAMPLE_COUNTER),
+                        "r"((uint64_t)ARMV8_PMUV3_CPU_CYCLES));
+    pmu_sample_counter_reload();
+    __asm__ volatile("msr pmintenset_el1, %0\n"
+                     "msr pmcntenset_el0, %0\n"
+                     "isb"
+                     :: "r"(1UL << PMU_SAMPLE_COUNTER) : "memory");
+    return 0;
+}
+
+void pmu_overflow_stop(void) {
+    if (!pmu_active) return;
+
+    __asm__ volatile("msr pmcntenclr_el0, %0\n"
+                     "msr pmintenclr_el1, %0\n"
+                     "msr pmovsclr_el0, %0\n"
+                     "isb"
+                     :: "r"(1UL << PMU_SAMPLE_COUNTER) : "memory");
+    pmu_overflow_fn = NULL;
+}
@@ -1,6 +1,14 @@
 #include "../../../include/timer.h"
 #include "../../../include/types.h"
 #include "../../../include/uart.h"
+#include "../../../include/clocksource.h"
+#include "../../../include/scheduler.h"  // SCHED_SLICE_US default
+#include "../../../include/irq.h"
+#include "../../../include/gic.h"
+#include "../../../include/softirq.h"
+#include "../../../include/vdso.h"
+#include "../../../include/klog.h"
+#include "../../../include/profile.h"
 
 // Add include for debug_print
 extern void debug_print(const char* msg);
@@ -10,21 +18,11 @@ extern void debug_print(const char* msg);
 #define CNTV_CTL_EL0_IMASK   (1 << 1)    // Interrupt Mask
 #define CNTV_CTL_EL0_ISTATUS (1 << 2)    // Interrupt Status
 
-// GIC registers
-#define GICD_BASE           0x08000000
-#define GICC_BASE           0x08010000
-#define GICD_CTLR          (GICD_BASE + 0x000)  // Distributor Control Register
-#define GICD_ISENABLER1    (GICD_BASE + 0x104)  // Interrupt Set-Enable Register 1
-#define GICD_ICPENDR1      (GICD_BASE + 0x284)  // Interrupt Clear-Pending Register 1
-#define GICD_ISPENDR1      (GICD_BASE + 0x204)  // Interrupt Set-Pending Register 1
-#define GICD_IPRIORITYR7   (GICD_BASE + 0x41C)  // Interrupt Priority Register 7
-#define GICC_CTLR          (GICC_BASE + 0x000)  // CPU Interface Control Register
-#define GICC_PMR           (GICC_BASE + 0x004)  // Priority Mask Register
-
-// Timer interrupt ID
-#define TIMER_IRQ_ID       30      // Physical timer IRQ ID
-#define TIMER_IRQ_BIT      (1U << (TIMER_IRQ_ID % 32))  // Bit in GICD_ISENABLER1
-#define TIMER_INTERVAL     100000  // Timer interval (tuned for QEMU)
+// CNTKCTL_EL1 EL0 access controls
+#define CNTKCTL_EL0PCTEN    (1UL << 0)      // CNTPCT_EL0
+#define CNTKCTL_EL0VCTEN    (1UL << 1)      // CNTVCT_EL0
+#define CNTKCTL_EL0VTEN     (1UL << 8)      // CNTV_* timer registers
+#define CNTKCTL_EL0PTEN     (1UL << 9)      // CNTP_* timer registers
 
 // UART constants for debug output
 #define UART0_BASE     0x09000000
@@ -46,8 +44,19 @@ extern void debug_print(const char* msg);
 // External function for handling timer ticks
 extern void timer_handler(void);
 
+// Scheduler hook driven by the one-shot timer (scheduler.c)
+extern void set_need_resched(void);
+
+// One-shot clockevent state. The comparator is always programmed for the
+// earliest of these; with neither pending the timer is stopped.
+static uint64_t slice_ticks = 0;                         // Slice length, 0 = default
+static int timer_running = 0;                            // Set by timer_init()
+static uint64_t slice_deadline = TIMER_NO_DEADLINE;      // End of current slice
+static uint64_t wakeup_deadline = TIMER_NO_DEADLINE;     // Next timer wheel bucket
+
 // Static function declarations
 static void configure_gic(void);
+static void timer_softirq(void);
 static void raw_uart_putc(char c);
 static void raw_uart_puts(const char *s);
 
@@ -66,117 +75,182 @@ static void raw_uart_puts(const char *s) {
 
 // Initialize the timer and GIC
 void timer_init(void) {
-    debug_print("[TIMER] Initializing ARM Generic Timer...\n");
-    raw_uart_puts("[TIMER] Initializing timer and GIC\n");
+    klog(KLOG_INFO, "[TIMER] Initializing ARM Generic Timer and GIC");
     
     // Step 1: Configure GIC (Generic Interrupt Controller)
+    open_softirq(TIMER_SOFTIRQ, timer_softirq);
     configure_gic();
     
     // Step 2: Make sure we can access timer from EL1
     uint64_t cntkctl_el1;
     asm volatile("mrs %0, cntkctl_el1" : "=r"(cntkctl_el1));
-    debug_print("[TIMER] CNTKCTL_EL1 = ");
-    uart_print_hex(cntkctl_el1);
-    debug_print("\n");
+    klog(KLOG_DEBUG, "[TIMER] CNTKCTL_EL1 = 0x%lx", cntkctl_el1);
     
-    // Set bits to allow EL0 to access virtual timer (bits 1:0) and physical timer (bits 9:8)
-    // We're at EL1 but ensure access anyway
-    cntkctl_el1 |= (3 << 0) | (3 << 8);
-    asm volatile("msr cntkctl_el1, %0" :: "r"(cntkctl_el1));
+    // EL0 may read CNTVCT_EL0 (for the vDSO clock) and nothing else. The
+    // physical counter and both timers' registers stay EL1-only so user
+    // code cannot reprogram the scheduler tick.
+    cntkctl_el1 &= ~(CNTKCTL_EL0PCTEN | CNTKCTL_EL0VTEN | CNTKCTL_EL0PTEN);
+    cntkctl_el1 |= CNTKCTL_EL0VCTEN;
+    asm volatile("msr cntkctl_el1, %0\n"
+                 "isb" :: "r"(cntkctl_el1));
     
     // Verify settings took effect
     asm volatile("mrs %0, cntkctl_el1" : "=r"(cntkctl_el1));
-    debug_print("[TIMER] Updated CNTKCTL_EL1 = ");
-    uart_print_hex(cntkctl_el1);
-    debug_print("\n");
+    klog(KLOG_DEBUG, "[TIMER] Updated CNTKCTL_EL1 = 0x%lx", cntkctl_el1);
     
     // Step 3: Configure timer control register
     // Clear control register (disable timer)
-    asm volatile("msr cntp_ctl_el0, %0" :: "r"(0));
-    debug_print("[TIMER] Timer disabled for configuration\n");
-    
-    // Set timer interval (how long until next interrupt)
-    debug_print("[TIMER] Setting timer interval to: ");
-    uart_print_hex(TIMER_INTERVAL);
-    debug_print("\n");
-    asm volatile("msr cntp_tval_el0, %0" :: "r"(TIMER_INTERVAL));
-    
-    // Read back timer value to verify
-    uint64_t timer_value;
-    asm volatile("mrs %0, cntp_tval_el0" : "=r"(timer_value));
-    debug_print("[TIMER] Timer value set to: ");
-    uart_print_hex(timer_value);
-    debug_print("\n");
-    
-    // Enable timer and unmask interrupt
-    debug_print("[TIMER] Enabling timer...\n");
-    asm volatile("msr cntp_ctl_el0, %0" :: "r"(CNTV_CTL_EL0_ENABLE));
+    asm volatile("msr cntv_ctl_el0, %0" :: "r"(0));
+    klog(KLOG_DEBUG, "[TIMER] Timer disabled for configuration");
+    
+    vdso_init();
+    klog(KLOG_INFO, "[TIMER] Counter frequency: %d Hz", arch_clocksource.freq);
+    
+    // One-shot mode: the comparator is armed for the earliest deadline only.
+    // Arm a first slice so the scheduler gets an initial tick.
+    klog(KLOG_DEBUG, "[TIMER] Arming first one-shot deadline in %d ticks", timer_slice_ticks());
+    timer_running = 1;
+    timer_set_slice_deadline(timer_read_counter() + timer_slice_ticks());
     
     // Verify timer control setting
     uint64_t timer_control;
-    asm volatile("mrs %0, cntp_ctl_el0" : "=r"(timer_control));
-    debug_print("[TIMER] Timer control = ");
-    uart_print_hex(timer_control);
-    debug_print("\n");
+    asm volatile("mrs %0, cntv_ctl_el0" : "=r"(timer_control));
+    klog(KLOG_DEBUG, "[TIMER] Timer control = 0x%lx", timer_control);
+    klog(KLOG_INFO, "[TIMER] Initialization complete");
+}
+
+// The virtual timer compares against CNTVCT_EL0, the clocksource counter,
+// so deadlines and timestamps share one time base
+uint64_t timer_read_counter(void) {
+    return clocksource_read();
+}
+
+// Counter frequency in Hz (CNTFRQ_EL0 via the clocksource)
+uint64_t timer_get_frequency(void) {
+    return arch_clocksource.freq;
+}
+
+// Convert microseconds to counter ticks, rounding up so sleeps never end early
+uint64_t timer_us_to_ticks(uint64_t us) {
+    return clocksource_ns2cyc(us * NSEC_PER_USEC);
+}
+
+// Set the scheduler slice length in nanoseconds
+void timer_set_slice_interval(uint64_t ns) {
+    slice_ticks = clocksource_ns2cyc(ns);
+}
+
+// Scheduler slice length in counter ticks
+uint64_t timer_slice_ticks(void) {
+    if (!slice_ticks) {
+        timer_set_slice_interval(SCHED_SLICE_US * NSEC_PER_USEC);
+    }
+    return slice_ticks;
+}
+
+// Program the comparator for the earliest pending deadline, or stop the
+// timer entirely when nothing is pending (tickless idle)
+static void timer_reprogram(void) {
+    uint64_t deadline = slice_deadline < wakeup_deadline ? slice_deadline : wakeup_deadline;
+    
+    if (deadline == TIMER_NO_DEADLINE) {
+        asm volatile("msr cntv_ctl_el0, %0" :: "r"(0UL));
+        return;
+    }
     
-    debug_print("[TIMER] Timer initialized successfully\n");
-    raw_uart_puts("[TIMER] Initialization complete\n");
+    // Writing CVAL also clears a stale interrupt condition for future deadlines
+    asm volatile("msr cntv_cval_el0, %0" :: "r"(deadline));
+    asm volatile("msr cntv_ctl_el0, %0" :: "r"((uint64_t)CNTV_CTL_EL0_ENABLE));
+    asm volatile("isb");
+}
+
+// Set (or with TIMER_NO_DEADLINE, cancel) the end of the current time slice
+void timer_set_slice_deadline(uint64_t deadline) {
+    if (!timer_running) return;
+    
+    unsigned long flags = local_irq_save();
+    slice_deadline = deadline;
+    timer_reprogram();
+    local_irq_restore(flags);
+}
+
+// Ask for an interrupt no later than deadline (timer wheel, early sleeps)
+void timer_request_wakeup(uint64_t deadline) {
+    if (!timer_running) return;
+    
+    unsigned long flags = local_irq_save();
+    if (deadline < wakeup_deadline) {
+        wakeup_deadline = deadline;
+        timer_reprogram();
+    }
+    local_irq_restore(flags);
+}
+
+// Stop the scheduler tick; only sleeper wakeups stay armed
+void timer_stop_tick(void) {
+    timer_set_slice_deadline(TIMER_NO_DEADLINE);
+}
+
+// Timer interrupt top half, dispatched by handle_irq() before EOI.
+// Notes which deadlines have passed, re-arms the comparator and flags a
+// reschedule when a slice ended. Expiring the wheel is left to
+// TIMER_SOFTIRQ; its callbacks flag their own reschedule when they wake
+// a task.
+void timer_interrupt(void) {
+    uint64_t now = timer_read_counter();
+    
+    if (now >= wakeup_deadline) {
+        // timer_wheel_run() re-requests its next pending bucket
+        wakeup_deadline = TIMER_NO_DEADLINE;
+        raise_softirq(TIMER_SOFTIRQ);
+    }
+    
+    if (now >= slice_deadline) {
+        slice_deadline = TIMER_NO_DEADLINE;
+        set_need_resched();
+    }
+    
+    // After the wakeup check, which would drop its re-requested deadline
+    profile_timer_tick(now);
+    
+    timer_reprogram();
+}
+
+// Bottom half: run the timer wheel up to the current counter value
+static void timer_softirq(void) {
+    timer_wheel_run(timer_read_counter());
+}
+
+// request_irq() handler for the virtual timer PPI
+static void timer_irq(uint32_t irq, void* data) {
+    (void)irq;
+    (void)data;
+    timer_interrupt();
 }
 
 // Configure GIC for timer interrupts
 static void configure_gic(void) {
-    raw_uart_puts("[GIC] Configuring GIC...\n");
-    debug_print("[GIC] Configuring GIC (Generic Interrupt Controller)\n");
-    
-    // Step 1: Enable the GIC Distributor
-    *((volatile uint32_t*)GICD_CTLR) = 1;
-    debug_print("[GIC] GIC Distributor enabled\n");
-    
-    // Step A: Clear any pending timer interrupt
-    *((volatile uint32_t*)GICD_ICPENDR1) = TIMER_IRQ_BIT;
-    debug_print("[GIC] Cleared pending timer interrupt\n");
-    
-    // Step 2: Set timer interrupt priority (lower value = higher priority)
-    volatile uint32_t* priority_reg = (volatile uint32_t*)GICD_IPRIORITYR7;
-    uint32_t priority_val = *priority_reg;
-    debug_print("[GIC] Original priority register = ");
-    uart_print_hex(priority_val);
-    debug_print("\n");
-    
-    // Set bits 8-15 to 0xA0 (lower priority value = higher priority)
-    priority_val = (priority_val & ~(0xFF << 8)) | (0xA0 << 8);
-    *priority_reg = priority_val;
-    
-    // Verify priority setting
-    priority_val = *priority_reg;
-    debug_print("[GIC] Updated priority register = ");
-    uart_print_hex(priority_val);
-    debug_print("\n");
-    
-    // Step 3: Enable the timer interrupt (IRQ 30)
-    volatile uint32_t* enable_reg = (volatile uint32_t*)GICD_ISENABLER1;
-    uint32_t enable_val = *enable_reg;
-    debug_print("[GIC] Original enable register = ");
-    uart_print_hex(enable_val);
-    debug_print("\n");
-    
-    *enable_reg = TIMER_IRQ_BIT;  // Set only bit 30-32 = bit 62
-    
-    // Verify enable setting
-    enable_val = *enable_reg;
-    debug_print("[GIC] Updated enable register = ");
-    uart_print_hex(enable_val);
-    debug_print("\n");
-    
-    // Step 4: Enable the GIC CPU interface
-    *((volatile uint32_t*)GICC_CTLR) = 1;
-    debug_print("[GIC] GIC CPU interface enabled\n");
-    
-    // Step 5: Set the priority mask to allow all interrupts
-    *((volatile uint32_t*)GICC_PMR) = 0xFF;
-    debug_print("[GIC] Priority mask set to allow all priorities\n");
-    
-    raw_uart_puts("[GIC] Configuration complete\n");
+    // Step 1: Bring up the controller picked by gic_probe() at boot
+    gic_init();
+    klog(KLOG_INFO, "[GIC] Using %s", gic->name);
+    
+    // Step 2: Clear any pending timer interrupt
+    gic->clear_pending(TIMER_IRQ_ID);
+    
+    // Step 3: Install the timer handler and enable the PPI, above the
+    // default priority so the tick preempts device handlers
+    if (request_irq(TIMER_IRQ_ID, timer_irq, NULL) != 0) {
+        klog(KLOG_ERR, "[GIC] Timer IRQ already claimed");
+    } else {
+        irq_set_priority(TIMER_IRQ_ID, IRQ_TIMER_PRIORITY);
+        klog(KLOG_DEBUG, "[GIC] Timer IRQ %d registered", TIMER_IRQ_ID);
+    }
+}
+
+// Make the timer PPI pending at the GIC without touching the comparator
+void timer_raise_pending(void) {
+    gic->clear_pending(TIMER_IRQ_ID);
+    gic->set_pending(TIMER_IRQ_ID);
 }
 
 // Function to manually trigger a timer interrupt using GIC
@@ -184,11 +258,7 @@ void force_timer_interrupt(void) {
     debug_print("[TIMER] Forcing timer interrupt for testing...\n");
     raw_uart_puts("[TIMER_TEST] Forcing timer interrupt via GIC\n");
     
-    // First clear any pending interrupt
-    *((volatile uint32_t*)GICD_ICPENDR1) = TIMER_IRQ_BIT;
-    
-    // Set timer interrupt as pending
-    *((volatile uint32_t*)GICD_ISPENDR1) = TIMER_IRQ_BIT;
+    timer_raise_pending();
     
     raw_uart_puts("[TIMER_TEST] Timer interrupt forced - pending bit set\n");
     
@@ -202,9 +272,8 @@ void force_timer_interrupt(void) {
 void test_irq_handler(void) {
     raw_uart_puts("[IRQ_TEST] Directly testing IRQ handler\n");
     
-    // Call the IRQ handler directly
-    extern void irq_handler(void);
-    irq_handler();
+    // Call the IRQ handler directly (no exception frame)
+    irq_handler(NULL, 0);
     
     raw_uart_puts("[IRQ_TEST] Direct IRQ handler test complete\n");
 }
@@ -213,6 +282,12 @@ void test_irq_handler(void) {
 void init_timer(int ms_interval) {
     uart_puts("[TIMER] Initializing timer interrupts...\n");
     
+    // The interval is the scheduler slice; the one-shot timer is re-armed
+    // with it on every switch
+    if (ms_interval > 0) {
+        timer_set_slice_interval((uint64_t)ms_interval * NSEC_PER_MSEC);
+    }
+    
     // Call the proper timer initialization function
     timer_init();
     
@@ -241,26 +316,13 @@ void timer_ack(void) {
 void init_timer_irq(void) {
     uart_puts("[TIMER] Setting up timer interrupt connection...\n");
     
-    // Configure the GIC to enable timer interrupts
+    // Step 1: Bring up the GIC (no-op if timer_init() already did)
+    gic_init();
     
-    // Step 1: Enable the GIC Distributor
-    *((volatile uint32_t*)GICD_CTLR) = 1;
-    
-    // Step 2: Enable the timer interrupt (IRQ 30)
-    *((volatile uint32_t*)GICD_ISENABLER1) = TIMER_IRQ_BIT;
-    
-    // Step 3: Set timer interrupt priority (lower value = higher priority)
-    volatile uint32_t* priority_reg = (volatile uint32_t*)GICD_IPRIORITYR7;
-    // Set bits 8-15 to 0xA0 (middle priority)
-    uint32_t priority_val = *priority_reg;
-    priority_val = (priority_val & ~(0xFF << 8)) | (0xA0 << 8);
-    *priority_reg = priority_val;
-    
-    // Step 4: Enable the GIC CPU interface
-    *((volatile uint32_t*)GICC_CTLR) = 1;
-    
-    // Step 5: Set the priority mask to allow all interrupts
-    *((volatile uint32_t*)GICC_PMR) = 0xFF;
+    // Step 2: Install the timer handler (priority + enable for the PPI)
+    if (request_irq(TIMER_IRQ_ID, timer_irq, NULL) == 0) {
+        irq_set_priority(TIMER_IRQ_ID, IRQ_TIMER_PRIORITY);
+    }
     
     uart_puts("[TIMER] Timer interrupt connection established\n");
 }
@@ -0,0 +1,100 @@
+/*
+ * console.c - Buffered console output
+ *
+ * Writers append to a RAM buffer; console_flush() moves it to the PL011
+ * a FIFO at a time. Waiting once for TXFE and then filling the whole FIFO
+ * costs one flag register read per UART_FIFO_DEPTH bytes instead of one
+ * per byte as in uart_putc(). Once uart_irq_init() has run the buffer is
+ * handed to the interrupt-driven TX ring instead and flushing no longer
+ * waits for the serial line.
+ */
+
+#include "../../../include/console.h"
+#include "../../../include/uart.h"
+#include "../../../include/interrupts.h"
+
+#define UART_DR_OFFSET      0x00
+#define UART_FR_OFFSET      0x18
+#define UART_LCRH_OFFSET    0x2C
+
+#define UART_FR_TXFF        (1 << 5)    // Transmit FIFO full
+#define UART_FR_TXFE        (1 << 7)    // Transmit FIFO empty
+#define UART_LCRH_FEN       (1 << 4)    // FIFOs enabled
+
+// Bytes [console_head, console_tail) are waiting for the UART
+static char console_buf[CONSOLE_BUF_SIZE];
+static size_t console_head;
+static size_t console_tail;
+
+static inline volatile uint32_t* uart_reg(uint32_t offset) {
+    return (volatile uint32_t*)((uintptr_t)g_uart_base + offset);
+}
+
+// Move the buffer into the TX ring, sleeping only while the ring is full
+static void console_drain_irq(void) {
+    while (1) {
+        unsigned long flags = local_irq_save();
+        if (console_head == console_tail) {
+            console_head = console_tail = 0;
+            local_irq_restore(flags);
+            return;
+        }
+        size_t n = uart_write(console_buf + console_head, console_tail - console_head);
+        console_head += n;
+        local_irq_restore(flags);
+
+        if (!n) uart_tx_wait_room();
+    }
+}
+
+// IRQs are masked while a burst is written but not while waiting for the
+// FIFO to empty. TXFE is checked again under the mask so a task that
+// preempted us in between cannot have refilled the FIFO.
+static void console_drain(void) {
+    if (uart_tx_irq_enabled()) {
+        console_drain_irq();
+        return;
+    }
+
+    // With FIFOs disabled the holding register is a single byte deep
+    size_t burst = (*uart_reg(UART_LCRH_OFFSET) & UART_LCRH_FEN) ? UART_FIFO_DEPTH : 1;
+
+    while (1) {
+        while (!(*uart_reg(UART_FR_OFFSET) & UART_FR_TXFE));
+
+        unsigned long flags = local_irq_save();
+        if (console_head == console_tail) {
+            console_head = console_tail = 0;
+            local_irq_restore(flags);
+            return;
+        }
+        if (*uart_reg(UART_FR_OFFSET) & UART_FR_TXFE) {
+            size_t end = console_head + burst < console_tail ? console_head + burst : console_tail;
+            while (console_head < end) {
+                *uart_reg(UART_DR_OFFSET) = (uint8_t)console_buf[console_head++];
+            }
+        }
+        local_irq_restore(flags);
+    }
+}
+
+void console_write(const char* buf, size_t len) {
+    unsigned long flags = local_irq_save();
+
+    for (size_t i = 0; i < len; i++) {
+        // Keep room for a CR/LF pair
+        if (console_tail + 2 > CONSOLE_BUF_SIZE) {
+            local_irq_restore(flags);
+            console_drain();
+            flags = local_irq_save();
+        }
+        if (buf[i] == '\n') console_buf[console_tail++] = '\r';
+        console_buf[console_tail++] = buf[i];
+    }
+
+    local_irq_restore(flags);
+}
+
+void console_flush(void) {
+    console_drain();
+}
@@ -1,6 +1,8 @@
 #include "../../../include/types.h"
 #include "../../../include/uart.h"
 #include "../../../include/vmm.h"
+#include "../../../include/console.h"  // UART_FIFO_DEPTH
+#include "../../../include/printf.h"
 
 // Global MMU state flag - Now imported from vmm.c
 // static int mmu_enabled = 0; - Removed as it's now defined in vmm.c
@@ -13,21 +15,24 @@
 // Define register offsets
 #define UART_DR_OFFSET     0x00    // Data Register
 #define UART_FR_OFFSET     0x18    // Flag Register
+#define UART_LCRH_OFFSET   0x2C    // Line Control Register
 
 // UART Flag Register bit masks
 #define UART_FR_TXFF       (1 << 5)  // Transmit FIFO full
 #define UART_FR_RXFE       (1 << 4)  // Receive FIFO empty
+#define UART_FR_TXFE       (1 << 7)  // Transmit FIFO empty
+#define UART_LCRH_FEN      (1 << 4)  // FIFOs enabled
 
 // Debug flag
 #define DEBUG_UART_PUTS    DEBUG_UART_MODE
 
-// Direct register access functions - more reliable than macros
+// Direct register access functions - offsets are in bytes
 static inline void uart_write_reg(uint32_t offset, uint32_t value) {
-    *((volatile uint32_t*)(g_uart_base + (uintptr_t)offset)) = value;
+    *((volatile uint32_t*)((uintptr_t)g_uart_base + offset)) = value;
 }
 
 static inline uint32_t uart_read_reg(uint32_t offset) {
-    return *((volatile uint32_t*)(g_uart_base + (uintptr_t)offset));
+    return *((volatile uint32_t*)((uintptr_t)g_uart_base + offset));
 }
 
 // is_mmu_enabled() removed as we now access the global flag directly
@@ -39,12 +44,50 @@ void uart_init(void) {
 }
 
 void uart_putc(char c) {
+    // Once the TX interrupt drives the UART, go through its ring so output
+    // stays in order with uart_write()
+    if (uart_tx_irq_enabled()) {
+        while (!uart_write(&c, 1)) uart_tx_wait_room();
+        return;
+    }
+    
     // Wait until UART is ready to transmit
     while (uart_read_reg(UART_FR_OFFSET) & UART_FR_TXFF);
     // Write character to data register
     uart_write_reg(UART_DR_OFFSET, c);
 }
 
+// Write n bytes straight from the caller's buffer. Polled output waits for
+// TXFE once per UART_FIFO_DEPTH bytes instead of checking TXFF per byte.
+static void uart_write_direct(const char* s, size_t n) {
+    if (uart_tx_irq_enabled()) {
+        while (n) {
+            size_t done = uart_write(s, n);
+            s += done;
+            n -= done;
+            if (n) uart_tx_wait_room();
+        }
+        return;
+    }
+    
+    // With FIFOs disabled the holding register is a single byte deep
+    size_t burst = (uart_read_reg(UART_LCRH_OFFSET) & UART_LCRH_FEN) ? UART_FIFO_DEPTH : 1;
+    
+    while (n) {
+        size_t chunk = n < burst ? n : burst;
+        
+        while (!(uart_read_reg(UART_FR_OFFSET) & UART_FR_TXFE));
+        for (size_t i = 0; i < chunk; i++) {
+            uart_write_reg(UART_DR_OFFSET, (uint8_t)s[i]);
+        }
+        s += chunk;
+        n -= chunk;
+    }
+}
+
+// Valid with the MMU on or off: g_uart_base always holds the address the
+// current translation regime reaches the UART at, and the string is read
+// in place, so there is no length limit and no cache maintenance
 void uart_puts(const char *str) {
     // Debug marker to identify string print start
     if (DEBUG_UART_PUTS) {
@@ -53,42 +96,16 @@ void uart_puts(const char *str) {
     
     if (!str) return;  // Safety check for null pointer
     
-    // Use different implementations based on MMU state with proper synchronization
-    if (mmu_enabled) {
-        // MMU is enabled, use late implementation for virtual addresses and our global buffers
-        
-        // Get access to the global buffers
-        extern volatile char global_string_buffer[];
-        
-        // Copy the string to our global buffer for safety
-        int i;
-        for (i = 0; str[i] && i < 250; i++) {
-            global_string_buffer[i] = str[i];
-        }
-        global_string_buffer[i] = '\0';
-        
-        // Clean the cache lines for the copied buffer
-        for (uintptr_t addr = (uintptr_t)global_string_buffer; 
-             addr < (uintptr_t)global_string_buffer + ((i / 64) + 1) * 64; 
-             addr += 64) {
-            // Clean the cache line to ensure it's in memory
-            asm volatile("dc cvac, %0" :: "r" (addr));
-        }
-        asm volatile("dsb ish" ::: "memory");
-        
-        // Process each character from the global buffer
-        for (i = 0; global_string_buffer[i]; i++) {
-            if (global_string_buffer[i] == '\n') uart_putc('\r');
-            uart_putc(global_string_buffer[i]);
-        }
-    } else {
-        // Pre-MMU operation using direct access
-        // Process each character
-        while (*str) {
-            if (*str == '\n') uart_putc('\r');  // Add carriage return
-            uart_putc(*str++);
+    // Emit runs between newlines in one go, with "\n" expanded to CR/LF
+    const char* run = str;
+    for (; *str; str++) {
+        if (*str == '\n') {
+            uart_write_direct(run, (size_t)(str - run));
+            uart_write_direct("\r\n", 2);
+            run = str + 1;
         }
     }
+    uart_write_direct(run, (size_t)(str - run));
     
     // Debug marker to identify string print end
     if (DEBUG_UART_PUTS) {
@@ -110,73 +127,32 @@ void safe_uart_puts(const char* str) {
 }
 
 void uart_puthex(uint64_t value) {
-    // Print "0x" prefix using putc directly
-    uart_putc('0');
-    uart_putc('x');
-    
-    // Print exactly 8 hex digits with leading zeros for addresses
-    for (int i = 28; i >= 0; i -= 4) {
-        uint8_t digit = (value >> i) & 0xF;
-        
-        // Convert digit to character and print it
-        if (digit < 10) {
-            uart_putc('0' + digit);
-        } else {
-            uart_putc('a' + (digit - 10));
-        }
-    }
+    // "0x" and exactly 8 digits (low 32 bits) for addresses
+    char buf[12];
+    int n = snprintf(buf, sizeof(buf), "0x%08x", (uint32_t)value);
+    uart_write_direct(buf, (size_t)n);
 }
 
 // Function to print 64-bit value in hexadecimal format (16 digits)
 void uart_print_hex(uint64_t value) {
-    // Print all 16 hex digits with leading zeros for 64-bit values
-    const int num_digits = 16;
-    
-    for (int i = (num_digits - 1) * 4; i >= 0; i -= 4) {
-        uint8_t digit = (value >> i) & 0xF;
-        
-        // Convert digit to character and print it
-        if (digit < 10) {
-            uart_putc('0' + digit);
-        } else {
-            uart_putc('A' + (digit - 10));  // Use capital letters
-        }
-    }
+    char buf[20];
+    int n = snprintf(buf, sizeof(buf), "%016llX", value);
+    uart_write_direct(buf, (size_t)n);
 }
 
 // Function to print a 64-bit value in hex format with proper formatting
 void uart_hex64(uint64_t value) {
-    char buf[17];
-    buf[16] = '\0';
-    
-    for (int i = 15; i >= 0; i--) {
-        int nibble = value & 0xF;
-        buf[i] = (nibble < 10) ? ('0' + nibble) : ('a' + nibble - 10);
-        value >>= 4;
-    }
-    
-    uart_putc('0');
-    uart_putc('x');
-    
-    // Loop through the buffer and output character by character
-    for (int i = 0; i < 16; i++) {
-        uart_putc(buf[i]);
-    }
+    char buf[20];
+    int n = snprintf(buf, sizeof(buf), "0x%016llx", value);
+    uart_write_direct(buf, (size_t)n);
 }
 
 // Function to print a value in hex format (used in context.S and vmm.c)
 void uart_putx(uint64_t value) {
-    // Print 8 hex digits with no prefix
-    for (int i = 28; i >= 0; i -= 4) {
-        uint8_t digit = (value >> i) & 0xF;
-        
-        // Convert digit to character and print it
-        if (digit < 10) {
-            uart_putc('0' + digit);
-        } else {
-            uart_putc('A' + (digit - 10));  // Use capital letters
-        }
-    }
+    // 8 digits, no prefix
+    char buf[12];
+    int n = snprintf(buf, sizeof(buf), "%08X", (uint32_t)value);
+    uart_write_direct(buf, (size_t)n);
 }
 
 // Direct raw UART output function with no checks or waiting
@@ -331,15 +307,11 @@ void uart_puts_early(const char *str) {
 }
 
 void uart_hex64_early(uint64_t value) {
-    // Output "0x" prefix
-    uart_putc_early('0');
-    uart_putc_early('x');
-    
-    // Output all 16 hex digits
-    for (int i = 60; i >= 0; i -= 4) {
-        uint8_t nibble = (value >> i) & 0xF;
-        char c = (nibble < 10) ? ('0' + nibble) : ('a' + nibble - 10);
-        uart_putc_early(c);
+    char buf[20];
+    int n = snprintf(buf, sizeof(buf), "0x%016llx", value);
+    
+    for (int i = 0; i < n; i++) {
+        uart_putc_early(buf[i]);
     }
 }
 
@@ -0,0 +1,285 @@
+/*
+ * uart_irq.c - Interrupt-driven PL011 transmit and receive
+ *
+ * Each direction has a single-producer/single-consumer ring. uart_write()
+ * copies into the TX ring and returns at once; the TX interrupt refills
+ * the FIFO whenever it drains to the UARTIFLS trigger level, so output
+ * overlaps with whatever the writer does next. The RX interrupt (FIFO
+ * half full, or the receive timeout for a trickle of input) empties the
+ * FIFO into the RX ring and leaves waking readers to UART_RX_SOFTIRQ.
+ *
+ * Ring indices are free-running. Each one is written by a single side and
+ * published with release/acquire ordering, so producer and consumer never
+ * share a lock.
+ */
+
+#include "../../../include/uart.h"
+#include "../../../include/irq.h"
+#include "../../../include/softirq.h"
+#include "../../../include/wait.h"
+#include "../../../include/interrupts.h"
+#include "../../../include/scheduler.h"
+#include "../../../include/task.h"
+
+// QEMU virt wires the PL011 to SPI 1
+#define UART_IRQ_ID         33
+
+#define UART_DR_OFFSET      0x00
+#define UART_FR_OFFSET      0x18
+#define UART_IFLS_OFFSET    0x34
+#define UART_IMSC_OFFSET    0x38
+#define UART_MIS_OFFSET     0x40
+#define UART_ICR_OFFSET     0x44
+
+#define UART_FR_RXFE        (1 << 4)    // Receive FIFO empty
+#define UART_FR_TXFF        (1 << 5)    // Transmit FIFO full
+
+// UARTIFLS trigger levels
+#define UART_IFLS_1_8       0
+#define UART_IFLS_1_4       1
+#define UART_IFLS_1_2       2
+#define UART_IFLS_TX(lvl)   ((lvl) << 0)
+#define UART_IFLS_RX(lvl)   ((lvl) << 3)
+
+// Interrupt bits shared by IMSC, MIS and ICR
+#define UART_INT_RX         (1 << 4)
+#define UART_INT_TX         (1 << 5)
+#define UART_INT_RT         (1 << 6)    // Receive timeout
+#define UART_INT_OE         (1 << 10)   // Overrun
+#define UART_INT_ALL        0x7FF
+
+struct uart_ring {
+    volatile uint32_t head;     // Next slot to consume
+    volatile uint32_t tail;     // Next slot to fill
+};
+
+static uint8_t uart_tx_buf[UART_TX_RING_SIZE];
+static uint8_t uart_rx_buf[UART_RX_RING_SIZE];
+static struct uart_ring uart_tx_ring;
+static struct uart_ring uart_rx_ring;
+
+static DECLARE_WAIT_QUEUE_HEAD(uart_tx_wait);
+static DECLARE_WAIT_QUEUE_HEAD(uart_rx_wait);
+
+static int uart_irq_ready;
+static int uart_tx_armed;       // TXIM set, the ISR owns the refill
+static uint64_t uart_tx_irqs;
+static uint64_t uart_rx_dropped;
+static uint64_t uart_rx_overruns;
+
+static inline volatile uint32_t* uart_reg(uint32_t offset) {
+    return (volatile uint32_t*)((uintptr_t)g_uart_base + offset);
+}
+
+static inline uint32_t ring_count(const struct uart_ring* ring) {
+    return __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) -
+           __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+}
+
+// Move TX ring bytes into the FIFO until one of them runs out. IRQs
+// masked: called from the ISR, the kick in uart_write() and the poller.
+static void uart_tx_fill(void) {
+    uint32_t head = uart_tx_ring.head;
+    uint32_t tail = __atomic_load_n(&uart_tx_ring.tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail && !(*uart_reg(UART_FR_OFFSET) & UART_FR_TXFF)) {
+        *uart_reg(UART_DR_OFFSET) = uart_tx_buf[head & (UART_TX_RING_SIZE - 1)];
+        head++;
+    }
+    __atomic_store_n(&uart_tx_ring.head, head, __ATOMIC_RELEASE);
+}
+
+// Prime the FIFO and arm TXIM if the ISR is not already refilling it.
+// The TX interrupt only fires when the FIFO level crosses the trigger,
+// so it has to be started by hand after going idle.
+static void uart_tx_kick(void) {
+    if (uart_tx_armed) return;
+
+    uart_tx_fill();
+    if (ring_count(&uart_tx_ring)) {
+        uart_tx_armed = 1;
+        *uart_reg(UART_IMSC_OFFSET) |= UART_INT_TX;
+    }
+}
+
+// Handlers run with IRQs unmasked under a higher-priority tick, whose
+// console output goes through uart_write(); mask only around the refill
+// and disarm that uart_tx_kick() races with
+static void uart_tx_interrupt(void) {
+    unsigned long flags = local_irq_save();
+
+    uart_tx_irqs++;
+    uart_tx_fill();
+    if (!ring_count(&uart_tx_ring)) {
+        *uart_reg(UART_IMSC_OFFSET) &= ~UART_INT_TX;
+        uart_tx_armed = 0;
+    }
+    local_irq_restore(flags);
+    if (waitqueue_active(&uart_tx_wait)) wake_up_all(&uart_tx_wait);
+}
+
+static void uart_rx_interrupt(void) {
+    uint32_t head = __atomic_load_n(&uart_rx_ring.head, __ATOMIC_ACQUIRE);
+    uint32_t tail = uart_rx_ring.tail;
+
+    while (!(*uart_reg(UART_FR_OFFSET) & UART_FR_RXFE)) {
+        uint8_t c = (uint8_t)*uart_reg(UART_DR_OFFSET);
+
+        if (tail - head < UART_RX_RING_SIZE) {
+            uart_rx_buf[tail & (UART_RX_RING_SIZE - 1)] = c;
+            tail++;
+        } else {
+            uart_rx_dropped++;
+        }
+    }
+    __atomic_store_n(&uart_rx_ring.tail, tail, __ATOMIC_RELEASE);
+
+    // RXIS clears itself once the FIFO is drained; the timeout does not
+    *uart_reg(UART_ICR_OFFSET) = UART_INT_RX | UART_INT_RT;
+    raise_softirq(UART_RX_SOFTIRQ);
+}
+
+static void uart_irq(uint32_t irq, void* data) {
+    (void)irq;
+    (void)data;
+
+    uint32_t mis = *uart_reg(UART_MIS_OFFSET);
+
+    if (mis & (UART_INT_RX | UART_INT_RT)) uart_rx_interrupt();
+    if (mis & UART_INT_TX) uart_tx_interrupt();
+    if (mis & UART_INT_OE) {
+        *uart_reg(UART_ICR_OFFSET) = UART_INT_OE;
+        uart_rx_overruns++;
+    }
+}
+
+// Bottom half: hand received bytes to sleeping readers
+static void uart_rx_softirq(void) {
+    if (waitqueue_active(&uart_rx_wait)) wake_up_all(&uart_rx_wait);
+}
+
+void uart_irq_init(void) {
+    if (uart_irq_ready) return;
+
+    *uart_reg(UART_IMSC_OFFSET) = 0;
+    *uart_reg(UART_ICR_OFFSET) = UART_INT_ALL;
+    // TX refills with 3/4 of the FIFO free; RX batches half a FIFO
+    *uart_reg(UART_IFLS_OFFSET) = UART_IFLS_TX(UART_IFLS_1_4) | UART_IFLS_RX(UART_IFLS_1_2);
+
+    open_softirq(UART_RX_SOFTIRQ, uart_rx_softirq);
+    if (request_irq(UART_IRQ_ID, uart_irq, NULL) != 0) return;
+
+    unsigned long flags = local_irq_save();
+    *uart_reg(UART_IMSC_OFFSET) = UART_INT_RX | UART_INT_RT | UART_INT_OE;
+    uart_irq_ready = 1;
+    local_irq_restore(flags);
+}
+
+int uart_tx_irq_enabled(void) {
+    return uart_irq_ready;
+}
+
+size_t uart_write(const void* buf, size_t len) {
+    const uint8_t* src = (const uint8_t*)buf;
+
+    if (!uart_irq_ready) {
+        // Polled until uart_irq_init() has run
+        for (size_t i = 0; i < len; i++) {
+            while (*uart_reg(UART_FR_OFFSET) & UART_FR_TXFF);
+            *uart_reg(UART_DR_OFFSET) = src[i];
+        }
+        return len;
+    }
+
+    // IRQs masked only to serialise producers (tasks and interrupt-context
+    // uart_putc()); the ISR consumes without taking any lock
+    unsigned long flags = local_irq_save();
+    uint32_t tail = uart_tx_ring.tail;
+    uint32_t room = UART_TX_RING_SIZE - (tail - __atomic_load_n(&uart_tx_ring.head, __ATOMIC_ACQUIRE));
+    size_t n = len < room ? len : room;
+
+    for (size_t i = 0; i < n; i++) {
+        uart_tx_buf[(tail + i) & (UART_TX_RING_SIZE - 1)] = src[i];
+    }
+    __atomic_store_n(&uart_tx_ring.tail, tail + (uint32_t)n, __ATOMIC_RELEASE);
+
+    uart_tx_kick();
+    local_irq_restore(flags);
+    return n;
+}
+
+// Arm TXIM before the first FIFO fill, so the TX interrupt runs at least
+// once even when the FIFO takes every byte at once (QEMU's PL011 drains
+// instantly and uart_tx_kick() would never arm it)
+size_t uart_write_tx_armed(const void* buf, size_t len) {
+    unsigned long flags = local_irq_save();
+    size_t n;
+
+    if (uart_irq_ready && !uart_tx_armed) {
+        uart_tx_armed = 1;
+        *uart_reg(UART_IMSC_OFFSET) |= UART_INT_TX;
+    }
+    n = uart_write(buf, len);
+    uart_tx_fill();
+    local_irq_restore(flags);
+    return n;
+}
+
+uint64_t uart_tx_irq_count(void) {
+    return uart_tx_irqs;
+}
+
+void uart_tx_wait_room(void) {
+    unsigned long daif;
+    __asm__ volatile("mrs %0, daif" : "=r"(daif));
+
+    // Cannot sleep: push a FIFO's worth out by polling instead
+    if ((daif & (1UL << 7)) || in_interrupt()) {
+        unsigned long flags = local_irq_save();
+        while (*uart_reg(UART_FR_OFFSET) & UART_FR_TXFF);
+        uart_tx_fill();
+        local_irq_restore(flags);
+        return;
+    }
+
+    wait_event(uart_tx_wait, ring_count(&uart_tx_ring) < UART_TX_RING_SIZE);
+}
+
+size_t uart_read(void* buf, size_t len) {
+    uint8_t* dst = (uint8_t*)buf;
+    uint32_t head = uart_rx_ring.head;
+    uint32_t avail = ring_count(&uart_rx_ring);
+    size_t n = len < avail ? len : avail;
+
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = uart_rx_buf[(head + i) & (UART_RX_RING_SIZE - 1)];
+    }
+    __atomic_store_n(&uart_rx_ring.head, head + (uint32_t)n, __ATOMIC_RELEASE);
+    return n;
+}
+
+// Without the RX interrupt nothing fills the ring: read the FIFO
+// directly, yielding between empty polls when there is a task to yield to
+static size_t uart_read_poll(void* buf, size_t len) {
+    uint8_t* dst = (uint8_t*)buf;
+    size_t n = 0;
+
+    while (1) {
+        while (n < len && !(*uart_reg(UART_FR_OFFSET) & UART_FR_RXFE)) {
+            dst[n++] = (uint8_t)*uart_reg(UART_DR_OFFSET);
+        }
+        if (n) return n;
+        if (current_task) yield();
+    }
+}
+
+size_t uart_read_wait(void* buf, size_t len) {
+    if (!len) return 0;
+    if (!uart_irq_ready) return uart_read_poll(buf, len);
+    wait_event(uart_rx_wait, ring_count(&uart_rx_ring) > 0);
+    return uart_read(buf, len);
+}
+
+uint64_t uart_rx_dropped_count(void) {
+    return uart_rx_dropped + uart_rx_overruns;
+}
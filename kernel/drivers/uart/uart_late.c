@@ -1,6 +1,7 @@
 #include "../../../include/types.h"
 #include "../../../include/uart.h"
 #include "../../../include/mmu_policy.h"  // For centralized TLB operations
+#include "../../../include/printf.h"
 
 // Explicitly reference the global UART base pointer defined in uart.c
 extern volatile uint32_t* g_uart_base;
@@ -230,9 +231,17 @@ void uart_putc_late(char c) {
     *(g_uart_base) = c;
 }
 
+// Staged output for the MMU transition window only: until uart_set_base()
+// has moved g_uart_base and set mmu_enabled, the string is copied into a
+// cache-cleaned global buffer first. Afterwards this is plain uart_puts().
 void uart_puts_late(const char *str) {
     if (!str) return;
     
+    if (mmu_enabled) {
+        uart_puts(str);
+        return;
+    }
+    
     // Debug output to verify the UART base address - use direct access
     uart_emergency_output('A'); // UART base address check
     // Output the global base pointer value instead of hardcoded address
@@ -289,24 +298,21 @@ void uart_puts_late(const char *str) {
 }
 
 void uart_hex64_late(uint64_t value) {
-    // Output "0x" prefix
-    uart_putc_late('0');
-    uart_putc_late('x');
-    
-    // Output all 16 hex digits
-    for (int i = 60; i >= 0; i -= 4) {
-        uint8_t nibble = (value >> i) & 0xF;
-        char c = (nibble < 10) ? ('0' + nibble) : ('a' + nibble - 10);
-        uart_putc_late(c);
+    char buf[20];
+    int n = snprintf(buf, sizeof(buf), "0x%016llx", value);
+    
+    for (int i = 0; i < n; i++) {
+        uart_putc_late(buf[i]);
     }
 }
 
 // Debug helper for validating pointer values post-MMU
 void uart_debug_hex(uint64_t val) {
-    for (int i = 60; i >= 0; i -= 4) {
-        uint8_t nibble = (val >> i) & 0xF;
-        char c = (nibble < 10) ? ('0' + nibble) : ('A' + nibble - 10);
-        *(g_uart_base) = c;
+    char buf[20];
+    int n = snprintf(buf, sizeof(buf), "%016llX", val);
+    
+    for (int i = 0; i < n; i++) {
+        *(g_uart_base) = buf[i];
     }
 }
 
@@ -420,16 +426,10 @@ void uart_emergency_puts(const char* str) {
 
 // Diagnostic helper that directly prints a hex value using assembly
 void uart_emergency_hex64(uint64_t value) {
-    // Hex digits lookup
-    static const char hex_chars[] = "0123456789abcdef";
-    
-    // Output 0x prefix
-    uart_emergency_output('0');
-    uart_emergency_output('x');
+    char buf[20];
+    int n = snprintf(buf, sizeof(buf), "0x%016llx", value);
     
-    // Output 16 hex digits from most significant to least
-    for (int i = 60; i >= 0; i -= 4) {
-        uint8_t nibble = (value >> i) & 0xF;
-        uart_emergency_output(hex_chars[nibble]);
+    for (int i = 0; i < n; i++) {
+        uart_emergency_output(buf[i]);
     }
-} 
\ No newline at end of file
+}
\ No newline at end of file
@@ -7,6 +7,7 @@
  */
 
 #include "../include/console_api.h"
+#include "../../../include/printf.h"
 
 // UART register definitions (TODO: move to platform config)
 #define UART0_BASE_ADDR 0x09000000
@@ -66,22 +67,12 @@ void early_console_hex64(const char* label, uint64_t value) {
     // Direct UART access for raw hex output
     volatile uint32_t* dr = (volatile uint32_t*)UART_DR_REG;
     volatile uint32_t* fr = (volatile uint32_t*)UART_FR_REG;
+    char buf[20];
+    int n = snprintf(buf, sizeof(buf), "0x%016llX", value);
     
-    // Output "0x" prefix
-    while ((*fr) & UART_FR_TXFF);
-    *dr = '0';
-    while ((*fr) & UART_FR_TXFF);
-    *dr = 'x';
-    
-    // Print all 16 hex digits (64 bits)
-    for (int i = 15; i >= 0; i--) {
-        // Extract each hex digit
-        int digit = (value >> (i * 4)) & 0xF;
-        char hex_char = digit < 10 ? ('0' + digit) : ('A' + (digit - 10));
-        
-        // Output to UART
+    for (int i = 0; i < n; i++) {
         while ((*fr) & UART_FR_TXFF);
-        *dr = hex_char;
+        *dr = buf[i];
     }
     
     // Add newline
@@ -13,9 +13,23 @@
 
 #include "../../../include/types.h"
 #include "../../../include/task.h"
+#include "../../../include/syscall.h"
 
 /* ========== Exception Testing Functions ========== */
 
+#define __stringify_1(x) #x
+#define __stringify(x) __stringify_1(x)
+
+// One syscall round trip through el1_sync: full frame save, table
+// lookup in syscall_dispatch(), frame restore and eret
+static inline uint64_t svc_getpid(void) {
+    register uint64_t x0 __asm__("x0");
+    register uint64_t x8 __asm__("x8") = SYS_GETPID;
+    __asm__ volatile("svc #" __stringify(SVC_IMM_KERNEL)
+                     : "=r"(x0) : "r"(x8) : "memory");
+    return x0;
+}
+
 /**
  * test_exception_delivery - Comprehensive exception system validation
  * 
@@ -59,6 +73,137 @@ void test_system_state(void);
  */
 void test_svc_variants(void);
 
+/**
+ * test_svc_benchmark - Round-trip syscall latency
+ * 
+ * Times SYS_GETPID through the full trap frame entry, dispatch and eret
+ * return path and reports the cost per call.
+ */
+void test_svc_benchmark(void);
+
+/**
+ * test_irq_priority_nesting - Higher-priority IRQs preempt running handlers
+ * 
+ * Checks that an SGI at IRQ_TIMER_PRIORITY nests inside a running
+ * default-priority handler while a default-priority one waits for it.
+ */
+void test_irq_priority_nesting(void);
+
+/**
+ * test_tracepoints - Static tracepoint patching and capture
+ * 
+ * Enables the syscall and pmm_alloc tracepoints, checks that a known
+ * number of calls produce exactly that many records and that patched-out
+ * sites record nothing, then dumps the capture.
+ */
+void test_tracepoints(void);
+
+/**
+ * test_pmu_counters - Validate PMU counting and print the perf report
+ * 
+ * Checks INST_RETIRED and the cycle counter against a loop with a known
+ * instruction count, then prints the per-region and per-task PMU totals
+ * collected since boot.
+ */
+void test_pmu_counters(void);
+
+/**
+ * test_profile_sampling - Sampling profiler attributes samples correctly
+ * 
+ * Profiles a busy loop with the timer source and backtraces enabled and
+ * checks that nearly all samples carry a PC inside that loop.
+ */
+void test_profile_sampling(void);
+
+/* ========== Benchmark Suite ========== */
+
+// Summary of a set of timing samples
+struct bench_stats {
+    uint64_t min;
+    uint64_t median;
+    uint64_t p99;
+    uint64_t max;
+};
+
+/**
+ * bench_summarize - Sort samples and compute min/median/p99/max
+ * @s: samples, sorted in place
+ * @n: number of samples, at least one
+ * @st: filled in with nearest-rank statistics
+ */
+void bench_summarize(uint64_t* s, int n, struct bench_stats* st);
+
+/**
+ * bench_begin - Print the "<tag>-BEGIN v1 cntfrq=<hz> samples=<n>" header
+ * 
+ * Opens a block of machine-readable results; the counter frequency lets
+ * scripts convert CNTVCT ticks to time.
+ */
+void bench_begin(const char* tag, int samples);
+
+/**
+ * bench_task_init - Set up a kernel task on a freshly allocated stack page
+ * 
+ * Returns the stack page for the caller to free, or NULL if no page
+ * was available.
+ */
+uint64_t* bench_task_init(task_t* task, void (*entry)(void));
+
+/**
+ * bench_pingpong - cpu_switch_to() ping-pong between two kernel tasks
+ * @samples: receives the CNTVCT ticks of each sample
+ * @n: number of samples
+ * @batch: ping->pong->ping round trips per sample
+ * @entry_irqs: if non-NULL, set to whether IRQs were unmasked on entry
+ *              to the first task
+ * 
+ * Enters the tasks with IRQs masked, as schedule() does; the tasks mask
+ * them again before timing. Returns 0, or -1 if no stacks were available.
+ */
+int bench_pingpong(uint64_t* samples, int n, int batch, int* entry_irqs);
+
+/**
+ * svc_bench_ticks - Time back-to-back SYS_GETPID round trips
+ * 
+ * Returns the CNTVCT ticks taken by @calls svc_getpid() calls.
+ */
+uint64_t svc_bench_ticks(int calls);
+
+// Sample handed out by irq_latency_run(): @n latencies in CNTVCT ticks
+// for one trigger path ("timer" or "pending") and stage
+typedef void (*irqlat_report_t)(const char* path, const char* stage, uint64_t* s, int n);
+
+/**
+ * irq_latency_run - Sample the timer IRQ and preemption latency harness
+ * @tag: prefix of the "<tag>-SKIP" line printed if the harness cannot run
+ * @samples: interrupts per trigger path, capped at the harness maximum
+ * @report: called once per path and stage with the samples
+ * 
+ * Boot thread only, before the scheduler and the timer driver start.
+ */
+void irq_latency_run(const char* tag, int samples, irqlat_report_t report);
+
+/**
+ * run_kbench - Run the kernel microbenchmark suite
+ * 
+ * Times page alloc/free, map/unmap, context switch, SVC round trip,
+ * IRQ latency, memcpy and UART writes and prints min/median/p99 CNTVCT
+ * cycles per operation as "BENCH <name>.<stat> <value> cycles" lines
+ * between BENCH-BEGIN and BENCH-END (see scripts/kbench.sh).
+ */
+void run_kbench(void);
+
+/**
+ * test_irq_latency - Timer IRQ and preemption latency histograms
+ * 
+ * Fires the timer PPI thousands of times, once through a CNTV_CVAL_EL0
+ * deadline and once through the GIC pending bit, and prints trigger to
+ * vector entry, vector entry to irq_handler() and irq_handler() to the
+ * preempting task latencies as "IRQLAT" lines with log2 histograms.
+ * Runs from the boot thread before the scheduler is started.
+ */
+void test_irq_latency(void);
+
 /* ========== UART Testing Functions ========== */
 
 /**
@@ -108,6 +253,14 @@ void test_uart_timing(void);
  */
 void test_uart_hex_formatting(void);
 
+/**
+ * test_snprintf_formatting - Known-answer tests for the vsnprintf engine
+ * 
+ * Checks conversions, widths, padding, 64-bit modifiers and truncation
+ * against fixed expected strings and reports any mismatch.
+ */
+void test_snprintf_formatting(void);
+
 /**
  * test_uart_string_functions - Test string output functions
  * 
@@ -125,6 +278,14 @@ void test_uart_string_functions(void);
  */
 void test_uart_error_conditions(void);
 
+/**
+ * test_uart_tx_irq - Check the PL011 TX interrupt path is live
+ * 
+ * Sends a line with the TX interrupt armed and checks that its handler
+ * runs. Call after uart_irq_init() with IRQs unmasked.
+ */
+void test_uart_tx_irq(void);
+
 /* ========== Scheduler Testing Functions ========== */
 
 /**
@@ -206,6 +367,48 @@ void test_scheduler_state(void);
  */
 void test_scheduler_integration(void);
 
+/**
+ * test_context_switch_benchmark - Ping-pong context switch benchmark
+ * 
+ * Switches between two kernel tasks through cpu_switch_to() for a fixed
+ * number of rounds with IRQs masked and reports the cost per switch and
+ * switches per second.
+ */
+void test_context_switch_benchmark(void);
+
+/**
+ * test_task_entry_irqs - Check IRQs are unmasked on a new task's entry
+ * 
+ * Enters a fresh task the way schedule() does, with IRQs masked, and
+ * checks DAIF.I is clear on the first instruction of the task body.
+ */
+void test_task_entry_irqs(void);
+
+/**
+ * test_sync_primitives - Mutex, semaphore and condvar contention tests
+ * 
+ * Runs worker tasks that block and wake through schedule() against each
+ * primitive: mutex handoff and FIFO order, semaphore counting, and
+ * condvar signal versus broadcast. Boot thread only, before sched_start().
+ */
+void test_sync_primitives(void);
+
+/**
+ * test_timer_wheel_benchmark - Timer wheel insert/cancel benchmark
+ * 
+ * Arms a full pool of timers spread across all wheel levels, cancels
+ * them again and reports the average cost of each operation.
+ */
+void test_timer_wheel_benchmark(void);
+
+/**
+ * test_timer_wheel_rearm - Timer wheel callbacks that cancel and re-arm
+ * 
+ * Expiry callbacks cancel and re-arm timers still pending in the same
+ * batch; checks every timer fires and none fires before its deadline.
+ */
+void test_timer_wheel_rearm(void);
+
 /* ========== Comprehensive Test Suites ========== */
 
 /**
@@ -234,6 +437,7 @@ static inline void run_uart_test_suite(void) {
     test_uart_character_set();
     test_uart_string_functions();
     test_uart_hex_formatting();
+    test_snprintf_formatting();
     test_uart_timing();
     test_uart_error_conditions();
 }
@@ -273,6 +477,11 @@ static inline void run_post_mmu_test_suite(void) {
 #define SELFTEST_ENABLE_UART_TESTS         1
 #define SELFTEST_ENABLE_SCHEDULER_TESTS    1
 #define SELFTEST_ENABLE_COMPREHENSIVE_TESTS 1
+#define SELFTEST_ENABLE_BENCHMARKS         1
+#define SELFTEST_ENABLE_TRACE_TESTS        1
+#define SELFTEST_ENABLE_PROFILE_TESTS      1
+#define SELFTEST_ENABLE_KBENCH             1
+#define SELFTEST_ENABLE_IRQ_LATENCY        1
 
 // Test timing constants
 #define SELFTEST_DELAY_SHORT    10000
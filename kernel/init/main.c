@@ -8,6 +8,11 @@
 #include "../../include/types.h"
 #include "../../include/interrupts.h"
 #include "../../include/string.h"  // Add string.h for memset
+#include "../../include/printf.h"
+#include "../../include/clocksource.h"
+#include "../../include/debug_config.h"
+#include "../../include/klog.h"
+#include "../../include/pmu.h"
 #include "include/panic.h"        // New modular panic API
 #include "include/console_api.h"  // New modular console API
 #include "include/memory_debug.h" // New modular memory debug API
@@ -18,8 +23,6 @@
 // Add the test_context_switch declaration
 extern void test_context_switch(void);
 
-// Add declaration for snprintf function
-extern int snprintf(char* buffer, size_t count, const char* format, ...);
 
 
 
@@ -36,6 +39,14 @@ void kernel_main(unsigned long uart_addr);
 #define UART_FR_REG     (UART0_BASE_ADDR + 0x18)
 #define UART_FR_TXFF    (1 << 5)
 
+// Boot progress markers; compiled out above KLOG_DEBUG like early_log_*()
+#define boot_marker(c) do {                                                 \
+        if (KLOG_ENABLED(KLOG_DEBUG)) uart_debug_marker(c);                 \
+    } while (0)
+#define boot_marker_late(c) do {                                            \
+        if (KLOG_ENABLED(KLOG_DEBUG)) uart_debug_marker_late(c);            \
+    } while (0)
+
 // Vector table symbols defined in linker script
 extern char vector_table[];            // Virtual address (0x1000000)
 extern char _vector_table_load_start[]; // Physical load address (0x89000)
@@ -149,6 +160,29 @@ extern char _vector_table_dest_start[];
 
 
 
+#ifdef BUILD_PROFILE_RELEASE
+#define BUILD_PROFILE_NAME "release"
+#else
+#define BUILD_PROFILE_NAME "debug"
+#endif
+
+// CNTVCT_EL0 at _start, stored by start.S before the BSS is cleared
+uint64_t boot_cntvct_start __attribute__((used, section(".data"))) = 0;
+
+// Printed in every profile, so the cost of the boot diagnostics shows up
+// as the difference between a default and a PROFILE=release build (see
+// scripts/boot_time_compare.sh)
+static void report_boot_time(void) {
+    uint64_t ticks = clocksource_read() - boot_cntvct_start;
+    char buf[128];
+    
+    snprintf(buf, sizeof(buf),
+             "[BOOT] kernel_main complete: %llu ticks, %llu us since _start (%s, log level %d)\n",
+             ticks, clocksource_cyc2ns(ticks) / NSEC_PER_USEC,
+             BUILD_PROFILE_NAME, DEBUG_LOG_LEVEL);
+    uart_puts(buf);
+}
+
 // Entry point to the kernel. This gets called from start.S
 __attribute__((used, externally_visible, noinline, section(".text.boot.main")))
 void kernel_main(unsigned long uart_addr) {
@@ -158,86 +192,89 @@ void kernel_main(unsigned long uart_addr) {
     uart_clear_screen();
     
     // Output early stage marker 'A' directly to UART
-    uart_debug_marker('A'); // Start of kernel_main
+    boot_marker('A'); // Start of kernel_main
     
     // Initialize the UART for serial output - use early version explicitly
     uart_init_early(uart_addr);
     
+    // Start the PMU counters first so the perf regions in alloc_page()
+    // and map_range() cover the whole of memory init
+    pmu_init();
+    
     // Banner and version - explicitly use early functions before MMU
     uart_puts_early("\n\n===========[ CustomOS Kernel ]============\n");
     uart_puts_early("Version 0.1.0 - Boot Sequence\n");
     uart_puts_early("========================================\n\n");
     
     // Initialize memory management using unified interface
-    *uart = 'M';  // Memory initialization marker
+    early_log_puts(KLOG_DEBUG, "M");  // Memory initialization marker
     extern int init_memory_subsystem(void);
     int memory_result = init_memory_subsystem();
     if (memory_result == 0) {
-        *uart = '0';  // Full MMU success marker
-        *uart = 'F'; *uart = 'U'; *uart = 'L'; // FUL - Full MMU support
+        early_log_puts(KLOG_DEBUG, "0FUL");  // Full MMU support
     } else if (memory_result == 1) {
-        *uart = '1';  // PMM-only mode marker
-        *uart = 'B'; *uart = 'Y'; *uart = 'P'; // BYP - Bypass mode
+        early_log_puts(KLOG_DEBUG, "1BYP");  // PMM-only (bypass) mode
     } else {
-        *uart = '!';  // Error marker
-        *uart = 'E'; *uart = 'R'; *uart = 'R'; // ERR - Error
+        early_log_puts(KLOG_ERR, "!ERR");    // Memory init failed
     }
-    uart_debug_marker('B'); // After memory initialization
+    boot_marker('B'); // After memory initialization
     
     // Validate vector table at physical address before MMU
-    *uart = 'V'; *uart = 'T'; *uart = 'C'; // VTC - Vector Table Check
+    early_log_puts(KLOG_DEBUG, "VTC");  // Vector Table Check
     validate_vector_table_at_0x89000();
     
     // Improved vector table verification with clear markers
-    *uart = 'V'; *uart = 'T'; *uart = 'V'; // VTV - Vector Table Verification
+    early_log_puts(KLOG_DEBUG, "VTV");  // Vector Table Verification
     volatile uint8_t* p = (volatile uint8_t*)0x00089000;
     
-    // Output first 32 bytes in a clean format
-    for (int i = 0; i < 32; i++) {
-        if (i % 8 == 0) {
-            *uart = '\n';
-            *uart = '0'; *uart = 'x'; // 0x prefix
-            // Output address
-            uint64_t addr = (uint64_t)(p + i);
-            for (int j = 7; j >= 0; j--) {
-                uint8_t byte = (addr >> (j * 8)) & 0xFF;
-                uint8_t hi = (byte >> 4) & 0xF;
-                uint8_t lo = byte & 0xF;
-                *uart = hi < 10 ? '0' + hi : 'A' + (hi - 10);
-                *uart = lo < 10 ? '0' + lo : 'A' + (lo - 10);
+    // Output first 32 bytes in a clean format (debug log level only)
+    if (KLOG_ENABLED(KLOG_DEBUG)) {
+        for (int i = 0; i < 32; i++) {
+            if (i % 8 == 0) {
+                *uart = '\n';
+                *uart = '0'; *uart = 'x'; // 0x prefix
+                // Output address
+                uint64_t addr = (uint64_t)(p + i);
+                for (int j = 7; j >= 0; j--) {
+                    uint8_t byte = (addr >> (j * 8)) & 0xFF;
+                    uint8_t hi = (byte >> 4) & 0xF;
+                    uint8_t lo = byte & 0xF;
+                    *uart = hi < 10 ? '0' + hi : 'A' + (hi - 10);
+                    *uart = lo < 10 ? '0' + lo : 'A' + (lo - 10);
+                }
+                *uart = ':'; *uart = ' ';
             }
-            *uart = ':'; *uart = ' ';
+            
+            char hi = (p[i] >> 4) & 0xF;
+            char lo = p[i] & 0xF;
+            *uart = hi < 10 ? '0' + hi : 'A' + (hi - 10);
+            *uart = lo < 10 ? '0' + lo : 'A' + (lo - 10);
+            *uart = ' ';
         }
-        
-        char hi = (p[i] >> 4) & 0xF;
-        char lo = p[i] & 0xF;
-        *uart = hi < 10 ? '0' + hi : 'A' + (hi - 10);
-        *uart = lo < 10 ? '0' + lo : 'A' + (lo - 10);
-        *uart = ' ';
+        *uart = '\n';
     }
-    *uart = '\n';
     
-    uart_debug_marker('C'); // After vector table verification
+    boot_marker('C'); // After vector table verification
     
     // Perform cache maintenance for vector table
-    *uart = 'C'; *uart = 'M'; *uart = 'V'; // CMV - Cache Maintenance Vector
+    early_log_puts(KLOG_DEBUG, "CMV");  // Cache Maintenance Vector
     asm volatile("dc cvau, %0" :: "r" (0x89000) : "memory");
     asm volatile("dsb ish");
     asm volatile("isb");
     
     // Set VBAR_EL1 to physical address BEFORE MMU
-    *uart = 'V'; *uart = 'B'; *uart = 'S'; // VBS - VBAR Set
+    early_log_puts(KLOG_DEBUG, "VBS");  // VBAR Set
     write_vbar_el1(0x89000);
-    uart_debug_marker('D'); // After setting VBAR_EL1 to 0x89000
+    boot_marker('D'); // After setting VBAR_EL1 to 0x89000
     
     // Check if MMU was successfully initialized
     if (memory_result == 0) {
         // Full MMU mode - MMU is already enabled by init_memory_subsystem
-        *uart = 'M'; *uart = 'M'; *uart = 'U'; // MMU - MMU enabled
+        early_log_puts(KLOG_DEBUG, "MMU");  // MMU enabled
         uart_puts_late("[BOOT] MMU is enabled, virtual addressing is active\n");
     } else {
         // Bypass mode - continue with physical addressing
-        *uart = 'P'; *uart = 'H'; *uart = 'Y'; // PHY - Physical addressing
+        early_log_puts(KLOG_DEBUG, "PHY");  // Physical addressing
     }
     
     // Handle post-initialization setup based on memory mode
@@ -246,21 +283,49 @@ void kernel_main(unsigned long uart_addr) {
         // CRITICAL: Post-MMU code must use uart_puts_late
         uart_puts_late("[BOOT] Updating VBAR_EL1 to virtual 0x1000000 after MMU\n");
         write_vbar_el1(0x1000000);
-        uart_debug_marker_late('F'); // After setting VBAR_EL1 to 0x1000000
+        boot_marker_late('F'); // After setting VBAR_EL1 to 0x1000000
         
         // Test UART string output after MMU enable
         // Use string literals directly inside this function to avoid stale pointer issues
         uart_puts_late("[BOOT] Testing UART string output after MMU is enabled\n");
         test_uart_after_mmu();
-        uart_debug_marker_late('G'); // After UART MMU test
+        boot_marker_late('G'); // After UART MMU test
     } else {
         // Bypass mode - continue with physical addressing
         uart_puts_early("[BOOT] Continuing with physical UART at 0x89000\n");
-        uart_debug_marker('F'); // After bypass mode setup
+        boot_marker('F'); // After bypass mode setup
     }
     
     // Run exception handling tests
     test_exception_handling();
+#if SELFTEST_ENABLE_EXCEPTION_TESTS
+    test_irq_priority_nesting();
+#endif
+    
+#if SELFTEST_ENABLE_SCHEDULER_TESTS
+    test_task_entry_irqs();
+    test_sync_primitives();
+    test_timer_wheel_rearm();
+#endif
+#if SELFTEST_ENABLE_BENCHMARKS
+    // Measure the production context switch path
+    test_context_switch_benchmark();
+    test_timer_wheel_benchmark();
+    test_svc_benchmark();
+    test_pmu_counters();
+#endif
+#if SELFTEST_ENABLE_PROFILE_TESTS
+    test_profile_sampling();
+#endif
+#if SELFTEST_ENABLE_TRACE_TESTS
+    test_tracepoints();
+#endif
+#if SELFTEST_ENABLE_KBENCH
+    run_kbench();
+#endif
+#if SELFTEST_ENABLE_IRQ_LATENCY
+    test_irq_latency();
+#endif
     
     // Continue with initialization using appropriate UART function
     if (memory_result == 0) {
@@ -268,4 +333,23 @@ void kernel_main(unsigned long uart_addr) {
     } else {
         uart_puts_early("\n[BOOT] Continuing kernel initialization...\n");
     }
+    
+    // From here on console output goes through the interrupt-driven TX
+    // ring and overlaps with whatever runs next. Writers with IRQs masked
+    // fall back to polling the FIFO (uart_tx_wait_room()).
+    uart_irq_init();
+    __asm__ volatile("msr daifclr, #2" ::: "memory");
+#if SELFTEST_ENABLE_UART_TESTS
+    test_uart_tx_irq();
+#endif
+    
+    report_boot_time();
+    
+    // Start the tick and hand the CPU to the tasks; does not return. IRQs
+    // stay masked until the first task's schedule_tail(), so no tick can
+    // preempt the boot thread while current_task already names a task.
+    __asm__ volatile("msr daifset, #2" ::: "memory");
+    timer_init();
+    init_tasks();
+    sched_start();
 }
@@ -0,0 +1,116 @@
+/*
+ * bench.c - Shared benchmark helpers
+ *
+ * Sample statistics and the BEGIN header used by every benchmark that
+ * prints machine-readable results, and the cpu_switch_to() ping-pong
+ * fixture behind the context switch benchmarks and the task entry test.
+ */
+
+#include "../include/selftest.h"
+#include "../../../include/scheduler.h"
+#include "../../../include/clocksource.h"
+#include "../../../include/interrupts.h"
+#include "../../../include/pmm.h"
+#include "../../../include/memory_config.h"
+#include "../../../include/uart.h"
+#include "../../../include/printf.h"
+
+/* ========== Statistics ========== */
+
+static void bench_sort(uint64_t* s, int n) {
+    for (int i = 1; i < n; i++) {
+        uint64_t v = s[i];
+        int j = i;
+        while (j > 0 && s[j - 1] > v) {
+            s[j] = s[j - 1];
+            j--;
+        }
+        s[j] = v;
+    }
+}
+
+void bench_summarize(uint64_t* s, int n, struct bench_stats* st) {
+    bench_sort(s, n);
+
+    // Nearest-rank percentiles
+    st->min = s[0];
+    st->median = s[n / 2];
+    st->p99 = s[(n * 99 + 99) / 100 - 1];
+    st->max = s[n - 1];
+}
+
+void bench_begin(const char* tag, int samples) {
+    char buf[96];
+
+    snprintf(buf, sizeof(buf), "%s-BEGIN v1 cntfrq=%llu samples=%d\n",
+             tag, arch_clocksource.freq, samples);
+    uart_puts(buf);
+}
+
+/* ========== Task fixtures ========== */
+
+uint64_t* bench_task_init(task_t* task, void (*entry)(void)) {
+    uint64_t* stack = (uint64_t*)alloc_page();
+
+    if (stack) {
+        task_init_context(task, entry, stack + PAGE_SIZE / sizeof(uint64_t));
+    }
+    return stack;
+}
+
+static task_t pingpong_caller;
+static task_t pingpong_ping;
+static task_t pingpong_pong;
+
+static uint64_t* pingpong_samples;
+static int pingpong_n;
+static int pingpong_batch;
+static int pingpong_entry_irqs;
+
+// Ping times pingpong_batch round trips to pong per sample, then hands
+// back to the caller
+static void pingpong_ping_task(void) {
+    pingpong_entry_irqs = irqs_enabled();
+    local_irq_save();           // schedule_tail() unmasked IRQs
+    for (int i = 0; i < pingpong_n; i++) {
+        uint64_t start = clocksource_read();
+        for (int b = 0; b < pingpong_batch; b++) {
+            cpu_switch_to(&pingpong_ping, &pingpong_pong);
+        }
+        pingpong_samples[i] = clocksource_read() - start;
+    }
+    cpu_switch_to(&pingpong_ping, &pingpong_caller);
+}
+
+static void pingpong_pong_task(void) {
+    local_irq_save();
+    while (1) {
+        cpu_switch_to(&pingpong_pong, &pingpong_ping);
+    }
+}
+
+int bench_pingpong(uint64_t* samples, int n, int batch, int* entry_irqs) {
+    uint64_t* ping_stack = bench_task_init(&pingpong_ping, pingpong_ping_task);
+    uint64_t* pong_stack = bench_task_init(&pingpong_pong, pingpong_pong_task);
+    int ret = -1;
+
+    if (ping_stack && pong_stack) {
+        pingpong_samples = samples;
+        pingpong_n = n;
+        pingpong_batch = batch;
+        pingpong_entry_irqs = 0;
+
+        // Enter ping the way schedule() does, with IRQs masked
+        unsigned long flags = local_irq_save();
+        cpu_switch_to(&pingpong_caller, &pingpong_ping);
+        local_irq_restore(flags);
+
+        if (entry_irqs) {
+            *entry_irqs = pingpong_entry_irqs;
+        }
+        ret = 0;
+    }
+    free_page(ping_stack);
+    free_page(pong_stack);
+    return ret;
+}
@@ -8,6 +8,13 @@
 
 #include "../include/selftest.h"
 #include "../include/console_api.h"
+#include "../../../include/syscall.h"
+#include "../../../include/clocksource.h"
+#include "../../../include/printf.h"
+#include "../../../include/trace.h"
+#include "../../../include/pmm.h"
+#include "../../../include/irq.h"
+#include "../../../include/interrupts.h"
 
 // Platform constants and hardware register definitions
 #ifndef DEBUG_UART
@@ -257,3 +264,191 @@ void test_svc_variants(void) {
     
     debug_print("SVC variant testing complete\n\n");
 }
+
+#define SVC_BENCH_ROUNDS 10000
+
+// Shared with kbench, which times the same loop in small batches
+uint64_t svc_bench_ticks(int calls) {
+    uint64_t start = clocksource_read();
+    
+    for (int i = 0; i < calls; i++) {
+        svc_getpid();
+    }
+    return clocksource_read() - start;
+}
+
+/**
+ * test_svc_benchmark - Round-trip syscall latency
+ * 
+ * Issues SYS_GETPID SVC_BENCH_ROUNDS times through the same
+ * frame/dispatch/eret path EL0 syscalls use (entered from EL1 via
+ * SVC_IMM_KERNEL) and reports nanoseconds and counter cycles per call,
+ * followed by the dispatcher's own per-syscall counters.
+ */
+void test_svc_benchmark(void) {
+    char buf[96];
+    
+    debug_print("\n[SVC] Syscall round-trip benchmark...\n");
+    
+    if (svc_getpid() != sys_getpid()) {
+        debug_print("[SVC] ERROR: SYS_GETPID returned the wrong value\n");
+        return;
+    }
+    
+    uint64_t cycles = svc_bench_ticks(SVC_BENCH_ROUNDS);
+    uint64_t ns = clocksource_cyc2ns(cycles);
+    
+    snprintf(buf, sizeof(buf), "[SVC] %d calls in %llu ns (%llu ns/call, %llu counter ticks/call)\n",
+             SVC_BENCH_ROUNDS, ns, ns / SVC_BENCH_ROUNDS,
+             cycles / SVC_BENCH_ROUNDS);
+    debug_print(buf);
+    
+    struct syscall_stat stat;
+    syscall_get_stats(SYS_GETPID, &stat);
+    snprintf(buf, sizeof(buf), "[SVC] getpid stats: %llu calls, %llu ticks in handler\n",
+             stat.count, stat.cycles);
+    debug_print(buf);
+}
+
+// Self-targeted SGIs for the priority nesting test: one at the default
+// priority, one at the timer's, and a second default-priority peer
+#define NEST_SGI_LOW        2
+#define NEST_SGI_HIGH       3
+#define NEST_SGI_PEER       4
+
+static volatile int nest_low_active;
+static volatile int nest_high_ran, nest_high_nested;
+static volatile int nest_peer_ran, nest_peer_early;
+
+static void nest_high_handler(uint32_t irq, void* data) {
+    (void)irq;
+    (void)data;
+    nest_high_nested = nest_low_active;
+    nest_high_ran = 1;
+}
+
+static void nest_peer_handler(uint32_t irq, void* data) {
+    (void)irq;
+    (void)data;
+    nest_peer_early = nest_low_active;
+    nest_peer_ran = 1;
+}
+
+// Raise both SGIs from inside the low-priority handler and wait (with
+// IRQs unmasked by handle_irq()) for the higher-priority one to nest
+static void nest_low_handler(uint32_t irq, void* data) {
+    uint64_t timeout = arch_clocksource.freq / 100;     // 10 ms
+    (void)irq;
+    (void)data;
+
+    nest_low_active = 1;
+    irq_send_sgi(NEST_SGI_PEER, 1);
+    irq_send_sgi(NEST_SGI_HIGH, 1);
+    uint64_t start = clocksource_read();
+    while (!nest_high_ran && clocksource_read() - start < timeout) {
+    }
+    nest_low_active = 0;
+}
+
+/**
+ * test_irq_priority_nesting - Higher-priority IRQs preempt running handlers
+ * 
+ * A default-priority SGI handler raises an SGI at IRQ_TIMER_PRIORITY and
+ * one at its own priority, then waits. The first must run nested inside
+ * it; the second must wait until the handler has returned.
+ */
+void test_irq_priority_nesting(void) {
+    uint64_t timeout = arch_clocksource.freq / 100;     // 10 ms
+
+    debug_print("\n[IRQ] Priority nesting test...\n");
+
+    nest_low_active = nest_high_ran = nest_high_nested = 0;
+    nest_peer_ran = nest_peer_early = 0;
+
+    unsigned long flags = local_irq_save();
+    if (request_irq(NEST_SGI_LOW, nest_low_handler, NULL) != 0 ||
+        request_irq(NEST_SGI_HIGH, nest_high_handler, NULL) != 0 ||
+        request_irq(NEST_SGI_PEER, nest_peer_handler, NULL) != 0) {
+        debug_print("[IRQ] ERROR: test SGIs already claimed\n");
+        free_irq(NEST_SGI_LOW);
+        free_irq(NEST_SGI_HIGH);
+        free_irq(NEST_SGI_PEER);
+        local_irq_restore(flags);
+        return;
+    }
+    irq_set_priority(NEST_SGI_HIGH, IRQ_TIMER_PRIORITY);
+
+    __asm__ volatile("msr daifclr, #2" ::: "memory");
+    irq_send_sgi(NEST_SGI_LOW, 1);
+    uint64_t start = clocksource_read();
+    while (!nest_peer_ran && clocksource_read() - start < timeout) {
+    }
+    local_irq_restore(flags);
+
+    free_irq(NEST_SGI_LOW);
+    free_irq(NEST_SGI_HIGH);
+    free_irq(NEST_SGI_PEER);
+
+    if (!nest_high_ran || !nest_peer_ran) {
+        debug_print("[IRQ] ERROR: test SGIs not delivered\n");
+    } else if (!nest_high_nested) {
+        debug_print("[IRQ] ERROR: higher-priority SGI did not preempt the handler\n");
+    } else if (nest_peer_early) {
+        debug_print("[IRQ] ERROR: equal-priority SGI preempted the handler\n");
+    } else {
+        debug_print("[IRQ] Higher priority nested, equal priority waited - PASS\n");
+    }
+}
+
+#define TRACE_TEST_CALLS 8
+
+/**
+ * test_tracepoints - Static tracepoint patching and capture
+ * 
+ * Enables the syscall and pmm_alloc tracepoints, issues TRACE_TEST_CALLS
+ * SYS_GETPID calls and one alloc_page(), and checks that exactly those
+ * records were captured. The sites are then patched back to NOPs and the
+ * same calls must record nothing. Finishes with a trace_dump() of the
+ * capture for scripts/trace_to_perfetto.py.
+ */
+void test_tracepoints(void) {
+    char buf[96];
+    
+    debug_print("\n[TRACE] Static tracepoint test...\n");
+    
+    // Start from empty rings; the dump also leaves tracing off
+    trace_enable(0);
+    trace_dump();
+    
+    // Patching may allocate page tables for the text alias, so count
+    // from after the enable
+    trace_enable((1U << TRACE_SYSCALL) | (1U << TRACE_PMM_ALLOC));
+    uint64_t base = trace_buffered();
+    for (int i = 0; i < TRACE_TEST_CALLS; i++) {
+        svc_getpid();
+    }
+    void* page = alloc_page();
+    uint64_t captured = trace_buffered() - base;
+    trace_enable(0);
+    
+    base = trace_buffered();
+    for (int i = 0; i < TRACE_TEST_CALLS; i++) {
+        svc_getpid();
+    }
+    free_page(page);
+    free_page(alloc_page());
+    uint64_t leaked = trace_buffered() - base;
+    
+    uint64_t expected = TRACE_TEST_CALLS + (page ? 1 : 0);
+    snprintf(buf, sizeof(buf), "[TRACE] captured %llu records (expected %llu), %llu while disabled\n",
+             captured, expected, leaked);
+    debug_print(buf);
+    
+    if (captured != expected || leaked) {
+        debug_print("[TRACE] ERROR: tracepoint capture mismatch\n");
+    } else {
+        debug_print("[TRACE] Tracepoint test PASSED\n");
+    }
+    
+    trace_dump();
+}
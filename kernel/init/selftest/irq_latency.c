@@ -0,0 +1,260 @@
+/*
+ * irq_latency.c - Timer IRQ and preemption latency harness
+ *
+ * Every sample fires the CNTV timer PPI and follows it through three
+ * CNTVCT timestamps: exception vector entry (entry.S), irq_handler()
+ * entry, and the first instruction of the task the interrupt preempts
+ * to. Two trigger paths are measured:
+ *
+ *     timer    CNTV_CVAL_EL0 programmed to an exact deadline
+ *     pending  the PPI set pending at the GIC by timer_raise_pending(),
+ *              the force_timer_interrupt() path, like an SGI
+ *
+ * The harness runs from the boot thread before the timer driver or the
+ * scheduler are started, so it claims the timer PPI itself and installs
+ * a two-task run queue while it runs: the boot thread as the interrupted
+ * task and a preempter that the interrupt wakes. The switch goes through
+ * the regular irq_exit() -> schedule() path.
+ *
+ * Each stage is printed as min/median/p99/max in counter ticks plus a
+ * log2 histogram, between IRQLAT-BEGIN and IRQLAT-END.
+ */
+
+#include "../include/selftest.h"
+#include "../../../include/scheduler.h"
+#include "../../../include/clocksource.h"
+#include "../../../include/interrupts.h"
+#include "../../../include/irq.h"
+#include "../../../include/timer.h"
+#include "../../../include/pmm.h"
+#include "../../../include/uart.h"
+#include "../../../include/printf.h"
+
+#define IRQLAT_SAMPLES      2048
+
+// Bucket b holds latencies of bit length b (so [2^(b-1), 2^b) ticks);
+// the last bucket is open-ended
+#define IRQLAT_BUCKETS      20
+
+enum irqlat_stage {
+    IRQLAT_TO_VECTOR,       // Trigger to vector entry
+    IRQLAT_TO_HANDLER,      // Vector entry to irq_handler()
+    IRQLAT_TO_TASK,         // irq_handler() to the preempting task
+    IRQLAT_STAGES
+};
+
+static const char* const irqlat_stage_names[IRQLAT_STAGES] = {
+    "trigger_to_vector",
+    "vector_to_handler",
+    "handler_to_task",
+};
+
+static uint64_t irqlat_samples[IRQLAT_STAGES][IRQLAT_SAMPLES];
+
+// The boot thread while the harness runs, and the task the IRQ wakes
+static task_t irqlat_self;
+static task_t irqlat_preempter;
+
+static struct irq_stamp irqlat_stamp;
+static volatile uint64_t irqlat_task_ts;
+
+/* ========== Reporting ========== */
+
+static void irqlat_report(const char* path, const char* stage, uint64_t* s, int n) {
+    uint32_t hist[IRQLAT_BUCKETS] = {0};
+    struct bench_stats st;
+    char buf[128];
+
+    for (int i = 0; i < n; i++) {
+        int b = s[i] ? 64 - __builtin_clzll(s[i]) : 0;
+        hist[b < IRQLAT_BUCKETS ? b : IRQLAT_BUCKETS - 1]++;
+    }
+    bench_summarize(s, n, &st);
+
+    snprintf(buf, sizeof(buf), "IRQLAT %s.%s min %llu p50 %llu p99 %llu max %llu ticks\n",
+             path, stage, st.min, st.median, st.p99, st.max);
+    uart_puts(buf);
+
+    for (int b = 0; b < IRQLAT_BUCKETS; b++) {
+        if (!hist[b]) continue;
+        uint32_t lo = b ? 1U << (b - 1) : 0;
+        if (b == IRQLAT_BUCKETS - 1) {
+            snprintf(buf, sizeof(buf), "IRQLAT-HIST %s.%s %u+ %u\n",
+                     path, stage, lo, hist[b]);
+        } else {
+            snprintf(buf, sizeof(buf), "IRQLAT-HIST %s.%s %u-%u %u\n",
+                     path, stage, lo, b ? (1U << b) - 1 : 0, hist[b]);
+        }
+        uart_puts(buf);
+    }
+}
+
+/* ========== Interrupt and preempting task ========== */
+
+static inline void irqlat_cntv_disable(void) {
+    __asm__ volatile("msr cntv_ctl_el0, xzr\n"
+                     "isb" ::: "memory");
+}
+
+// The timer output is level-triggered: drop it before EOI, then wake
+// the preempter so irq_exit() switches to it
+static void irqlat_irq(uint32_t irq, void* data) {
+    (void)irq;
+    (void)data;
+    irqlat_cntv_disable();
+    irqlat_stamp = *irq_last_stamp();
+    wake_up_task(&irqlat_preempter);
+}
+
+// Resumes straight out of schedule(); the first thing it does is stamp
+static void irqlat_preempt_task(void) {
+    while (1) {
+        irqlat_task_ts = clocksource_read();
+        irqlat_preempter.state = TASK_BLOCKED;
+        schedule();
+    }
+}
+
+/* ========== Sampling ========== */
+
+enum irqlat_path {
+    IRQLAT_PATH_TIMER,
+    IRQLAT_PATH_PENDING,
+};
+
+static inline uint64_t irqlat_delta(uint64_t from, uint64_t to) {
+    return to > from ? to - from : 0;
+}
+
+// Trigger one interrupt and wait for the preempter to stamp it. Runs with
+// IRQs unmasked. Returns -1 if nothing arrived within the timeout.
+static int irqlat_sample(enum irqlat_path path, int i) {
+    uint64_t lead = arch_clocksource.freq / 20000;      // 50 us
+    uint64_t timeout = arch_clocksource.freq / 100;     // 10 ms
+    uint64_t trigger;
+
+    irqlat_task_ts = 0;
+
+    if (path == IRQLAT_PATH_TIMER) {
+        // Step the lead so deadlines do not phase-lock with this loop
+        uint64_t cval = timer_read_counter() + lead + (i & 15);
+
+        __asm__ volatile("msr cntv_cval_el0, %0\n"
+                         "msr cntv_ctl_el0, %1\n"
+                         "isb" :: "r"(cval), "r"(1UL) : "memory");
+        trigger = cval;
+    } else {
+        trigger = clocksource_read();
+        timer_raise_pending();
+    }
+
+    uint64_t start = clocksource_read();
+    while (!irqlat_task_ts && clocksource_read() - start < timeout) {
+    }
+    if (!irqlat_task_ts) {
+        return -1;
+    }
+
+    irqlat_samples[IRQLAT_TO_VECTOR][i] = irqlat_delta(trigger, irqlat_stamp.vector);
+    irqlat_samples[IRQLAT_TO_HANDLER][i] = irqlat_delta(irqlat_stamp.vector, irqlat_stamp.handler);
+    irqlat_samples[IRQLAT_TO_TASK][i] = irqlat_delta(irqlat_stamp.handler, irqlat_task_ts);
+    return 0;
+}
+
+// Prefix of SKIP lines, and the sample count and sink of the current run
+static const char* irqlat_tag;
+static int irqlat_nr;
+static irqlat_report_t irqlat_sink;
+
+static void irqlat_skip(const char* what, const char* why) {
+    char buf[80];
+
+    snprintf(buf, sizeof(buf), "%s-SKIP %s (%s)\n", irqlat_tag, what, why);
+    uart_puts(buf);
+}
+
+static void irqlat_run(enum irqlat_path path, const char* name) {
+    int n;
+
+    for (n = 0; n < irqlat_nr; n++) {
+        if (irqlat_sample(path, n) != 0) break;
+    }
+    if (n < irqlat_nr) {
+        irqlat_skip(name, "IRQ not delivered");
+        return;
+    }
+
+    for (int stage = 0; stage < IRQLAT_STAGES; stage++) {
+        irqlat_sink(name, irqlat_stage_names[stage], irqlat_samples[stage], n);
+    }
+}
+
+// Claim the timer PPI, install the run queue and measure both paths
+static void irqlat_measure(void) {
+    if (current_task || pick_next_task()) {
+        irqlat_skip("all", "scheduler running");
+        return;
+    }
+
+    uint64_t* stack = bench_task_init(&irqlat_preempter, irqlat_preempt_task);
+    if (!stack) {
+        irqlat_skip("all", "no stack page");
+        return;
+    }
+    if (request_irq(TIMER_IRQ_ID, irqlat_irq, NULL) != 0) {
+        irqlat_skip("all", "timer IRQ busy");
+        free_page(stack);
+        return;
+    }
+    irq_set_priority(TIMER_IRQ_ID, IRQ_TIMER_PRIORITY);
+
+    irqlat_cntv_disable();
+
+    // Two-task run queue: the boot thread (running) and the preempter
+    // (blocked until the interrupt wakes it)
+    unsigned long flags = local_irq_save();
+    irqlat_self.id = 0;
+    irqlat_self.state = TASK_RUNNING;
+    irqlat_preempter.id = 1;
+    irqlat_preempter.state = TASK_BLOCKED;
+    enqueue_task(&irqlat_self);
+    current_task = &irqlat_self;
+    __asm__ volatile("msr daifclr, #2" ::: "memory");
+
+    irqlat_run(IRQLAT_PATH_TIMER, "timer");
+    irqlat_run(IRQLAT_PATH_PENDING, "pending");
+
+    // Back to a bare boot thread. A leftover reschedule request would
+    // send the next interrupt exit into the idle task.
+    __asm__ volatile("msr daifset, #2" ::: "memory");
+    irqlat_cntv_disable();
+    dequeue_task(&irqlat_preempter);
+    dequeue_task(&irqlat_self);
+    current_task = NULL;
+    need_resched = 0;
+    local_irq_restore(flags);
+
+    free_irq(TIMER_IRQ_ID);
+    free_page(stack);
+}
+
+void irq_latency_run(const char* tag, int samples, irqlat_report_t report) {
+    irqlat_tag = tag;
+    irqlat_nr = samples < IRQLAT_SAMPLES ? samples : IRQLAT_SAMPLES;
+    irqlat_sink = report;
+    irqlat_measure();
+}
+
+/**
+ * test_irq_latency - Timer IRQ, handler and preemption latency histograms
+ *
+ * Measures IRQLAT_SAMPLES interrupts on each path (CNTV deadline and GIC
+ * pending bit) and prints trigger-to-vector, vector-to-irq_handler() and
+ * irq_handler()-to-task latencies in CNTVCT ticks. Must run from the boot
+ * thread before the scheduler and the timer driver are started.
+ */
+void test_irq_latency(void) {
+    bench_begin("IRQLAT", IRQLAT_SAMPLES);
+    irq_latency_run("IRQLAT", IRQLAT_SAMPLES, irqlat_report);
+    uart_puts("IRQLAT-END\n");
+}
@@ -0,0 +1,170 @@
+/*
+ * kbench.c - Kernel microbenchmark suite
+ * 
+ * Every benchmark collects KBENCH_SAMPLES timings with CNTVCT_EL0 and
+ * reports min, median and p99 per operation as
+ * 
+ *     BENCH <name>.<stat> <value> <unit>
+ * 
+ * one result per line, printed with uart_puts() so PROFILE=release builds
+ * keep them. Operations shorter than a counter tick are timed in batches
+ * and divided down, hence the two decimals. scripts/kbench.sh collects
+ * the lines and compares them against a stored baseline.
+ */
+
+#include "../include/selftest.h"
+#include "../../../include/clocksource.h"
+#include "../../../include/pmm.h"
+#include "../../../include/memory_config.h"
+#include "../../../include/string.h"
+#include "../../../include/uart.h"
+#include "../../../include/printf.h"
+
+#define KBENCH_SAMPLES      256
+
+// Scratch kernel VA for map/unmap, below the text-patching alias
+#define KBENCH_MAP_VA       0x0000007FFFFFA000UL
+
+#define KBENCH_UART_BYTES   64
+
+static uint64_t kbench_samples[KBENCH_SAMPLES];
+
+/* ========== Reporting ========== */
+
+static void kbench_line(const char* name, const char* stat, uint64_t value, uint32_t div) {
+    char buf[96];
+    uint64_t hundredths = (value * 100 + div / 2) / div;
+
+    snprintf(buf, sizeof(buf), "BENCH %s.%s %llu.%02llu cycles\n",
+             name, stat, hundredths / 100, hundredths % 100);
+    uart_puts(buf);
+}
+
+// Sort the samples and print min/median/p99, each divided by ops per sample
+static uint64_t kbench_report(const char* name, uint64_t* s, int n, uint32_t ops) {
+    struct bench_stats st;
+
+    bench_summarize(s, n, &st);
+    kbench_line(name, "min", st.min, ops);
+    kbench_line(name, "median", st.median, ops);
+    kbench_line(name, "p99", st.p99, ops);
+    return st.median;
+}
+
+// Time batch calls of op per sample
+static uint64_t kbench_run(const char* name, void (*op)(void), uint32_t batch) {
+    for (int i = 0; i < KBENCH_SAMPLES; i++) {
+        uint64_t start = clocksource_read();
+        for (uint32_t b = 0; b < batch; b++) {
+            op();
+        }
+        kbench_samples[i] = clocksource_read() - start;
+    }
+    return kbench_report(name, kbench_samples, KBENCH_SAMPLES, batch);
+}
+
+/* ========== Memory ========== */
+
+static void* kbench_src;
+static void* kbench_dst;
+static uint64_t kbench_map_pa;
+
+static void op_alloc_free(void) {
+    free_page(alloc_page());
+}
+
+static void op_map_unmap(void) {
+    map_kernel_page(KBENCH_MAP_VA, kbench_map_pa, PTE_KERN_DATA);
+    unmap_kernel_page(KBENCH_MAP_VA);
+}
+
+static void op_memcpy_4k(void) {
+    memcpy(kbench_dst, kbench_src, PAGE_SIZE);
+}
+
+/* ========== Syscall ========== */
+
+#define KBENCH_SVC_BATCH    8
+
+// Same SYS_GETPID loop as test_svc_benchmark(), in short batches
+static void kbench_svc(void) {
+    for (int i = 0; i < KBENCH_SAMPLES; i++) {
+        kbench_samples[i] = svc_bench_ticks(KBENCH_SVC_BATCH);
+    }
+    kbench_report("svc_getpid", kbench_samples, KBENCH_SAMPLES, KBENCH_SVC_BATCH);
+}
+
+/* ========== UART ========== */
+
+// Blanks and a carriage return: measurable, but leaves the log readable
+static char kbench_uart_line[KBENCH_UART_BYTES];
+
+static void op_uart_write(void) {
+    uart_write(kbench_uart_line, KBENCH_UART_BYTES);
+}
+
+/* ========== Context switch ========== */
+
+#define KBENCH_CTXSW_BATCH  16
+
+static void kbench_ctxsw(void) {
+    if (bench_pingpong(kbench_samples, KBENCH_SAMPLES, KBENCH_CTXSW_BATCH, NULL) != 0) {
+        uart_puts("BENCH-SKIP ctxsw (no stack pages)\n");
+        return;
+    }
+    kbench_report("ctxsw", kbench_samples, KBENCH_SAMPLES, 2 * KBENCH_CTXSW_BATCH);
+}
+
+/* ========== IRQ latency ========== */
+
+// One BENCH name per trigger path and stage of the IRQLAT harness,
+// e.g. irq_pending.vector_to_handler
+static void kbench_irq_report(const char* path, const char* stage, uint64_t* s, int n) {
+    char name[48];
+
+    snprintf(name, sizeof(name), "irq_%s.%s", path, stage);
+    kbench_report(name, s, n, 1);
+}
+
+/**
+ * run_kbench - Run every microbenchmark and print BENCH lines
+ * 
+ * Covers page alloc/free, kernel map/unmap, cpu_switch_to() ping-pong,
+ * the SVC round trip, the timer IRQ and preemption latency stages of
+ * test_irq_latency(), a 4 KiB memcpy and polled UART writes. Results are
+ * CNTVCT cycles per operation; the counter frequency is printed first so
+ * they can be converted.
+ */
+void run_kbench(void) {
+    char buf[96];
+
+    bench_begin("BENCH", KBENCH_SAMPLES);
+
+    kbench_run("alloc_free", op_alloc_free, 1);
+
+    kbench_map_pa = (uint64_t)alloc_page();
+    kbench_src = alloc_page();
+    kbench_dst = alloc_page();
+    if (kbench_map_pa && kbench_src && kbench_dst) {
+        kbench_run("map_unmap", op_map_unmap, 1);
+        kbench_run("memcpy_4k", op_memcpy_4k, 4);
+    }
+    free_page((void*)kbench_map_pa);
+    free_page(kbench_src);
+    free_page(kbench_dst);
+
+    kbench_ctxsw();
+    kbench_svc();
+    irq_latency_run("BENCH", KBENCH_SAMPLES, kbench_irq_report);
+
+    memset(kbench_uart_line, ' ', KBENCH_UART_BYTES - 1);
+    kbench_uart_line[KBENCH_UART_BYTES - 1] = '\r';
+    uint64_t median = kbench_run("uart_write_64", op_uart_write, 1);
+    if (median) {
+        snprintf(buf, sizeof(buf), "BENCH uart_write_64.throughput %llu bytes/s\n",
+                 KBENCH_UART_BYTES * arch_clocksource.freq / median);
+        uart_puts(buf);
+    }
+
+    uart_puts("BENCH-END\n");
+}
@@ -0,0 +1,164 @@
+/*
+ * perf_tests.c - PMU counter, perf region and profiler tests
+ * 
+ * Checks that the PMU counts what it should on a loop with a known
+ * instruction count and prints the region/task report accumulated since
+ * boot (alloc_page, map_range, context_switch). Also checks that the
+ * sampling profiler attributes its samples to a known busy loop.
+ */
+
+#include "../include/selftest.h"
+#include "../include/console_api.h"
+#include "../../../include/pmu.h"
+#include "../../../include/perf.h"
+#include "../../../include/printf.h"
+#include "../../../include/profile.h"
+#include "../../../include/timer.h"
+#include "../../../include/clocksource.h"
+#include "../../../include/irq.h"
+#include "../../../include/interrupts.h"
+
+#define PMU_TEST_ITERATIONS 10000
+
+// Two instructions per iteration (subs + b.ne)
+static void __attribute__((noinline)) pmu_test_loop(uint64_t n) {
+    __asm__ volatile("1: subs %0, %0, #1\n"
+                     "   b.ne 1b"
+                     : "+r"(n) :: "cc");
+}
+
+/**
+ * test_pmu_counters - Validate PMU counting and print the perf report
+ * 
+ * Runs PMU_TEST_ITERATIONS iterations of a two-instruction loop inside a
+ * perf region and checks that INST_RETIRED saw at least that many
+ * instructions (plus the region's own overhead) and that the cycle
+ * counter advanced. Skipped when the CPU has no PMUv3.
+ */
+void test_pmu_counters(void) {
+    static PERF_REGION(loop_region, "selftest_loop");
+    struct pmu_sample start;
+    char buf[128];
+    
+    debug_print("\n[PMU] Counter test...\n");
+    
+    if (pmu_init() != 0) {
+        debug_print("[PMU] No PMUv3, skipped\n");
+        return;
+    }
+    
+    perf_region_begin(&start);
+    pmu_test_loop(PMU_TEST_ITERATIONS);
+    perf_region_end(&loop_region, &start);
+    
+    uint64_t insns = loop_region.total[PMU_INSTRUCTIONS] / loop_region.calls;
+    uint64_t cycles = loop_region.total[PMU_CYCLES] / loop_region.calls;
+    
+    snprintf(buf, sizeof(buf), "[PMU] %d-iteration loop: %llu instructions, %llu cycles\n",
+             PMU_TEST_ITERATIONS, insns, cycles);
+    debug_print(buf);
+    
+    bool ok = cycles > 0;
+    if (pmu_counter_supported(PMU_INSTRUCTIONS)) {
+        ok = ok && insns >= 2 * PMU_TEST_ITERATIONS && insns < 2 * PMU_TEST_ITERATIONS + 1000;
+    } else {
+        debug_print("[PMU] INST_RETIRED not implemented, instruction check skipped\n");
+    }
+    debug_print(ok ? "[PMU] Counter test PASSED\n" : "[PMU] ERROR: unexpected counts\n");
+    
+    perf_report();
+}
+
+/* ========== Sampling profiler ========== */
+
+#define PROFILE_TEST_HZ     1000
+#define PROFILE_TEST_MS     100
+
+// Bracket the busy loop's instructions (defined in profile_test_loop())
+extern const char profile_test_loop_start[];
+extern const char profile_test_loop_end[];
+
+static uint64_t profile_test_ticks;
+
+// Spin on CNTVCT until the deadline. The global labels mark exactly which
+// PCs belong to the loop.
+static void __attribute__((noinline)) profile_test_loop(uint64_t deadline) {
+    uint64_t now;
+    
+    __asm__ volatile(".global profile_test_loop_start\n"
+                     "profile_test_loop_start:\n"
+                     "1: mrs %0, cntvct_el0\n"
+                     "   cmp %0, %1\n"
+                     "   b.lo 1b\n"
+                     ".global profile_test_loop_end\n"
+                     "profile_test_loop_end:\n"
+                     : "=&r"(now) : "r"(deadline) : "cc", "memory");
+}
+
+// Stands in for the timer driver, which is not running yet: feed the
+// profiler's timer source and re-arm the comparator one period ahead
+static void profile_test_irq(uint32_t irq, void* data) {
+    (void)irq;
+    (void)data;
+    uint64_t now = clocksource_read();
+    
+    profile_timer_tick(now);
+    __asm__ volatile("msr cntv_cval_el0, %0\n"
+                     "isb" :: "r"(now + profile_test_ticks) : "memory");
+}
+
+/**
+ * test_profile_sampling - Profiler samples land in a known busy loop
+ * 
+ * Samples the boot thread at PROFILE_TEST_HZ with backtraces on while it
+ * spins in profile_test_loop() for PROFILE_TEST_MS, and checks that at
+ * least 90% of the samples have their PC inside the loop. Needs the timer
+ * PPI, so it runs before timer_init().
+ */
+void test_profile_sampling(void) {
+    char buf[96];
+    
+    debug_print("\n[PROFILE] Sampling a known busy loop...\n");
+    
+    if (request_irq(TIMER_IRQ_ID, profile_test_irq, NULL) != 0) {
+        debug_print("[PROFILE] Timer IRQ busy, skipped\n");
+        return;
+    }
+    irq_set_priority(TIMER_IRQ_ID, IRQ_TIMER_PRIORITY);
+    profile_test_ticks = timer_get_frequency() / PROFILE_TEST_HZ;
+    
+    profile_clear();
+    profile_start(PROFILE_SRC_TIMER, PROFILE_TEST_HZ, PROFILE_BACKTRACE);
+    
+    unsigned long flags = local_irq_save();
+    __asm__ volatile("msr cntv_cval_el0, %0\n"
+                     "msr cntv_ctl_el0, %1\n"
+                     "isb" :: "r"(clocksource_read() + profile_test_ticks), "r"(1UL) : "memory");
+    __asm__ volatile("msr daifclr, #2" ::: "memory");
+    profile_test_loop(clocksource_read() + clocksource_ns2cyc(PROFILE_TEST_MS * NSEC_PER_MSEC));
+    __asm__ volatile("msr daifset, #2" ::: "memory");
+    __asm__ volatile("msr cntv_ctl_el0, xzr\n"
+                     "isb" ::: "memory");
+    local_irq_restore(flags);
+    
+    profile_stop();
+    free_irq(TIMER_IRQ_ID);
+    
+    uint64_t n, in_loop = 0;
+    const struct profile_sample* samples = profile_samples(&n);
+    for (uint64_t i = 0; i < n; i++) {
+        if (samples[i].pc >= (uint64_t)profile_test_loop_start &&
+            samples[i].pc <= (uint64_t)profile_test_loop_end) {
+            in_loop++;
+        }
+    }
+    profile_clear();
+    
+    snprintf(buf, sizeof(buf), "[PROFILE] %llu samples, %llu in the busy loop\n", n, in_loop);
+    debug_print(buf);
+    if (n > 0 && in_loop * 10 >= n * 9) {
+        debug_print("[PROFILE] Sampling test PASSED\n");
+    } else {
+        debug_print("[PROFILE] ERROR: samples do not land in the busy loop\n");
+    }
+}
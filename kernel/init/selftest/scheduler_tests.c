@@ -9,6 +9,14 @@
 #include "../include/selftest.h"
 #include "../include/console_api.h"
 #include "../include/sample_tasks.h"
+#include "../../../include/scheduler.h"
+#include "../../../include/interrupts.h"
+#include "../../../include/pmm.h"
+#include "../../../include/timer.h"
+#include "../../../include/clocksource.h"
+#include "../../../include/printf.h"
+#include "../../../include/mutex.h"
+#include "../../../include/semaphore.h"
 
 // Platform constants
 #ifndef DEBUG_UART
@@ -121,7 +129,6 @@ void start_scheduler(void) {
     uart_puts("[DEBUG] Checking dummy_asm address mapping\n");
     uint64_t dummy_addr = (uint64_t)dummy_asm;
     char buf[128];
-    extern int snprintf(char* buffer, size_t count, const char* format, ...);
     snprintf(buf, sizeof(buf), "[DEBUG] dummy_asm @ 0x%lx\n", dummy_addr);
     uart_puts(buf);
 
@@ -348,3 +355,414 @@ void test_scheduler_integration(void) {
     
     debug_print("[SCHED] Scheduler integration tests complete\n\n");
 }
+
+/* ========== Context Switch Benchmark ========== */
+
+// Number of ping->pong->ping round trips measured
+#define CTXSW_BENCH_ROUNDS 10000
+
+/**
+ * test_context_switch_benchmark - Ping-pong yield benchmark for cpu_switch_to
+ * 
+ * Runs two kernel tasks that yield to each other through cpu_switch_to()
+ * with IRQs masked and reports the cost per switch in nanoseconds together
+ * with the resulting switches per second.
+ */
+void test_context_switch_benchmark(void) {
+    char buf[96];
+    uint64_t ticks;
+    
+    debug_print("\n[SCHED] Context switch ping-pong benchmark...\n");
+    
+    if (bench_pingpong(&ticks, 1, CTXSW_BENCH_ROUNDS, NULL) != 0) {
+        debug_print("[SCHED] ERROR: benchmark stack allocation failed\n");
+        return;
+    }
+    
+    uint64_t ns = clocksource_cyc2ns(ticks);
+    uint64_t switches = 2 * (uint64_t)CTXSW_BENCH_ROUNDS;
+    if (ns == 0) ns = 1;
+    
+    snprintf(buf, sizeof(buf), "[SCHED] %llu switches in %llu ns (%llu ns/switch)\n",
+             switches, ns, ns / switches);
+    debug_print(buf);
+    snprintf(buf, sizeof(buf), "[SCHED] %llu switches/sec\n",
+             switches * NSEC_PER_SEC / ns);
+    debug_print(buf);
+}
+
+/* ========== New Task Entry ========== */
+
+/**
+ * test_task_entry_irqs - IRQs are unmasked when a new task starts
+ * 
+ * Switches into a fresh task with IRQs masked, as schedule() and the IRQ
+ * exit path do, and checks that DAIF.I is clear by the time the task
+ * body runs (schedule_tail() in cpu_task_entry).
+ */
+void test_task_entry_irqs(void) {
+    uint64_t ticks;
+    int entry_irqs_on;
+    
+    if (bench_pingpong(&ticks, 1, 0, &entry_irqs_on) != 0) {
+        debug_print("[SCHED] ERROR: task entry test stack allocation failed\n");
+        return;
+    }
+    
+    if (entry_irqs_on) {
+        debug_print("[SCHED] New task entry: IRQs unmasked - PASS\n");
+    } else {
+        debug_print("[SCHED] ERROR: new task entered with IRQs masked\n");
+    }
+}
+
+/* ========== Mutex, Semaphore and Condvar ========== */
+
+// Run queue for the blocking primitive tests: the boot thread runs as
+// sync_self and the workers are real tasks that sleep and wake through
+// schedule(), exactly as scheduled tasks do after boot
+#define SYNC_WORKERS 3
+
+static task_t sync_self;
+static task_t sync_workers[SYNC_WORKERS];
+static uint64_t* sync_stacks[SYNC_WORKERS];
+static volatile int sync_done;
+
+static DEFINE_MUTEX(sync_mutex);
+static struct semaphore sync_sem;
+static DEFINE_MUTEX(sync_cv_lock);
+static struct condvar sync_cv = CONDVAR_INIT;
+
+static volatile int sync_order[SYNC_WORKERS];
+static volatile int sync_count;
+static volatile int sync_handoffs;
+static volatile int sync_inside;
+static volatile int sync_max_inside;
+static volatile int sync_tokens;
+
+static inline int sync_worker_id(void) {
+    return (int)(current_task - sync_workers);
+}
+
+// Workers end here: count themselves done and block for good
+static void sync_exit(void) {
+    local_irq_save();
+    sync_done++;
+    current_task->state = TASK_BLOCKED;
+    schedule();
+    while (1) {
+    }
+}
+
+static int sync_start(void (*entry)(void)) {
+    if (current_task || pick_next_task()) {
+        debug_print("[SYNC] SKIP: scheduler already running\n");
+        return -1;
+    }
+    for (int i = 0; i < SYNC_WORKERS; i++) {
+        sync_stacks[i] = (uint64_t*)alloc_page();
+        if (!sync_stacks[i]) {
+            debug_print("[SYNC] ERROR: worker stack allocation failed\n");
+            while (i--) free_page(sync_stacks[i]);
+            return -1;
+        }
+    }
+    
+    unsigned long flags = local_irq_save();
+    sync_done = 0;
+    sync_self.id = 0;
+    sync_self.state = TASK_RUNNING;
+    enqueue_task(&sync_self);
+    for (int i = 0; i < SYNC_WORKERS; i++) {
+        task_init_context(&sync_workers[i], entry, sync_stacks[i] + 4096 / sizeof(uint64_t));
+        sync_workers[i].id = i + 1;
+        sync_workers[i].state = TASK_READY;
+        enqueue_task(&sync_workers[i]);
+    }
+    current_task = &sync_self;
+    local_irq_restore(flags);
+    return 0;
+}
+
+// Let the workers run until `n` of them are done (or 100 ms pass)
+static void sync_wait_done(int n) {
+    uint64_t start = ktime_get_ns();
+    
+    while (sync_done < n && ktime_get_ns() - start < 100 * NSEC_PER_MSEC) {
+        yield();
+    }
+}
+
+static void sync_stop(void) {
+    unsigned long flags = local_irq_save();
+    for (int i = 0; i < SYNC_WORKERS; i++) {
+        dequeue_task(&sync_workers[i]);
+    }
+    dequeue_task(&sync_self);
+    current_task = NULL;
+    need_resched = 0;
+    local_irq_restore(flags);
+    
+    for (int i = 0; i < SYNC_WORKERS; i++) {
+        free_page(sync_stacks[i]);
+    }
+}
+
+static int sync_waiters(struct wait_queue_head* wq) {
+    int n = 0;
+    
+    for (struct wait_queue_entry* w = wq->first; w; w = w->next) n++;
+    return n;
+}
+
+static void sync_report(const char* what, int ok) {
+    debug_print("[SYNC] ");
+    debug_print(what);
+    debug_print(ok ? " - PASS\n" : " - FAIL\n");
+}
+
+// Queue up on the held mutex; on wakeup the lock must already be ours
+static void sync_mutex_worker(void) {
+    mutex_lock(&sync_mutex);
+    if (sync_mutex.owner == current_task) sync_handoffs++;
+    sync_order[sync_count++] = sync_worker_id();
+    mutex_unlock(&sync_mutex);
+    sync_exit();
+}
+
+static void test_mutex_contention(void) {
+    sync_count = 0;
+    sync_handoffs = 0;
+    if (sync_start(sync_mutex_worker) != 0) return;
+    
+    // One pass through the run queue: every worker blocks on the lock
+    mutex_lock(&sync_mutex);
+    yield();
+    int queued = sync_waiters(&sync_mutex.wait);
+    
+    // Unlock hands the mutex to the first waiter; it is never free
+    mutex_unlock(&sync_mutex);
+    int handed = sync_mutex.owner == &sync_workers[0] && !mutex_trylock(&sync_mutex);
+    
+    sync_wait_done(SYNC_WORKERS);
+    int fifo = sync_count == SYNC_WORKERS;
+    for (int i = 0; fifo && i < SYNC_WORKERS; i++) {
+        fifo = sync_order[i] == i;
+    }
+    sync_stop();
+    
+    sync_report("Mutex: contenders sleep on the wait queue", queued == SYNC_WORKERS);
+    sync_report("Mutex: unlock hands off to the first waiter",
+                handed && sync_handoffs == SYNC_WORKERS);
+    sync_report("Mutex: waiters served in FIFO order", fifo && !mutex_is_locked(&sync_mutex));
+}
+
+// Hold one of the semaphore's units across a yield
+static void sync_sem_worker(void) {
+    down(&sync_sem);
+    int inside = ++sync_inside;
+    if (inside > sync_max_inside) sync_max_inside = inside;
+    yield();
+    sync_inside--;
+    up(&sync_sem);
+    sync_exit();
+}
+
+static void test_semaphore_counting(void) {
+    sema_init(&sync_sem, SYNC_WORKERS - 1);
+    sync_inside = 0;
+    sync_max_inside = 0;
+    if (sync_start(sync_sem_worker) != 0) return;
+    
+    // Two workers hold a unit each, the third sleeps in down()
+    yield();
+    int full = sync_sem.count == 0 && !down_trylock(&sync_sem) &&
+               sync_waiters(&sync_sem.wait) == 1;
+    
+    sync_wait_done(SYNC_WORKERS);
+    int done = sync_done == SYNC_WORKERS;
+    sync_stop();
+    
+    sync_report("Semaphore: down() sleeps once the count is used up", full);
+    sync_report("Semaphore: holders never exceed the count",
+                done && sync_max_inside == SYNC_WORKERS - 1);
+    sync_report("Semaphore: all units returned", sync_sem.count == SYNC_WORKERS - 1);
+}
+
+// Consume one token, waiting on the condvar until there is one
+static void sync_cv_worker(void) {
+    mutex_lock(&sync_cv_lock);
+    while (!sync_tokens) {
+        condvar_wait(&sync_cv, &sync_cv_lock);
+    }
+    sync_tokens--;
+    sync_count++;
+    mutex_unlock(&sync_cv_lock);
+    sync_exit();
+}
+
+static void sync_cv_post(int tokens, int all) {
+    mutex_lock(&sync_cv_lock);
+    sync_tokens += tokens;
+    if (all) {
+        condvar_broadcast(&sync_cv);
+    } else {
+        condvar_signal(&sync_cv);
+    }
+    mutex_unlock(&sync_cv_lock);
+}
+
+static void test_condvar_signal_broadcast(void) {
+    sync_tokens = 0;
+    sync_count = 0;
+    if (sync_start(sync_cv_worker) != 0) return;
+    
+    yield();
+    int waiting = sync_waiters(&sync_cv.wait) == SYNC_WORKERS;
+    
+    // signal wakes exactly one; the others must stay asleep
+    sync_cv_post(1, 0);
+    sync_wait_done(1);
+    for (int i = 0; i < SYNC_WORKERS; i++) yield();
+    int one = sync_count == 1 && sync_waiters(&sync_cv.wait) == SYNC_WORKERS - 1;
+    
+    // broadcast wakes everyone left
+    sync_cv_post(SYNC_WORKERS - 1, 1);
+    sync_wait_done(SYNC_WORKERS);
+    int all = sync_count == SYNC_WORKERS && sync_waiters(&sync_cv.wait) == 0;
+    sync_stop();
+    
+    sync_report("Condvar: waiters sleep until posted", waiting);
+    sync_report("Condvar: signal wakes one waiter", one);
+    sync_report("Condvar: broadcast wakes all waiters", all);
+}
+
+/**
+ * test_sync_primitives - Mutex, semaphore and condvar under contention
+ * 
+ * Runs three worker tasks against each primitive on a private run queue
+ * with the boot thread as the first task. Checks mutex handoff to the
+ * first waiter and FIFO order, that a semaphore never admits more
+ * holders than its count, and that condvar_signal() wakes one waiter
+ * while condvar_broadcast() wakes them all.
+ */
+void test_sync_primitives(void) {
+    debug_print("\n[SYNC] Blocking primitive tests...\n");
+    test_mutex_contention();
+    test_semaphore_counting();
+    test_condvar_signal_broadcast();
+}
+
+#define TWHEEL_BENCH_TIMERS TIMER_POOL_SIZE
+
+static ktimer_t* twheel_handles[TWHEEL_BENCH_TIMERS];
+
+static void twheel_bench_fn(void* arg) {
+    (void)arg;
+}
+
+/**
+ * test_timer_wheel_benchmark - Timer wheel insert/cancel cost
+ * 
+ * Arms TIMER_POOL_SIZE pooled timers with deadlines spread from
+ * microseconds to seconds ahead, then cancels them all, reporting the
+ * average nanoseconds per operation. Both should stay flat as the
+ * number of pending timers grows.
+ */
+void test_timer_wheel_benchmark(void) {
+    char buf[96];
+    
+    debug_print("\n[TIMER] Timer wheel insert/cancel benchmark...\n");
+    
+    uint64_t base = timer_read_counter() + timer_us_to_ticks(1000000);
+    uint64_t start, mid, end;
+    int armed = 0, cancelled = 0;
+    
+    start = ktime_get_ns();
+    for (int i = 0; i < TWHEEL_BENCH_TIMERS; i++) {
+        // Spread deadlines over every wheel level
+        uint64_t delta = ((uint64_t)i * 2654435761ULL) & ((1ULL << (6 + (i % 24))) - 1);
+        twheel_handles[i] = timer_add(base + delta, twheel_bench_fn, NULL);
+        if (twheel_handles[i]) armed++;
+    }
+    mid = ktime_get_ns();
+    for (int i = 0; i < TWHEEL_BENCH_TIMERS; i++) {
+        if (twheel_handles[i]) cancelled += timer_cancel(twheel_handles[i]);
+    }
+    end = ktime_get_ns();
+    
+    if (armed == 0) armed = 1;
+    snprintf(buf, sizeof(buf), "[TIMER] %d timers: add %llu ns/op, cancel %llu ns/op\n",
+             armed, (mid - start) / armed, (end - mid) / armed);
+    debug_print(buf);
+    if (cancelled != armed) {
+        debug_print("[TIMER] ERROR: not every armed timer was still pending\n");
+    }
+}
+
+/* ========== Timer Wheel Re-arm ========== */
+
+#define TWHEEL_REARM_TIMERS 8
+
+static ktimer_t twheel_rearm[TWHEEL_REARM_TIMERS];
+static int twheel_rearm_fired;
+static int twheel_rearm_early;
+
+// Even timers cancel their odd neighbour, still pending in the same
+// expiry batch, and re-arm it 1 ms later
+static void twheel_rearm_fn(void* arg) {
+    ktimer_t* self = (ktimer_t*)arg;
+    uint64_t now = timer_read_counter();
+    int i = (int)(self - twheel_rearm);
+    
+    twheel_rearm_fired++;
+    if (now < self->expires) twheel_rearm_early++;
+    
+    if (!(i & 1) && i + 1 < TWHEEL_REARM_TIMERS) {
+        ktimer_t* next = &twheel_rearm[i + 1];
+        if (timer_cancel(next)) {
+            timer_start(next, now + timer_us_to_ticks(1000), twheel_rearm_fn, next);
+        }
+    }
+}
+
+/**
+ * test_timer_wheel_rearm - Cancel and re-arm from inside an expiry batch
+ * 
+ * Arms TWHEEL_REARM_TIMERS timers for the same deadline, whose callbacks
+ * cancel and re-arm timers that are still pending in that batch, and
+ * drives timer_wheel_run() the way TIMER_SOFTIRQ does. Every timer must
+ * fire, and none before its (possibly re-armed) deadline.
+ */
+void test_timer_wheel_rearm(void) {
+    char buf[96];
+    uint64_t deadline = timer_read_counter() + timer_us_to_ticks(100);
+    uint64_t give_up = deadline + timer_us_to_ticks(100000);
+    uint64_t now;
+    
+    debug_print("\n[TIMER] Timer wheel re-arm from expiry callbacks...\n");
+    
+    twheel_rearm_fired = 0;
+    twheel_rearm_early = 0;
+    for (int i = 0; i < TWHEEL_REARM_TIMERS; i++) {
+        timer_start(&twheel_rearm[i], deadline, twheel_rearm_fn, &twheel_rearm[i]);
+    }
+    
+    do {
+        now = timer_read_counter();
+        timer_wheel_run(now);
+    } while (twheel_rearm_fired < TWHEEL_REARM_TIMERS && now < give_up);
+    
+    for (int i = 0; i < TWHEEL_REARM_TIMERS; i++) {
+        timer_cancel(&twheel_rearm[i]);
+    }
+    
+    snprintf(buf, sizeof(buf), "[TIMER] %d of %d timers fired, %d early\n",
+             twheel_rearm_fired, TWHEEL_REARM_TIMERS, twheel_rearm_early);
+    debug_print(buf);
+    if (twheel_rearm_fired != TWHEEL_REARM_TIMERS || twheel_rearm_early) {
+        debug_print("[TIMER] ERROR: re-armed timers fired early or not at all\n");
+    } else {
+        debug_print("[TIMER] Re-arm from expiry callbacks - PASS\n");
+    }
+}
@@ -10,6 +10,8 @@
 #include "../include/selftest.h"
 #include "../include/console_api.h"
 #include "../../../include/uart.h"
+#include "../../../include/printf.h"
+#include "../../../include/clocksource.h"
 
 // Platform constants for UART testing
 #ifndef TEST_UART_BASE
@@ -252,6 +254,81 @@ void test_uart_hex_formatting(void) {
     debug_print("Hex formatting test complete\n\n");
 }
 
+// Compare a formatted buffer against the expected text and length
+static int snprintf_check(const char* got, int got_len, const char* want) {
+    int i;
+    for (i = 0; want[i]; i++) {
+        if (got[i] != want[i]) break;
+    }
+    if (!want[i] && !got[i] && got_len == i) return 1;
+
+    debug_print("  FAIL: got \"");
+    debug_print(got);
+    debug_print("\" want \"");
+    debug_print(want);
+    debug_print("\"\n");
+    return 0;
+}
+
+/**
+ * test_snprintf_formatting - Known-answer tests for the vsnprintf engine
+ *
+ * Covers each conversion, width/precision/flag handling, the 64-bit
+ * length modifiers, truncation (C99 return value) and the word-array
+ * entry point used by the klog drain.
+ */
+void test_snprintf_formatting(void) {
+    char buf[64];
+    int pass = 0, total = 0;
+
+    debug_print("\n[UART] snprintf formatting test:\n");
+
+#define CHECK(want, ...) do {                                       \
+        int n_ = snprintf(buf, sizeof(buf), __VA_ARGS__);           \
+        total++;                                                    \
+        pass += snprintf_check(buf, n_, want);                      \
+    } while (0)
+
+    CHECK("-5 0 4000000000", "%d %i %u", -5, 0, 4000000000U);
+    CHECK("-2147483648", "%d", (int)0x80000000);
+    CHECK("18446744073709551615", "%llu", 0xFFFFFFFFFFFFFFFFULL);
+    CHECK("-9223372036854775808", "%lld", (long long)0x8000000000000000ULL);
+    CHECK("0xdeadbeefcafe", "0x%lx", 0xDEADBEEFCAFEULL);
+    CHECK("0000000000001234", "%016llX", 0x1234ULL);
+    CHECK("0x00000abc", "0x%08x", 0xABCU);
+    CHECK("42    |-00042", "%-6d|%06d", 42, -42);
+    CHECK("+5  5", "%+d % d", 5, 5);
+    CHECK("   ab|cd   |xy", "%5s|%-5s|%.2s", "ab", "cd", "xyz");
+    CHECK("a%b", "%c%%%c", 'a', 'b');
+    CHECK("0x1000", "%p", (void*)0x1000);
+    CHECK("0xff 0XFF 0", "%#x %#X %#x", 255, 255, 0);
+    CHECK("|007", "%.0d|%.3d", 0, 7);
+    CHECK("7 44 4464", "%zu %hhd %hu", (size_t)7, 300, 70000);
+    CHECK("    1|2   |", "%*d|%-*d|", 5, 1, 4, 2);
+    CHECK("(null)", "%s", (char*)0);
+
+#undef CHECK
+
+    // Truncation: NUL-terminated, returns the untruncated length
+    char small[4];
+    int n = snprintf(small, sizeof(small), "hello");
+    total++;
+    if (n == 5 && small[3] == '\0') {
+        pass += snprintf_check(small, 3, "hel");
+    } else {
+        debug_print("  FAIL: truncation\n");
+    }
+
+    // Word-array arguments: 32-bit conversions use the low half
+    uint64_t words[3] = { 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFF80000000ULL, 12345 };
+    n = bstr_snprintf(buf, sizeof(buf), "%d %x %lu", words, 3);
+    total++;
+    pass += snprintf_check(buf, n, "-1 80000000 12345");
+
+    debug_print(pass == total ? "snprintf formatting test PASSED\n\n"
+                              : "snprintf formatting test FAILED\n\n");
+}
+
 /**
  * test_uart_string_functions - Test string output functions
  * 
@@ -326,3 +403,33 @@ void test_uart_error_conditions(void) {
     
     debug_print("Error condition test complete\n\n");
 }
+
+/**
+ * test_uart_tx_irq - Check the PL011 TX interrupt path is live
+ * 
+ * Queues a line with the TX interrupt armed and waits up to 10 ms, with
+ * IRQs unmasked, for the TX interrupt handler to run. Must be called
+ * after uart_irq_init().
+ */
+void test_uart_tx_irq(void) {
+    static const char line[] = "[UART] TX interrupt test line\n";
+    
+    if (!uart_tx_irq_enabled()) {
+        uart_puts("[UART] ERROR: TX interrupt path not initialised\n");
+        return;
+    }
+    
+    uint64_t before = uart_tx_irq_count();
+    uint64_t timeout = arch_clocksource.freq / 100;
+    uint64_t start = clocksource_read();
+    
+    uart_write_tx_armed(line, sizeof(line) - 1);
+    while (uart_tx_irq_count() == before && clocksource_read() - start < timeout) {
+    }
+    
+    if (uart_tx_irq_count() != before) {
+        uart_puts("[UART] TX interrupt fired - PASS\n");
+    } else {
+        uart_puts("[UART] ERROR: TX interrupt did not fire\n");
+    }
+}
@@ -481,7 +481,7 @@ void register_mapping(uint64_t virt_start, uint64_t virt_end, uint64_t phys_star
     
     num_mappings++;
     
-    if (debug_vmm) {
+    if (vmm_debug_enabled()) {
         uart_puts_early("[VMM] Registered mapping: ");
         uart_puts_early(name);
         uart_puts_early(" VA: 0x");
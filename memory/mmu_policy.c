@@ -16,6 +16,7 @@
 #include "../include/types.h"
 #include "../include/memory_config.h"
 #include "../include/uart.h"
+#include "../include/klog.h"
 
 /* ========================================================================
  * PRIVATE HELPER FUNCTIONS
@@ -406,8 +407,13 @@ void mmu_set_ttbr_bases(uint64_t ttbr0_base, uint64_t ttbr1_base) {
 }
 
 void mmu_comprehensive_tlbi_sequence(void) {
-    // Call the verbose version for backward compatibility
-    mmu_comprehensive_tlbi_sequence_verbose();
+    // The "TLB:12345OK" progress markers only exist in builds that keep
+    // debug-level output
+    if (KLOG_ENABLED(KLOG_DEBUG)) {
+        mmu_comprehensive_tlbi_sequence_verbose();
+    } else {
+        mmu_comprehensive_tlbi_sequence_quiet();
+    }
 }
 
 void mmu_comprehensive_tlbi_sequence_verbose(void) {
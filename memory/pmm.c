@@ -7,6 +7,10 @@
 #include "../include/debug.h"
 #include "../include/debug_config.h"
 #include "../include/mmu_policy.h"  // For centralized TLB operations
+#include "../include/clocksource.h"  // ktime_get_ns() for allocation timestamps
+#include "../include/klog.h"
+#include "../include/trace.h"
+#include "../include/perf.h"
 
 // Declaration for debug_hex64 function from kernel/main.c
 extern void debug_hex64(const char* label, uint64_t value);
@@ -47,12 +51,9 @@ static struct {
 } recent_allocs[TRACK_BUFFER_SIZE];
 static int alloc_index = 0;
 
-// Simple timestamp implementation - returns a monotonically increasing counter
-static uint64_t timestamp_counter = 0;
-
-// Get current timestamp (simplified version)
+// Allocation timestamp in nanoseconds since boot
 uint64_t get_timestamp(void) {
-    return timestamp_counter++;
+    return ktime_get_ns();
 }
 
 // Mark a page as used or free
@@ -269,8 +270,11 @@ void init_pmm(void) {
     );
 }
 
+static PERF_REGION(perf_alloc_page, "alloc_page");
+static PERF_REGION(perf_map_range, "map_range");
+
 // Safer alloc_page() tracking
-void* alloc_page(void) {
+static void* __alloc_page(void) {
     for (size_t i = 0; i < total_pages; ++i) {
         uintptr_t addr = MEMORY_START + i * PAGE_SIZE;
         if (!is_page_used(addr)) {
@@ -287,6 +291,7 @@ void* alloc_page(void) {
             
             // Record allocation
             record_allocation(addr, 1);
+            trace_pmm_alloc(addr, 1);
             
             // Debug output
             //debug_hex64("[PMM] alloc_page -> ", addr);
@@ -301,6 +306,15 @@ void* alloc_page(void) {
     return NULL;
 }
 
+void* alloc_page(void) {
+    struct pmu_sample start;
+
+    perf_region_begin(&start);
+    void* page = __alloc_page();
+    perf_region_end(&perf_alloc_page, &start);
+    return page;
+}
+
 void free_page(void* addr) {
     if (addr == NULL) {
         return;  // Prevent NULL dereference
@@ -387,7 +401,7 @@ void pmm_print_memory_map(void) {
 void record_allocation(uintptr_t addr, size_t pages) {
     recent_allocs[alloc_index].addr = addr;
     recent_allocs[alloc_index].size = pages;
-    recent_allocs[alloc_index].timestamp = get_timestamp(); // You'd need to implement this
+    recent_allocs[alloc_index].timestamp = get_timestamp();
     alloc_index = (alloc_index + 1) % TRACK_BUFFER_SIZE;
 }
 
@@ -522,11 +536,8 @@ uint64_t* create_page_table(void) {
  * @param flags Page table entry flags
  */
 void map_page(uint64_t* l3_table, uint64_t va, uint64_t pa, uint64_t flags) {
-    volatile uint32_t* uart = (volatile uint32_t*)0x09000000;
-    
     if (l3_table == NULL) {
-        // Debug: X = L3 table is NULL
-        *uart = 'X'; *uart = 'N'; *uart = 'U'; *uart = 'L'; *uart = 'L'; *uart = '\r'; *uart = '\n';
+        early_log_hex(KLOG_ERR, "[PMM] map_page: no L3 table for VA ", va);
         return;
     }
     
@@ -534,11 +545,7 @@ void map_page(uint64_t* l3_table, uint64_t va, uint64_t pa, uint64_t flags) {
     if ((pa >= UART_PHYS && pa < (UART_PHYS + 0x1000)) ||
         (va >= UART_PHYS && va < (UART_PHYS + 0x1000))) {
         // Skip UART MMIO region to avoid collisions
-        // Debug: S = Skip UART region
-        *uart = 'S'; *uart = 'K'; *uart = 'I'; *uart = 'P'; 
-        *uart = 'P'; uart_hex64_early(pa);
-        *uart = 'V'; uart_hex64_early(va);
-        *uart = '\r'; *uart = '\n';
+        early_log_hex(KLOG_DEBUG, "[PMM] map_page: skipping UART page VA ", va);
         return;
     }
     
@@ -553,14 +560,14 @@ void map_page(uint64_t* l3_table, uint64_t va, uint64_t pa, uint64_t flags) {
     l3_table[l3_index] = l3_entry;
     
     // Debug output
-    if (debug_vmm) {
-        // Debug: O = mapped OK
-        *uart = 'O'; *uart = 'K';
-        *uart = 'V'; uart_hex64_early(va);
-        *uart = 'P'; uart_hex64_early(pa);
-        *uart = 'F'; uart_hex64_early(flags);
-        *uart = 'I'; uart_hex64_early(l3_index);
-        *uart = '\r'; *uart = '\n';
+    if (vmm_debug_enabled()) {
+        uart_puts("[PMM] Mapped VA ");
+        uart_hex64(va);
+        uart_puts(" -> PA ");
+        uart_hex64(pa);
+        uart_puts(" flags ");
+        uart_hex64(flags);
+        uart_puts("\n");
     }
 }
 
@@ -574,8 +581,13 @@ void map_page(uint64_t* l3_table, uint64_t va, uint64_t pa, uint64_t flags) {
  */
 void map_range(uint64_t* l0_table, uint64_t virt_start, uint64_t virt_end, 
                uint64_t phys_start, uint64_t flags) {
+    struct pmu_sample perf_start;
+    perf_region_begin(&perf_start);
+    
+    #if DEBUG_MEMORY_MAPPING_ENABLED
     // UART for debug markers
     volatile uint32_t* uart = (volatile uint32_t*)0x09000000;
+    #endif
     
     // Calculate the number of pages
     uint64_t size = virt_end - virt_start;
@@ -620,8 +632,7 @@ void map_range(uint64_t* l0_table, uint64_t virt_start, uint64_t virt_end,
         // Create/get L3 table for the virtual address
         uint64_t* l3_table = get_l3_table_for_addr(page_table_to_use, virt_addr);
         if (!l3_table) {
-            // Debug: X = failed to get L3 table
-            *uart = 'X'; *uart = 'L'; *uart = '3'; uart_hex64_early(virt_addr); *uart = '\r'; *uart = '\n';
+            early_log_hex(KLOG_ERR, "[PMM] map_range: no L3 table for VA ", virt_addr);
             continue;
         }
         
@@ -655,17 +666,17 @@ void map_range(uint64_t* l0_table, uint64_t virt_start, uint64_t virt_end,
     // asm volatile("dsb ish" ::: "memory");
     // asm volatile("isb" ::: "memory");
     
-    *uart = 'B'; *uart = 'U'; *uart = 'L'; *uart = 'K'; *uart = ':'; *uart = 'T'; *uart = 'L'; *uart = 'B';
-    *uart = '\r'; *uart = '\n';
+    early_log_puts(KLOG_DEBUG, "BULK:TLB\n");
     
     // ✅ POLICY LAYER: Single bulk TLB invalidation after mapping all pages (MUCH more efficient!)
     mmu_comprehensive_tlbi_sequence_quiet();  // Use quiet version to avoid console flooding
     
-    *uart = ':'; *uart = 'O'; *uart = 'K';
-    *uart = '\r'; *uart = '\n';
+    early_log_puts(KLOG_DEBUG, ":OK\n");
     
     // Register the mapping for diagnostic purposes
     register_mapping(virt_start, virt_end, phys_start, flags, "Range mapping");
+    
+    perf_region_end(&perf_map_range, &perf_start);
 }
 
 /**
@@ -707,11 +718,10 @@ void map_page_direct(uint64_t va, uint64_t pa, uint64_t size, uint64_t flags) {
  * @param flags Page table entry flags
  */
 void map_kernel_page(uint64_t va, uint64_t pa, uint64_t flags) {
-    debug_print("[PMM] Mapping kernel page VA 0x");
-    debug_hex64("", va);
-    debug_print(" to PA 0x");
-    debug_hex64("", pa);
-    debug_print("\n");
+    if (KLOG_ENABLED(KLOG_DEBUG)) {
+        debug_hex64("[PMM] Mapping kernel page VA ", va);
+        debug_hex64("[PMM]   to PA ", pa);
+    }
     
     // Get the kernel page table
     uint64_t* l0_table = get_kernel_page_table();
@@ -739,7 +749,25 @@ void map_kernel_page(uint64_t va, uint64_t pa, uint64_t flags) {
     // ✅ POLICY LAYER: Use centralized TLB invalidation sequence
     mmu_comprehensive_tlbi_sequence();
     
-    debug_print("[PMM] Kernel page mapped successfully\n");
+    early_log_puts(KLOG_DEBUG, "[PMM] Kernel page mapped successfully\n");
+}
+
+/**
+ * @brief Remove a single kernel page mapping made with map_kernel_page()
+ */
+void unmap_kernel_page(uint64_t va) {
+    uint64_t* l0_table = get_kernel_page_table();
+    if (!l0_table) {
+        return;
+    }
+    
+    uint64_t* l3_table = get_l3_table_for_addr(l0_table, va);
+    if (!l3_table) {
+        return;
+    }
+    
+    l3_table[(va >> 12) & 0x1FF] = 0;
+    mmu_comprehensive_tlbi_sequence();
 }
 
 /**
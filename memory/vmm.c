@@ -8,6 +8,7 @@
 #include "memory_debug.h"
 #include "../include/memory_core.h"
 #include "../include/mmu_policy.h"  // For centralized TLB operations
+#include "../include/klog.h"
 
 // Prototypes for diagnostic helpers
 uint64_t read_mair_el1(void);
@@ -162,7 +163,7 @@ uint64_t* get_l3_table_for_addr(uint64_t* l0_table, uint64_t virt_addr) {
     uint64_t l2_idx = (virt_addr >> 21) & 0x1FF;
     
     // Debug output
-    if (debug_vmm) {
+    if (vmm_debug_enabled()) {
         uart_puts("[VMM] Getting L3 table for VA 0x");
         uart_hex64(virt_addr);
         uart_puts(", L0[");
@@ -176,9 +177,7 @@ uint64_t* get_l3_table_for_addr(uint64_t* l0_table, uint64_t virt_addr) {
     
     // Step 1: L0 → L1
     if (!(l0_table[l0_idx] & PTE_VALID)) {
-        uart_puts("[VMM] No L1 table for VA 0x");
-        uart_hex64(virt_addr);
-        uart_puts(", creating new L1 table\n");
+        early_log_hex(KLOG_DEBUG, "[VMM] Creating L1 table for VA ", virt_addr);
         
         // Allocate a new L1 table
         uint64_t* new_l1 = alloc_page();
@@ -207,9 +206,7 @@ uint64_t* get_l3_table_for_addr(uint64_t* l0_table, uint64_t virt_addr) {
     
     // Step 2: L1 → L2
     if (!(l1_table[l1_idx] & PTE_VALID)) {
-        uart_puts("[VMM] No L2 table for VA 0x");
-        uart_hex64(virt_addr);
-        uart_puts(", creating new L2 table\n");
+        early_log_hex(KLOG_DEBUG, "[VMM] Creating L2 table for VA ", virt_addr);
         
         // Allocate a new L2 table
         uint64_t* new_l2 = alloc_page();
@@ -238,9 +235,7 @@ uint64_t* get_l3_table_for_addr(uint64_t* l0_table, uint64_t virt_addr) {
     
     // Step 3: L2 → L3
     if (!(l2_table[l2_idx] & PTE_VALID)) {
-        uart_puts("[VMM] No L3 table for VA 0x");
-        uart_hex64(virt_addr);
-        uart_puts(", creating new L3 table\n");
+        early_log_hex(KLOG_DEBUG, "[VMM] Creating L3 table for VA ", virt_addr);
         
         // Allocate a new L3 table
         uint64_t* new_l3 = alloc_page();
@@ -388,7 +383,7 @@ void map_code_section(void) {
             :: "r"(&l3_table[l3_idx]) : "memory"
         );
         
-        if (debug_vmm) {
+        if (vmm_debug_enabled()) {
             uart_puts("[VMM] Mapped executable page at VA 0x");
             uart_hex64(addr);
             uart_puts(" with PTE 0x");
@@ -1245,7 +1240,7 @@ void ensure_vector_table_executable_l3(uint64_t* l3_table) {
         uart_hex64_early(new_pte);
         uart_puts_early("\n");
     } else {
-        if (debug_vmm) {
+        if (vmm_debug_enabled()) {
             uart_puts_early("[VMM] Vector table is already executable: 0x");
             uart_hex64_early(vbar_virt);
             uart_puts_early("\n");
@@ -0,0 +1,54 @@
+#!/bin/bash
+# Build the default (debug) and PROFILE=release kernels, boot each under
+# QEMU and compare the "[BOOT] kernel_main complete" line, i.e. the cost of
+# the diagnostics that release builds compile out.
+#
+# Usage: scripts/boot_time_compare.sh [timeout-seconds]
+
+TIMEOUT="${1:-20}"
+KERNEL="build/kernel8.img"
+
+cd "$(dirname "$0")/.." || exit 1
+
+boot_ticks() {
+    local profile="$1"
+    local log="build/boot_${profile}.log"
+
+    make clean >/dev/null
+    if ! make PROFILE="$profile" all >/dev/null; then
+        echo "build failed for PROFILE=$profile" >&2
+        return 1
+    fi
+    cp "$KERNEL" "build/kernel8_${profile}.img"
+
+    timeout "${TIMEOUT}s" qemu-system-aarch64 \
+      -M virt -cpu cortex-a53 \
+      -accel tcg,thread=single -smp 1 \
+      -serial "file:$log" \
+      -monitor none \
+      -display none \
+      -kernel "build/kernel8_${profile}.img"
+
+    grep -a "\[BOOT\] kernel_main complete" "$log" | tail -1
+}
+
+echo "=========================================="
+echo "Boot time: debug vs release"
+echo "=========================================="
+
+DEBUG_LINE=$(boot_ticks debug)
+RELEASE_LINE=$(boot_ticks release)
+
+echo "debug:   ${DEBUG_LINE:-<no report>}"
+echo "release: ${RELEASE_LINE:-<no report>}"
+
+DEBUG_TICKS=$(echo "$DEBUG_LINE" | sed -n 's/.*complete: \([0-9]*\) ticks.*/\1/p')
+RELEASE_TICKS=$(echo "$RELEASE_LINE" | sed -n 's/.*complete: \([0-9]*\) ticks.*/\1/p')
+
+if [ -n "$DEBUG_TICKS" ] && [ -n "$RELEASE_TICKS" ] && [ "$DEBUG_TICKS" -gt 0 ]; then
+    SAVED=$((DEBUG_TICKS - RELEASE_TICKS))
+    echo "release saves $SAVED ticks ($((SAVED * 100 / DEBUG_TICKS))%)"
+else
+    echo "could not extract both measurements (see build/boot_*.log)"
+    exit 1
+fi
@@ -0,0 +1,92 @@
+#!/bin/bash
+# Build the kernel, boot it under QEMU and collect the kbench results
+# ("BENCH <name> <value> <unit>" lines from run_kbench()), then compare
+# them against a stored baseline.
+#
+# Usage: scripts/kbench.sh [--save] [baseline-file]
+#   --save       store this run as the new baseline instead of comparing
+#
+# Environment:
+#   PROFILE      build profile (default: release, so log output does not
+#                skew the numbers)
+#   TIMEOUT      seconds to wait for BENCH-END (default: 60)
+#   THRESHOLD    percent change reported as a regression (default: 10)
+
+SAVE=0
+if [ "$1" = "--save" ]; then
+    SAVE=1
+    shift
+fi
+
+cd "$(dirname "$0")/.." || exit 1
+
+BASELINE="${1:-scripts/kbench_baseline.txt}"
+PROFILE="${PROFILE:-release}"
+TIMEOUT="${TIMEOUT:-60}"
+THRESHOLD="${THRESHOLD:-10}"
+LOG="build/kbench.log"
+RESULTS="build/kbench_results.txt"
+
+make clean >/dev/null
+if ! make PROFILE="$PROFILE" all >/dev/null; then
+    echo "build failed for PROFILE=$PROFILE" >&2
+    exit 1
+fi
+
+rm -f "$LOG"
+qemu-system-aarch64 \
+  -M virt -cpu cortex-a53 \
+  -accel tcg,thread=single -smp 1 \
+  -serial "file:$LOG" \
+  -monitor none \
+  -display none \
+  -kernel build/kernel8.img &
+QEMU_PID=$!
+
+# The kernel keeps running after the suite; stop QEMU once it is done
+for _ in $(seq "$TIMEOUT"); do
+    grep -aq "BENCH-END" "$LOG" 2>/dev/null && break
+    sleep 1
+done
+kill "$QEMU_PID" 2>/dev/null
+wait "$QEMU_PID" 2>/dev/null
+
+if ! grep -aq "BENCH-END" "$LOG"; then
+    echo "no BENCH-END within ${TIMEOUT}s (see $LOG)" >&2
+    exit 1
+fi
+
+grep -ao "BENCH [^ ]* [0-9.]* [^ ]*" "$LOG" | awk '{print $2, $3, $4}' > "$RESULTS"
+grep -ao "BENCH-SKIP.*" "$LOG"
+
+if [ "$SAVE" = 1 ]; then
+    cp "$RESULTS" "$BASELINE"
+    echo "saved $(wc -l < "$RESULTS") results to $BASELINE"
+    exit 0
+fi
+
+if [ ! -f "$BASELINE" ]; then
+    cat "$RESULTS"
+    echo "no baseline at $BASELINE; run with --save to create one"
+    exit 0
+fi
+
+# Cycle counts regress upwards, throughputs downwards
+awk -v threshold="$THRESHOLD" '
+    NR == FNR { base[$1] = $2; next }
+    {
+        name = $1; value = $2; unit = $3
+        if (!(name in base)) { printf "%-28s %12s -> %12s %s (new)\n", name, "-", value, unit; next }
+        old = base[name]
+        delta = old > 0 ? (value - old) * 100 / old : 0
+        worse = (unit == "bytes/s") ? -delta : delta
+        flag = ""
+        if (worse > threshold) { flag = "  REGRESSION"; regressions++ }
+        else if (worse < -threshold) flag = "  improved"
+        printf "%-28s %12s -> %12s %s (%+.1f%%)%s\n", name, old, value, unit, delta, flag
+    }
+    END {
+        if (regressions) { printf "%d result(s) regressed by more than %s%%\n", regressions, threshold; exit 1 }
+        printf "no regressions beyond %s%%\n", threshold
+    }
+' "$BASELINE" "$RESULTS"
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Symbolise a profile_dump() from the kernel serial log.
+
+Prints a flat profile (samples per function, self time) and the hottest
+PCs, resolved against the kernel ELF with nm. With --folded, writes
+"caller;callee count" stacks for flamegraph.pl / speedscope instead.
+
+Usage: scripts/profile_symbolize.py build/serial.log [--elf build/kernel.elf]
+                                    [--top N] [--folded out.txt]
+The last PROFILE-BEGIN/PROFILE-END block in the log is used.
+"""
+
+import argparse
+import bisect
+import collections
+import os
+import shutil
+import subprocess
+import sys
+
+NM_CANDIDATES = ["aarch64-elf-nm", "aarch64-none-elf-nm", "aarch64-linux-gnu-nm",
+                 "llvm-nm", "nm"]
+
+SAMPLE_USER = 0x1           # PROFILE_SAMPLE_USER in include/profile.h
+
+
+def load_symbols(elf):
+    nm = next((n for n in NM_CANDIDATES if shutil.which(n)), None)
+    if not nm:
+        sys.exit("no nm found (tried %s)" % ", ".join(NM_CANDIDATES))
+    out = subprocess.run([nm, "-n", "-S", "--defined-only", elf],
+                         capture_output=True, text=True, check=True).stdout
+    addrs, syms = [], []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) < 3 or parts[-2].lower() not in ("t", "w"):
+            continue
+        addr = int(parts[0], 16)
+        size = int(parts[1], 16) if len(parts) == 4 else 0
+        addrs.append(addr)
+        syms.append((parts[-1], addr, size))
+    return addrs, syms
+
+
+def resolve(addrs, syms, pc):
+    i = bisect.bisect_right(addrs, pc) - 1
+    if i < 0:
+        return "0x%x" % pc
+    name, start, size = syms[i]
+    if size and pc >= start + size:
+        return "0x%x" % pc
+    return name
+
+
+def parse(lines):
+    """Return (header fields, task names, [(count, task, flags, pc, [bt])])."""
+    header, names, stacks, inside = None, {}, [], False
+    for line in lines:
+        line = line.strip()
+        if line.startswith("PROFILE-BEGIN"):
+            header = dict(f.split("=", 1) for f in line.split()[2:] if "=" in f)
+            names, stacks, inside = {}, [], True
+        elif not inside:
+            continue
+        elif line == "PROFILE-END":
+            inside = False
+        elif line.startswith("TN "):
+            _, tid, name = (line.split(None, 2) + [""])[:3]
+            names[int(tid)] = name
+        elif line.startswith("PS "):
+            f = line.split()
+            stacks.append((int(f[1]), int(f[2]), int(f[3], 16), int(f[4], 16),
+                           [int(a, 16) for a in f[5:]]))
+    if header is None:
+        sys.exit("no PROFILE-BEGIN block found")
+    return header, names, stacks
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("log", help="serial log containing a profile dump")
+    ap.add_argument("--elf", default=os.path.join("build", "kernel.elf"))
+    ap.add_argument("--top", type=int, default=20)
+    ap.add_argument("--folded", metavar="FILE",
+                    help="write folded stacks for flame graphs")
+    args = ap.parse_args()
+
+    with open(args.log, errors="replace") as f:
+        header, names, stacks = parse(f)
+    names.setdefault(-1, "idle")
+    names.setdefault(-2, "boot")
+    addrs, syms = load_symbols(args.elf)
+
+    def sym(pc, flags=0):
+        return "[user]" if flags & SAMPLE_USER else resolve(addrs, syms, pc)
+
+    total = sum(s[0] for s in stacks)
+    print("%d samples (source=%s period=%s, %s overwritten)" %
+          (total, header.get("source"), header.get("period"),
+           header.get("overwritten", "0")))
+    if not total:
+        return
+
+    if args.folded:
+        folded = collections.Counter()
+        for count, task, flags, pc, bt in stacks:
+            frames = [names.get(task, "task %d" % task)]
+            frames += [sym(a) for a in reversed(bt)] + [sym(pc, flags)]
+            folded[";".join(frames)] += count
+        with open(args.folded, "w") as f:
+            for stack, count in folded.most_common():
+                f.write("%s %d\n" % (stack, count))
+        print("folded stacks -> %s" % args.folded)
+        return
+
+    by_func = collections.Counter()
+    by_pc = collections.Counter()
+    by_task = collections.Counter()
+    for count, task, flags, pc, bt in stacks:
+        by_func[sym(pc, flags)] += count
+        by_pc[(pc, flags)] += count
+        by_task[names.get(task, "task %d" % task)] += count
+
+    print("\n%8s %6s  %s" % ("samples", "%", "function"))
+    for name, count in by_func.most_common(args.top):
+        print("%8d %5.1f%%  %s" % (count, 100.0 * count / total, name))
+
+    print("\n%8s %6s  %-18s %s" % ("samples", "%", "pc", "function"))
+    for (pc, flags), count in by_pc.most_common(args.top):
+        print("%8d %5.1f%%  0x%016x %s" % (count, 100.0 * count / total, pc, sym(pc, flags)))
+
+    print("\n%8s %6s  %s" % ("samples", "%", "task"))
+    for name, count in by_task.most_common():
+        print("%8d %5.1f%%  %s" % (count, 100.0 * count / total, name))
+
+
+if __name__ == "__main__":
+    main()
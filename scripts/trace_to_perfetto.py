@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Convert a trace_dump() from the kernel serial log to Chrome trace JSON.
+
+The output loads in ui.perfetto.dev or chrome://tracing:
+  - one track per CPU with a slice for each task run (sched_switch)
+  - an "irq" track per CPU with a slice per interrupt (irq_entry/exit)
+  - syscall slices on the CPU track, from entry timestamp to return
+  - instant events for pmm_alloc
+
+Usage: scripts/trace_to_perfetto.py build/serial.log [-o trace.json]
+The last TRACE-BEGIN/TRACE-END block in the log is used.
+"""
+
+import argparse
+import json
+import sys
+
+# Mirrors enum trace_event in include/trace.h
+SCHED_SWITCH, IRQ_ENTRY, IRQ_EXIT, SYSCALL, PMM_ALLOC = range(5)
+
+# Mirrors sys_call_table in kernel/core/syscall/syscall.c
+SYSCALL_NAMES = ["hello", "write", "exit", "yield", "nanosleep", "getpid",
+                 "syscall_stats"]
+
+IRQ_TID_BASE = 1000
+
+
+def s32(v):
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def parse(lines):
+    """Return (freq, task names, records) from the last dump in lines."""
+    freq, names, records, inside = None, {}, [], False
+    for line in lines:
+        line = line.strip()
+        if line.startswith("TRACE-BEGIN"):
+            fields = dict(f.split("=", 1) for f in line.split()[2:] if "=" in f)
+            freq, names, records, inside = int(fields["freq"]), {}, [], True
+        elif not inside:
+            continue
+        elif line == "TRACE-END":
+            inside = False
+        elif line.startswith("TN "):
+            _, tid, name = (line.split(None, 2) + [""])[:3]
+            names[int(tid)] = name
+        elif line.startswith("TR "):
+            ts, w1, a1, a2 = (int(w, 16) for w in line.split()[1:5])
+            records.append({
+                "ts": ts,
+                "event": w1 & 0xFFFF,
+                "cpu": (w1 >> 16) & 0xFFFF,
+                "arg0": w1 >> 32,
+                "arg1": a1,
+                "arg2": a2,
+            })
+    if freq is None:
+        sys.exit("no TRACE-BEGIN block found")
+    records.sort(key=lambda r: r["ts"])
+    return freq, names, records
+
+
+def convert(freq, names, records):
+    names.setdefault(-1, "idle")
+    t0 = records[0]["ts"] if records else 0
+
+    def us(ticks):
+        return (ticks - t0) * 1e6 / freq
+
+    def task_name(tid):
+        return names.get(tid, "task %d" % tid)
+
+    events = []
+    running = {}                # cpu -> (task id, start ts)
+    cpus = set()
+
+    for r in records:
+        cpu = r["cpu"]
+        cpus.add(cpu)
+        ev = r["event"]
+        if ev == SCHED_SWITCH:
+            nxt, prev = s32(r["arg0"]), s32(r["arg1"] & 0xFFFFFFFF)
+            start = running.get(cpu, (prev, t0))[1]
+            events.append({"name": task_name(prev), "ph": "X", "pid": 0,
+                           "tid": cpu, "ts": us(start),
+                           "dur": us(r["ts"]) - us(start),
+                           "args": {"prev_state": r["arg2"]}})
+            running[cpu] = (nxt, r["ts"])
+        elif ev in (IRQ_ENTRY, IRQ_EXIT):
+            events.append({"name": "irq %d" % r["arg0"],
+                           "ph": "B" if ev == IRQ_ENTRY else "E", "pid": 0,
+                           "tid": IRQ_TID_BASE + cpu, "ts": us(r["ts"])})
+        elif ev == SYSCALL:
+            nr = r["arg0"]
+            name = SYSCALL_NAMES[nr] if nr < len(SYSCALL_NAMES) else "sys %d" % nr
+            events.append({"name": name, "ph": "X", "pid": 0, "tid": cpu,
+                           "ts": us(r["arg2"]),
+                           "dur": us(r["ts"]) - us(r["arg2"]),
+                           "args": {"ret": hex(r["arg1"])}})
+        elif ev == PMM_ALLOC:
+            events.append({"name": "pmm_alloc", "ph": "i", "s": "t", "pid": 0,
+                           "tid": cpu, "ts": us(r["ts"]),
+                           "args": {"addr": hex(r["arg1"]), "pages": r["arg0"]}})
+
+    # Close the slice of whatever was running when the dump was taken
+    end = records[-1]["ts"] if records else t0
+    for cpu, (tid, start) in running.items():
+        events.append({"name": task_name(tid), "ph": "X", "pid": 0, "tid": cpu,
+                       "ts": us(start), "dur": us(end) - us(start)})
+
+    for cpu in sorted(cpus):
+        events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": cpu,
+                       "args": {"name": "cpu%d" % cpu}})
+        events.append({"name": "thread_name", "ph": "M", "pid": 0,
+                       "tid": IRQ_TID_BASE + cpu,
+                       "args": {"name": "cpu%d irq" % cpu}})
+    events.append({"name": "process_name", "ph": "M", "pid": 0,
+                   "args": {"name": "Project-Trajan"}})
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("log", help="serial log containing a trace dump")
+    ap.add_argument("-o", "--output", default="trace.json")
+    args = ap.parse_args()
+
+    with open(args.log, errors="replace") as f:
+        freq, names, records = parse(f)
+
+    with open(args.output, "w") as f:
+        json.dump(convert(freq, names, records), f)
+    print("%d records -> %s" % (len(records), args.output))
+
+
+if __name__ == "__main__":
+    main()